@@ -0,0 +1,261 @@
+#include "city_generator.h"
+
+#include "geo.h"
+#include "json_reader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+using namespace std::literals;
+
+namespace {
+
+// Границы области, в которой размещаются остановки
+constexpr double MIN_LATITUDE = 55.55;
+constexpr double MAX_LATITUDE = 55.90;
+constexpr double MIN_LONGITUDE = 37.35;
+constexpr double MAX_LONGITUDE = 37.85;
+
+std::string StopName(size_t index) {
+    return "stop_"s + std::to_string(index);
+}
+
+std::string BusName(size_t index) {
+    return "bus_"s + std::to_string(index);
+}
+
+/*
+* Сеть дорог: остановки расположены на сетке с небольшим случайным смещением,
+* дорогами соединены остановки с близкими номерами, то есть соседи по сетке
+*/
+class RoadNetwork {
+public:
+    RoadNetwork(const CityParams& params, std::mt19937& generator)
+        : coordinates_(params.stop_count)
+        , neighbours_(params.stop_count) {
+        const size_t columns = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(params.stop_count))));
+        const size_t rows = (params.stop_count + columns - 1) / columns;
+        const double lat_step = (MAX_LATITUDE - MIN_LATITUDE) / std::max<size_t>(1, rows);
+        const double lng_step = (MAX_LONGITUDE - MIN_LONGITUDE) / columns;
+        std::uniform_real_distribution<double> jitter(0.0, 0.8);
+
+        for (size_t i = 0; i < params.stop_count; ++i) {
+            coordinates_[i].lat = MIN_LATITUDE + (i / columns + jitter(generator)) * lat_step;
+            coordinates_[i].lng = MIN_LONGITUDE + (i % columns + jitter(generator)) * lng_step;
+        }
+
+        if (params.stop_count < 2) {
+            return;
+        }
+
+        // соседи выбираются среди ближайших по сетке остановок: слева, справа, сверху, снизу и рядом с ними
+        const std::vector<long long> offsets = {
+            1, -1, static_cast<long long>(columns), -static_cast<long long>(columns),
+            static_cast<long long>(columns) + 1, static_cast<long long>(columns) - 1,
+            -static_cast<long long>(columns) + 1, -static_cast<long long>(columns) - 1 };
+
+        for (size_t i = 0; i < params.stop_count; ++i) {
+            for (size_t k = 0; k < params.distance_density; ++k) {
+                long long j = static_cast<long long>(i) + offsets[k % offsets.size()] * static_cast<long long>(1 + k / offsets.size());
+                if (j < 0 || j >= static_cast<long long>(params.stop_count)) {
+                    j = std::uniform_int_distribution<long long>(0, params.stop_count - 1)(generator);
+                }
+                if (static_cast<size_t>(j) != i) {
+                    AddRoad(i, static_cast<size_t>(j), generator);
+                }
+            }
+        }
+    }
+
+    // Добавляет дорогу, если её ещё нет; длина дороги больше расстояния по прямой
+    void AddRoad(size_t from, size_t to, std::mt19937& generator) {
+        if (distances_.count({ from, to }) > 0) {
+            return;
+        }
+        const double geo = ComputeDistance(coordinates_[from], coordinates_[to]);
+        const int distance = static_cast<int>(std::ceil(geo * std::uniform_real_distribution<double>(1.05, 1.5)(generator))) + 1;
+        distances_[{ from, to }] = distance;
+        neighbours_[from].push_back(to);
+        neighbours_[to].push_back(from);
+    }
+
+    const std::vector<size_t>& Neighbours(size_t stop) const {
+        return neighbours_[stop];
+    }
+
+    const Coordinates& GetCoordinates(size_t stop) const {
+        return coordinates_[stop];
+    }
+
+    const std::map<std::pair<size_t, size_t>, int>& Distances() const {
+        return distances_;
+    }
+
+private:
+    std::vector<Coordinates> coordinates_;
+    std::vector<std::vector<size_t>> neighbours_;
+    std::map<std::pair<size_t, size_t>, int> distances_;
+};
+
+// Маршрут - случайное блуждание по дорогам без немедленных возвратов
+json::Node CreateBus(size_t index, const CityParams& params, RoadNetwork& network, std::mt19937& generator) {
+    const bool is_roundtrip = std::uniform_int_distribution<int>(0, 1)(generator) == 1;
+
+    std::vector<size_t> route = { std::uniform_int_distribution<size_t>(0, params.stop_count - 1)(generator) };
+    while (route.size() < std::max<size_t>(2, params.route_length)) {
+        const std::vector<size_t>& neighbours = network.Neighbours(route.back());
+        if (neighbours.empty()) {
+            break;
+        }
+        size_t next = neighbours[std::uniform_int_distribution<size_t>(0, neighbours.size() - 1)(generator)];
+        if (route.size() > 1 && next == route[route.size() - 2] && neighbours.size() > 1) {
+            continue;
+        }
+        route.push_back(next);
+    }
+
+    if (is_roundtrip && route.size() > 1) {
+        network.AddRoad(route.back(), route.front(), generator);
+        route.push_back(route.front());
+    }
+
+    json::Array stops;
+    for (size_t stop : route) {
+        stops.emplace_back(StopName(stop));
+    }
+
+    return json::Dict{
+        { "type"s, "Bus"s },
+        { "name"s, BusName(index) },
+        { "stops"s, std::move(stops) },
+        { "is_roundtrip"s, is_roundtrip },
+    };
+}
+
+json::Node CreateRenderSettings() {
+    return json::Dict{
+        { "width"s, 1200.0 },
+        { "height"s, 1200.0 },
+        { "padding"s, 50.0 },
+        { "stop_radius"s, 5.0 },
+        { "line_width"s, 14.0 },
+        { "bus_label_font_size"s, 20 },
+        { "bus_label_offset"s, json::Array{ 7.0, 15.0 } },
+        { "stop_label_font_size"s, 20 },
+        { "stop_label_offset"s, json::Array{ 7.0, -3.0 } },
+        { "underlayer_color"s, json::Array{ 255, 255, 255, 0.85 } },
+        { "underlayer_width"s, 3.0 },
+        { "color_palette"s, json::Array{ "green"s, json::Array{ 255, 160, 0 }, "red"s } },
+    };
+}
+
+} // namespace
+
+json::Node CreateMakeBaseDocument(const CityParams& params, const std::string& base_file) {
+    std::mt19937 generator(params.seed);
+    RoadNetwork network(params, generator);
+
+    json::Array base_requests;
+
+    // маршруты создаются раньше остановок: замыкание кольцевого маршрута может добавить дорогу
+    json::Array buses;
+    if (params.stop_count > 0) {
+        for (size_t i = 0; i < params.bus_count; ++i) {
+            buses.push_back(CreateBus(i, params, network, generator));
+        }
+    }
+
+    std::vector<json::Dict> road_distances(params.stop_count);
+    for (const auto& [stops, distance] : network.Distances()) {
+        road_distances[stops.first][StopName(stops.second)] = distance;
+    }
+
+    for (size_t i = 0; i < params.stop_count; ++i) {
+        const Coordinates& coordinates = network.GetCoordinates(i);
+        base_requests.push_back(json::Dict{
+            { "type"s, "Stop"s },
+            { "name"s, StopName(i) },
+            { "latitude"s, coordinates.lat },
+            { "longitude"s, coordinates.lng },
+            { "road_distances"s, std::move(road_distances[i]) },
+        });
+    }
+
+    for (json::Node& bus : buses) {
+        base_requests.push_back(std::move(bus));
+    }
+
+    return json::Dict{
+        { "serialization_settings"s, json::Dict{ { "file"s, base_file } } },
+        { "routing_settings"s, json::Dict{ { "bus_wait_time"s, 6 }, { "bus_velocity"s, 40.0 } } },
+        { "render_settings"s, CreateRenderSettings() },
+        { "base_requests"s, std::move(base_requests) },
+    };
+}
+
+json::Node CreateProcessRequestsDocument(const CityParams& params, const std::string& base_file) {
+    std::mt19937 generator(params.seed + 1);
+
+    const double total_share = std::max(1e-9, params.stop_share + params.bus_share + params.route_share);
+    std::uniform_real_distribution<double> type_distribution(0.0, total_share);
+    std::uniform_int_distribution<size_t> stop_distribution(0, std::max<size_t>(1, params.stop_count) - 1);
+    std::uniform_int_distribution<size_t> bus_distribution(0, std::max<size_t>(1, params.bus_count) - 1);
+
+    json::Array stat_requests;
+    int id = 1;
+
+    for (size_t i = 0; i < params.map_count; ++i) {
+        stat_requests.push_back(json::Dict{ { "id"s, id++ }, { "type"s, "Map"s } });
+    }
+
+    for (size_t i = 0; i < params.request_count; ++i) {
+        const double type = type_distribution(generator);
+        if (type < params.stop_share) {
+            stat_requests.push_back(json::Dict{
+                { "id"s, id++ }, { "type"s, "Stop"s }, { "name"s, StopName(stop_distribution(generator)) } });
+        }
+        else if (type < params.stop_share + params.bus_share) {
+            stat_requests.push_back(json::Dict{
+                { "id"s, id++ }, { "type"s, "Bus"s }, { "name"s, BusName(bus_distribution(generator)) } });
+        }
+        else {
+            stat_requests.push_back(json::Dict{
+                { "id"s, id++ }, { "type"s, "Route"s },
+                { "from"s, StopName(stop_distribution(generator)) },
+                { "to"s, StopName(stop_distribution(generator)) } });
+        }
+    }
+
+    return json::Dict{
+        { "serialization_settings"s, json::Dict{ { "file"s, base_file } } },
+        { "stat_requests"s, std::move(stat_requests) },
+    };
+}
+
+std::vector<std::pair<std::string, std::string>> CreateAlternativeRoutesPairs(const CityParams& params) {
+    std::mt19937 generator(params.seed + 2);
+    std::uniform_int_distribution<size_t> stop_distribution(0, std::max<size_t>(1, params.stop_count) - 1);
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    pairs.reserve(params.alternative_count);
+    for (size_t i = 0; i < params.alternative_count; ++i) {
+        std::string from = StopName(stop_distribution(generator));
+        pairs.emplace_back(std::move(from), StopName(stop_distribution(generator)));
+    }
+    return pairs;
+}
+
+std::string ToString(const json::Node& node) {
+    std::ostringstream out;
+    json::Print(json::Document(node), out);
+    return out.str();
+}
+
+} // namespace bench
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// Параметры синтетической транспортной сети
+struct CityParams {
+    // количество остановок
+    size_t stop_count = 500;
+
+    // количество автобусных маршрутов
+    size_t bus_count = 50;
+
+    // количество остановок в маршруте (без обратного пути)
+    size_t route_length = 20;
+
+    // количество соседей каждой остановки, для которых заданы дорожные расстояния
+    size_t distance_density = 4;
+
+    // количество запросов к базе
+    size_t request_count = 10000;
+
+    // доли запросов Stop, Bus и Route, нормируются на их сумму
+    double stop_share = 0.4;
+    double bus_share = 0.4;
+    double route_share = 0.2;
+
+    // количество запросов Map, идут первыми
+    size_t map_count = 1;
+
+    // количество запросов AlternativeRoutes, задержка каждого измеряется отдельно
+    size_t alternative_count = 100;
+
+    // начальное значение генератора случайных чисел
+    uint32_t seed = 42;
+};
+
+// Создаёт входной документ make_base: остановки, маршруты, настройки отрисовки и маршрутизации
+json::Node CreateMakeBaseDocument(const CityParams& params, const std::string& base_file);
+
+// Создаёт входной документ process_requests со смесью запросов из параметров
+json::Node CreateProcessRequestsDocument(const CityParams& params, const std::string& base_file);
+
+// Создаёт пары случайных остановок для запросов AlternativeRoutes
+std::vector<std::pair<std::string, std::string>> CreateAlternativeRoutesPairs(const CityParams& params);
+
+// Выводит документ в строку
+std::string ToString(const json::Node& node);
+
+} // namespace bench
@@ -0,0 +1,333 @@
+#include "city_generator.h"
+
+#include "distances_codec.h"
+#include "geo.h"
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+using namespace transport_catalogue;
+
+namespace {
+
+// ---------- Тестовый город --------------------------------------------------
+
+/*
+* Город строится один раз на весь запуск: make_base по синтетической сети с фиксированными
+* параметрами и начальным значением генератора, затем база загружается в каталог.
+* Одинаковые данные от запуска к запуску делают результаты сравнимыми между коммитами
+*/
+class City {
+public:
+    static const City& Get() {
+        static const City city;
+        return city;
+    }
+
+    const TransportCatalogue& GetCatalogue() const {
+        return catalogue_;
+    }
+
+    const request_handler::RequestHandler& GetHandler() const {
+        return handler_;
+    }
+
+    const json::Node& GetMakeBaseDocument() const {
+        return make_base_document_;
+    }
+
+    const std::string& GetBaseFile() const {
+        return base_file_;
+    }
+
+private:
+    City()
+        : handler_(catalogue_)
+        , base_file_((std::filesystem::temp_directory_path() / "transport_micro_bench.db").string()) {
+        bench::CityParams params;
+        // маршрутизатор строится за куб числа вершин, поэтому сеть небольшая
+        params.stop_count = 300;
+        params.bus_count = 30;
+        params.route_length = 20;
+
+        make_base_document_ = bench::CreateMakeBaseDocument(params, base_file_);
+
+        std::istringstream in(bench::ToString(make_base_document_));
+        std::ostringstream out;
+        request_handler::RequestHandlerProcess(in, out).ExecuteMakeBaseRequests();
+
+        {
+            std::ifstream base(base_file_, std::ifstream::in | std::ifstream::binary);
+            transport_serialization::Deserialize(handler_, std::move(base));
+        }
+
+        std::error_code error;
+        std::filesystem::remove(base_file_, error);
+    }
+
+    TransportCatalogue catalogue_;
+    request_handler::RequestHandler handler_;
+    std::string base_file_;
+    json::Node make_base_document_;
+};
+
+std::vector<const stop_catalogue::Stop*> GetShuffledStops(const City& city) {
+    std::vector<const stop_catalogue::Stop*> stops = city.GetHandler().GetStops();
+    std::shuffle(stops.begin(), stops.end(), std::mt19937(42));
+    return stops;
+}
+
+// ---------- Геометрия и каталог ---------------------------------------------
+
+void BM_ComputeDistance(benchmark::State& state) {
+    const auto stops = GetShuffledStops(City::Get());
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto* from = stops[i % stops.size()];
+        const auto* to = stops[(i + 1) % stops.size()];
+        benchmark::DoNotOptimize(ComputeDistance(from->coord, to->coord));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComputeDistance);
+
+void BM_BusHelperBuild(benchmark::State& state) {
+    const City& city = City::Get();
+
+    std::vector<bus_catalogue::BusHelper> helpers;
+    for (const bus_catalogue::Bus* bus : city.GetHandler().GetBuses()) {
+        std::vector<std::string_view> stop_names;
+        for (const stop_catalogue::Stop* stop : bus->route) {
+            stop_names.push_back(stop->name);
+        }
+        bus_catalogue::BusHelper helper;
+        helper.SetName(std::string(bus->name))
+            .SetRouteType(bus->route_type)
+            .SetStopNames(std::move(stop_names))
+            .SetRouteSettings(bus->route_settings);
+        helpers.push_back(std::move(helper));
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        // Build забирает имя маршрута, поэтому строится копия помощника
+        bus_catalogue::BusHelper helper = helpers[i++ % helpers.size()];
+        benchmark::DoNotOptimize(helper.Build(city.GetCatalogue().GetStops()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BusHelperBuild);
+
+void BM_CatalogueAtName(benchmark::State& state) {
+    const City& city = City::Get();
+    const auto stops = GetShuffledStops(city);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(city.GetCatalogue().GetStops().At(stops[i++ % stops.size()]->name));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CatalogueAtName);
+
+void BM_CatalogueAtId(benchmark::State& state) {
+    const City& city = City::Get();
+    const size_t count = city.GetCatalogue().GetStops().Size();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(city.GetCatalogue().GetStops().At(i++ % count));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CatalogueAtId);
+
+void BM_DistancesLookup(benchmark::State& state) {
+    const City& city = City::Get();
+    const stop_catalogue::DistancesContainer& distances = city.GetCatalogue().GetStops().GetDistances();
+
+    std::vector<detail::PointerPair<stop_catalogue::Stop>> keys;
+    keys.reserve(distances.size());
+    for (const auto& [key, distance] : distances) {
+        keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(distances.find(keys[i++ % keys.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DistancesLookup);
+
+void BM_DistancesDecode(benchmark::State& state) {
+    const std::vector<std::string> encoded = City::Get().GetCatalogue().GetStops().EncodeDistances();
+
+    size_t bytes = 0;
+    for (const std::string& neighbours : encoded) {
+        bytes += neighbours.size();
+    }
+
+    for (auto _ : state) {
+        for (const std::string& neighbours : encoded) {
+            benchmark::DoNotOptimize(distances_codec::Decode(neighbours));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_DistancesDecode);
+
+// ---------- JSON ------------------------------------------------------------
+
+void BM_JsonLoad(benchmark::State& state, const std::string& text) {
+    for (auto _ : state) {
+        std::istringstream in(text);
+        benchmark::DoNotOptimize(json::Load(in));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+
+void BM_JsonLoadCity(benchmark::State& state) {
+    BM_JsonLoad(state, bench::ToString(City::Get().GetMakeBaseDocument()));
+}
+BENCHMARK(BM_JsonLoadCity);
+
+void BM_JsonPrint(benchmark::State& state) {
+    const json::Document document(City::Get().GetMakeBaseDocument());
+
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::ostringstream out;
+        json::Print(document, out);
+        bytes = out.str().size();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_JsonPrint);
+
+// Регистрирует разбор каждого входного файла тестов
+void RegisterJsonLoadTests() {
+    const std::filesystem::path input_dir(TRANSPORT_TESTS_INPUT_DIR);
+    if (!std::filesystem::is_directory(input_dir)) {
+        return;
+    }
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(input_dir)) {
+        if (entry.path().filename().string().rfind("input_"s, 0) == 0) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files) {
+        std::ifstream in(file);
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const std::string name = "BM_JsonLoad/"s + file.filename().string();
+        benchmark::RegisterBenchmark(name.c_str(), [text = std::move(text)](benchmark::State& state) {
+            BM_JsonLoad(state, text);
+        });
+    }
+}
+
+// ---------- Маршрутизация ---------------------------------------------------
+
+void BM_BuildRoute(benchmark::State& state) {
+    const City& city = City::Get();
+    const auto& router = transport_graph::TransportRouterGetter::GetRouter(*city.GetHandler().GetRouter());
+    const size_t vertex_count = city.GetHandler().GetGraph()->GetGraph().GetVertexCount();
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<graph::VertexId> vertex(0, vertex_count - 1);
+    std::vector<std::pair<graph::VertexId, graph::VertexId>> pairs(1024);
+    for (auto& [from, to] : pairs) {
+        from = vertex(generator);
+        to = vertex(generator);
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& [from, to] = pairs[i++ % pairs.size()];
+        benchmark::DoNotOptimize(router.BuildRoute(from, to));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BuildRoute);
+
+// ---------- Карта -----------------------------------------------------------
+
+void BM_MapRendererConstruct(benchmark::State& state) {
+    const City& city = City::Get();
+    const map_renderer::MapRendererSettings& settings = *city.GetHandler().GetMapRenderSettings();
+
+    for (auto _ : state) {
+        map_renderer::MapRenderer renderer(settings, city.GetCatalogue().GetStops(), city.GetCatalogue().GetBuses());
+        benchmark::DoNotOptimize(renderer);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MapRendererConstruct)->Unit(benchmark::kMicrosecond);
+
+// ---------- Сериализация ----------------------------------------------------
+
+void BM_SerializeRoundTrip(benchmark::State& state) {
+    const City& city = City::Get();
+    const std::string file_name = city.GetBaseFile() + ".round_trip"s;
+
+    for (auto _ : state) {
+        {
+            std::ofstream out(file_name, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+            transport_serialization::Serialize(out, city.GetHandler());
+        }
+
+        TransportCatalogue catalogue;
+        request_handler::RequestHandler handler(catalogue);
+        std::ifstream in(file_name, std::ifstream::in | std::ifstream::binary);
+        transport_serialization::Deserialize(handler, std::move(in));
+        // граф и роутер загружаются лениво, в замер входит полная загрузка
+        handler.InitRouter();
+        benchmark::DoNotOptimize(catalogue);
+    }
+
+    std::error_code error;
+    const uintmax_t file_size = std::filesystem::file_size(file_name, error);
+    if (!error) {
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(file_size));
+    }
+    std::filesystem::remove(file_name, error);
+}
+BENCHMARK(BM_SerializeRoundTrip)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    RegisterJsonLoadTests();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
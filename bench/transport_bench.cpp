@@ -0,0 +1,323 @@
+#include "city_generator.h"
+
+#include "json_builder.h"
+#include "json_reader.h"
+#include "request_handler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/resource.h>
+
+using namespace std::literals;
+
+// ---------- Подсчёт выделений памяти ----------------------------------------
+
+namespace {
+
+std::atomic<uint64_t> allocation_count{ 0 };
+std::atomic<uint64_t> allocated_bytes{ 0 };
+
+void* CountedAllocate(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+// ---------- Этапы -----------------------------------------------------------
+
+// Результат одного этапа: время, пропускная способность, выделения памяти и пиковый RSS
+struct StageResult {
+    std::string name;
+    double wall_ms = 0.0;
+    size_t items = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    long peak_rss_kb = 0;
+    // задержки отдельных запросов, если этап их измеряет
+    std::vector<double> latencies_ms;
+};
+
+// Количество маршрутов в запросе AlternativeRoutes этапа alternative_routes
+constexpr size_t ALTERNATIVE_ROUTES_COUNT = 3;
+
+long GetPeakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // в Linux ru_maxrss измеряется в килобайтах
+    return usage.ru_maxrss;
+}
+
+StageResult RunStage(std::string name, size_t items, const std::function<void()>& stage) {
+    const uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+    const uint64_t bytes_before = allocated_bytes.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+
+    stage();
+
+    const auto finish = std::chrono::steady_clock::now();
+
+    StageResult result;
+    result.name = std::move(name);
+    result.wall_ms = std::chrono::duration<double, std::milli>(finish - start).count();
+    result.items = items;
+    result.allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+    result.allocated_bytes = allocated_bytes.load(std::memory_order_relaxed) - bytes_before;
+    result.peak_rss_kb = GetPeakRssKb();
+    return result;
+}
+
+// ---------- Параметры командной строки --------------------------------------
+
+void PrintUsage() {
+    std::cerr << "Usage: transport_bench [--stops=N] [--buses=N] [--route-length=N] [--distance-density=N]\n"
+                 "                       [--requests=N] [--maps=N] [--alternatives=N] [--mix=STOP:BUS:ROUTE] [--seed=N]\n"
+                 "                       [--base-file=PATH] [--output=PATH]\n"sv;
+}
+
+struct BenchOptions {
+    bench::CityParams params;
+    std::string base_file = "transport_bench.db"s;
+    std::string output_file;
+};
+
+bool ParseOptions(int argc, const char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        const size_t eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == std::string_view::npos) {
+            return false;
+        }
+        const std::string_view key = arg.substr(2, eq - 2);
+        const std::string value(arg.substr(eq + 1));
+
+        if (key == "stops"sv) {
+            options.params.stop_count = std::stoul(value);
+        }
+        else if (key == "buses"sv) {
+            options.params.bus_count = std::stoul(value);
+        }
+        else if (key == "route-length"sv) {
+            options.params.route_length = std::stoul(value);
+        }
+        else if (key == "distance-density"sv) {
+            options.params.distance_density = std::stoul(value);
+        }
+        else if (key == "requests"sv) {
+            options.params.request_count = std::stoul(value);
+        }
+        else if (key == "maps"sv) {
+            options.params.map_count = std::stoul(value);
+        }
+        else if (key == "alternatives"sv) {
+            options.params.alternative_count = std::stoul(value);
+        }
+        else if (key == "seed"sv) {
+            options.params.seed = static_cast<uint32_t>(std::stoul(value));
+        }
+        else if (key == "mix"sv) {
+            if (std::sscanf(value.c_str(), "%lf:%lf:%lf", &options.params.stop_share,
+                &options.params.bus_share, &options.params.route_share) != 3) {
+                return false;
+            }
+        }
+        else if (key == "base-file"sv) {
+            options.base_file = value;
+        }
+        else if (key == "output"sv) {
+            options.output_file = value;
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------- Отчёт -----------------------------------------------------------
+
+json::Node CreateReport(const BenchOptions& options, const std::vector<StageResult>& stages,
+    size_t make_base_bytes, size_t process_requests_bytes, size_t base_file_bytes) {
+    const bench::CityParams& params = options.params;
+
+    json::Builder builder;
+    builder.StartDict()
+        .Key("parameters"s).StartDict()
+            .Key("stops"s).Value(static_cast<int>(params.stop_count))
+            .Key("buses"s).Value(static_cast<int>(params.bus_count))
+            .Key("route_length"s).Value(static_cast<int>(params.route_length))
+            .Key("distance_density"s).Value(static_cast<int>(params.distance_density))
+            .Key("requests"s).Value(static_cast<int>(params.request_count))
+            .Key("maps"s).Value(static_cast<int>(params.map_count))
+            .Key("alternatives"s).Value(static_cast<int>(params.alternative_count))
+            .Key("mix"s).StartArray()
+                .Value(params.stop_share).Value(params.bus_share).Value(params.route_share)
+            .EndArray()
+            .Key("seed"s).Value(static_cast<int>(params.seed))
+        .EndDict()
+        .Key("sizes"s).StartDict()
+            .Key("make_base_input_bytes"s).Value(static_cast<double>(make_base_bytes))
+            .Key("process_requests_input_bytes"s).Value(static_cast<double>(process_requests_bytes))
+            .Key("base_file_bytes"s).Value(static_cast<double>(base_file_bytes))
+        .EndDict();
+
+    builder.Key("stages"s).StartArray();
+    for (const StageResult& stage : stages) {
+        const double seconds = stage.wall_ms / 1000.0;
+        builder.StartDict()
+            .Key("name"s).Value(std::string(stage.name))
+            .Key("wall_ms"s).Value(stage.wall_ms)
+            .Key("items"s).Value(static_cast<double>(stage.items))
+            .Key("items_per_second"s).Value(seconds > 0.0 ? stage.items / seconds : 0.0)
+            .Key("allocations"s).Value(static_cast<double>(stage.allocations))
+            .Key("allocated_bytes"s).Value(static_cast<double>(stage.allocated_bytes))
+            .Key("peak_rss_kb"s).Value(static_cast<double>(stage.peak_rss_kb));
+        if (!stage.latencies_ms.empty()) {
+            std::vector<double> latencies = stage.latencies_ms;
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile = [&latencies](double share) {
+                return latencies[static_cast<size_t>(share * static_cast<double>(latencies.size() - 1))];
+            };
+            builder.Key("latency_ms"s).StartDict()
+                .Key("p50"s).Value(percentile(0.5))
+                .Key("p99"s).Value(percentile(0.99))
+                .Key("max"s).Value(latencies.back())
+            .EndDict();
+        }
+        builder.EndDict();
+    }
+    builder.EndArray();
+
+    builder.Key("peak_rss_kb"s).Value(static_cast<double>(GetPeakRssKb()));
+    builder.EndDict();
+
+    return builder.Build();
+}
+
+} // namespace
+
+int main(int argc, const char** argv) {
+    BenchOptions options;
+    try {
+        if (!ParseOptions(argc, argv, options)) {
+            PrintUsage();
+            return 1;
+        }
+    }
+    catch (const std::exception&) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<StageResult> stages;
+    std::string make_base_input;
+    std::string process_requests_input;
+
+    stages.push_back(RunStage("generate"s, options.params.stop_count + options.params.bus_count + options.params.request_count,
+        [&]() {
+            make_base_input = bench::ToString(bench::CreateMakeBaseDocument(options.params, options.base_file));
+            process_requests_input = bench::ToString(bench::CreateProcessRequestsDocument(options.params, options.base_file));
+        }));
+
+    stages.push_back(RunStage("make_base"s, options.params.stop_count + options.params.bus_count,
+        [&]() {
+            std::istringstream in(make_base_input);
+            std::ostringstream out;
+            request_handler::RequestHandlerProcess(in, out).ExecuteMakeBaseRequests();
+        }));
+
+    std::string answers;
+    stages.push_back(RunStage("process_requests"s, options.params.request_count + options.params.map_count,
+        [&]() {
+            std::istringstream in(process_requests_input);
+            std::ostringstream out;
+            request_handler::RequestHandlerProcess(in, out).ExecuteProcessRequests();
+            answers = out.str();
+        }));
+
+    // Задержка AlternativeRoutes (алгоритм Йена): база и роутер загружаются до этапа,
+    // измеряется только поиск маршрутов, каждый запрос отдельно
+    if (options.params.alternative_count > 0) {
+        const auto snapshot = request_handler::BaseSnapshot::Load(options.base_file);
+        const request_handler::RequestHandler& handler = snapshot->GetHandler();
+        handler.InitRouter();
+        const auto pairs = bench::CreateAlternativeRoutesPairs(options.params);
+
+        std::vector<double> latencies_ms;
+        latencies_ms.reserve(pairs.size());
+        stages.push_back(RunStage("alternative_routes"s, pairs.size(),
+            [&]() {
+                for (const auto& [from, to] : pairs) {
+                    const auto start = std::chrono::steady_clock::now();
+                    handler.GetAlternativeRoutes(from, to, ALTERNATIVE_ROUTES_COUNT);
+                    latencies_ms.push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count());
+                }
+            }));
+        stages.back().latencies_ms = std::move(latencies_ms);
+    }
+
+    std::error_code error;
+    const uintmax_t base_file_bytes = std::filesystem::file_size(options.base_file, error);
+
+    const json::Node report = CreateReport(options, stages, make_base_input.size(), process_requests_input.size(),
+        error ? 0 : static_cast<size_t>(base_file_bytes));
+
+    // счётчики больше диапазона int выводятся как double, точности по умолчанию для них мало
+    std::ostringstream out;
+    out.precision(15);
+    json::Print(json::Document(report), out);
+    out << '\n';
+
+    if (options.output_file.empty()) {
+        std::cout << out.str();
+    }
+    else {
+        std::ofstream(options.output_file) << out.str();
+    }
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "base_container.h"
+#include "lz4_codec.h"
+
+#include <stdexcept>
+
+namespace base_container {
+
+namespace {
+
+constexpr std::string_view SIGNATURE = "TCSHARDS";
+constexpr uint32_t VERSION = 2;
+// в версии 1 у частей нет поля сжатия
+constexpr uint32_t VERSION_WITHOUT_CODEC = 1;
+constexpr size_t SHARD_HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+constexpr size_t SHARD_HEADER_SIZE_WITHOUT_CODEC = sizeof(uint32_t) + sizeof(uint64_t);
+
+template <typename Number>
+void AppendNumber(std::string& out, Number value) {
+    for (size_t i = 0; i < sizeof(Number); ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+template <typename Number>
+Number ReadNumber(std::string_view& data) {
+    if (data.size() < sizeof(Number)) {
+        throw std::runtime_error("Base file is truncated");
+    }
+    Number value = 0;
+    for (size_t i = 0; i < sizeof(Number); ++i) {
+        value |= static_cast<Number>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    data.remove_prefix(sizeof(Number));
+    return value;
+}
+
+void ReadBytes(std::istream& in, uint64_t offset, std::string& buffer) {
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!in || static_cast<size_t>(in.gcount()) != buffer.size()) {
+        throw std::runtime_error("Base file is truncated");
+    }
+}
+
+} // namespace
+
+bool IsContainer(std::string_view data) {
+    return data.substr(0, SIGNATURE.size()) == SIGNATURE;
+}
+
+bool IsContainer(std::istream& in) {
+    std::string prefix(SIGNATURE.size(), '\0');
+    in.clear();
+    in.seekg(0);
+    in.read(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+    prefix.resize(static_cast<size_t>(in.gcount()));
+
+    in.clear();
+    in.seekg(0);
+    return IsContainer(prefix);
+}
+
+void EncodeShard(ShardKind kind, Codec codec, const google::protobuf::MessageLite& message, std::string& out, std::string& buffer) {
+    const size_t size = message.ByteSizeLong();
+
+    out.clear();
+    AppendNumber(out, static_cast<uint32_t>(kind));
+    AppendNumber(out, static_cast<uint32_t>(codec));
+
+    switch (codec) {
+    case Codec::NONE:
+        AppendNumber(out, static_cast<uint64_t>(size));
+        out.resize(SHARD_HEADER_SIZE + size);
+        message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(out.data() + SHARD_HEADER_SIZE));
+        break;
+    case Codec::LZ4:
+    {
+        buffer.resize(size);
+        message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer.data()));
+        const std::string frame = lz4_codec::CompressFrame(buffer);
+        AppendNumber(out, static_cast<uint64_t>(frame.size()));
+        out += frame;
+        break;
+    }
+    default:
+        throw std::invalid_argument("Unknown base codec");
+    }
+}
+
+void WriteSignature(std::ostream& out) {
+    std::string header(SIGNATURE);
+    AppendNumber(header, VERSION);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+void WriteShard(std::ostream& out, const std::string& shard) {
+    out.write(shard.data(), static_cast<std::streamsize>(shard.size()));
+}
+
+std::vector<ShardLocation> ReadIndex(std::istream& in) {
+    in.clear();
+    in.seekg(0, std::ios::end);
+    const uint64_t file_size = static_cast<uint64_t>(in.tellg());
+
+    std::string buffer(SIGNATURE.size() + sizeof(uint32_t), '\0');
+    ReadBytes(in, 0, buffer);
+
+    std::string_view data = buffer;
+    if (!IsContainer(data)) {
+        throw std::runtime_error("Base file has no shard signature");
+    }
+    data.remove_prefix(SIGNATURE.size());
+
+    const uint32_t version = ReadNumber<uint32_t>(data);
+    if (version != VERSION && version != VERSION_WITHOUT_CODEC) {
+        throw std::runtime_error("Base file has unsupported version");
+    }
+
+    std::vector<ShardLocation> locations;
+    uint64_t offset = buffer.size();
+    buffer.resize(version == VERSION_WITHOUT_CODEC ? SHARD_HEADER_SIZE_WITHOUT_CODEC : SHARD_HEADER_SIZE);
+    while (offset < file_size) {
+        if (file_size - offset < buffer.size()) {
+            throw std::runtime_error("Base file is truncated");
+        }
+        ReadBytes(in, offset, buffer);
+        offset += buffer.size();
+
+        data = buffer;
+        ShardLocation location;
+        location.kind = static_cast<ShardKind>(ReadNumber<uint32_t>(data));
+        location.codec = version == VERSION_WITHOUT_CODEC ? Codec::NONE : static_cast<Codec>(ReadNumber<uint32_t>(data));
+        location.size = ReadNumber<uint64_t>(data);
+        location.offset = offset;
+        if (location.size > file_size - offset) {
+            throw std::runtime_error("Base file is truncated");
+        }
+
+        locations.push_back(location);
+        offset += location.size;
+    }
+
+    return locations;
+}
+
+Shard ReadShard(std::istream& in, const ShardLocation& location, std::string& buffer) {
+    buffer.resize(location.size);
+    ReadBytes(in, location.offset, buffer);
+    return { location.kind, location.codec, buffer };
+}
+
+std::string_view Unpack(const Shard& shard, std::string& buffer) {
+    switch (shard.codec) {
+    case Codec::NONE:
+        return shard.data;
+    case Codec::LZ4:
+        lz4_codec::DecompressFrame(shard.data, buffer);
+        return buffer;
+    default:
+        throw std::runtime_error("Base file has unknown codec");
+    }
+}
+
+} // namespace base_container
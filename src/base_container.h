@@ -0,0 +1,77 @@
+#pragma once
+
+#include <google/protobuf/message_lite.h>
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace base_container {
+
+/*
+* Файл базы из независимых частей. После сигнатуры и версии формата части идут подряд,
+* у каждой части заголовок: вид (4 байта), способ сжатия (4 байта) и длина содержимого (8 байт), числа little-endian.
+* Содержимое части - отдельное protobuf-сообщение, возможно сжатое, поэтому части кодируются,
+* сжимаются и разбираются параллельно. В версии 1 формата поля сжатия нет, такие базы читаются как несжатые.
+* Заголовки частей служат оглавлением: по ним части находятся в файле без чтения содержимого.
+* Базы прежнего формата (одно сообщение TransportCatalogue) сигнатуры не имеют
+*/
+
+enum class ShardKind : uint32_t {
+    HEADER = 1,          // TransportCatalogue без остановок, маршрутов, рёбер и таблицы маршрутизатора
+    STOPS = 2,           // StopsShard
+    BUSES = 3,           // BusesShard
+    GRAPH_EDGES = 4,     // GraphEdgesShard
+    GRAPH_INCIDENCE = 5, // GraphIncidenceShard
+    ROUTER_ROWS = 6      // RouterRowsShard
+};
+
+enum class Codec : uint32_t {
+    NONE = 0, // сообщение хранится как есть
+    LZ4 = 1   // сообщение сжато в кадр LZ4
+};
+
+struct Shard {
+    ShardKind kind = ShardKind::HEADER;
+    Codec codec = Codec::NONE;
+    std::string_view data;
+};
+
+// Положение содержимого части в файле базы
+struct ShardLocation {
+    ShardKind kind = ShardKind::HEADER;
+    Codec codec = Codec::NONE;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+// Функция проверяет, что данные начинаются с сигнатуры базы из частей
+bool IsContainer(std::string_view data);
+
+// Функция проверяет, что поток начинается с сигнатуры базы из частей, и возвращает чтение в начало
+bool IsContainer(std::istream& in);
+
+// Функция кодирует сообщение в часть вместе с её заголовком, при необходимости сжимая его.
+// Память строк out и buffer переиспользуется
+void EncodeShard(ShardKind kind, Codec codec, const google::protobuf::MessageLite& message, std::string& out, std::string& buffer);
+
+// Функция записывает сигнатуру и версию формата, с них начинается файл
+void WriteSignature(std::ostream& out);
+
+// Функция записывает закодированную часть одним вызовом, мимо буфера потока
+void WriteShard(std::ostream& out, const std::string& shard);
+
+// Функция читает оглавление базы: заголовки частей в порядке записи, содержимое пропускается.
+// При повреждённых данных бросает std::runtime_error
+std::vector<ShardLocation> ReadIndex(std::istream& in);
+
+// Функция читает содержимое части в buffer и возвращает часть, ссылающуюся на него
+Shard ReadShard(std::istream& in, const ShardLocation& location, std::string& buffer);
+
+// Функция возвращает содержимое части. Сжатое содержимое раскодируется в buffer
+std::string_view Unpack(const Shard& shard, std::string& buffer);
+
+} // namespace base_container
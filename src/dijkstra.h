@@ -0,0 +1,213 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    /*
+    * Поиск кратчайших путей из одной вершины алгоритмом Дейкстры.
+    * Состояние поиска переиспользуется между запусками: вершины прошлого поиска
+    * помечены старой меткой, поэтому сброс не требует обхода всех вершин.
+    * Отдельные рёбра и вершины можно исключить из поиска, исключения действуют до ClearBlocked
+    */
+    template <typename Weight>
+    class Dijkstra {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        explicit Dijkstra(const Graph& graph)
+            : graph_(graph)
+            , vertices_(graph.GetVertexCount()) {
+        }
+
+        // Метод начинает новый поиск из вершины source
+        void Start(VertexId source) {
+            if (++stamp_ == 0) {
+                // после переполнения метки старые пометки могли бы совпасть с новыми
+                std::fill(vertices_.begin(), vertices_.end(), VertexData{});
+                stamp_ = 1;
+            }
+            queue_.clear();
+            Reach(source, ZERO_WEIGHT, NO_EDGE);
+        }
+
+        // Метод фиксирует ближайшую ещё не зафиксированную вершину и возвращает её.
+        // Если достижимых вершин больше нет, возвращает nullopt
+        std::optional<VertexId> SettleNext() {
+            while (!queue_.empty()) {
+                std::pop_heap(queue_.begin(), queue_.end(), std::greater<>{});
+                const auto [weight, vertex] = queue_.back();
+                queue_.pop_back();
+
+                VertexData& data = vertices_[vertex];
+                if (data.settled || weight > data.weight) {
+                    continue;
+                }
+                data.settled = true;
+
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                    const auto& edge = graph_.GetEdge(edge_id);
+                    if (has_blocked_ && IsBlocked(edge_id, edge.to)) {
+                        continue;
+                    }
+                    Reach(edge.to, weight + edge.weight, edge_id);
+                }
+                return vertex;
+            }
+            return std::nullopt;
+        }
+
+        // Метод возвращает вес ближайшей незафиксированной вершины, если она есть
+        std::optional<Weight> PeekWeight() {
+            while (!queue_.empty()) {
+                const auto& [weight, vertex] = queue_.front();
+                const VertexData& data = vertices_[vertex];
+                if (!data.settled && weight <= data.weight) {
+                    return weight;
+                }
+                std::pop_heap(queue_.begin(), queue_.end(), std::greater<>{});
+                queue_.pop_back();
+            }
+            return std::nullopt;
+        }
+
+        // Метод выполняет поиск до конца
+        void Run(VertexId source) {
+            Start(source);
+            while (SettleNext()) {
+            }
+        }
+
+        // Метод ищет кратчайший путь до вершины target и возвращает, найден ли он
+        bool RunTo(VertexId source, VertexId target) {
+            Start(source);
+            while (!IsSettled(target)) {
+                if (!SettleNext()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Метод ищет кратчайший путь до вершины target не тяжелее max_weight и возвращает, найден ли он.
+        // Вершины дальше max_weight не фиксируются
+        bool RunTo(VertexId source, VertexId target, Weight max_weight) {
+            Start(source);
+            while (!IsSettled(target)) {
+                const auto weight = PeekWeight();
+                if (!weight || *weight > max_weight) {
+                    return false;
+                }
+                SettleNext();
+            }
+            return true;
+        }
+
+        // Метод возвращает рёбра найденного пути до достигнутой вершины в порядке от начальной
+        std::vector<EdgeId> GetPath(VertexId vertex) const {
+            std::vector<EdgeId> edges;
+            for (EdgeId edge_id = GetPrevEdge(vertex); edge_id != NO_EDGE; edge_id = GetPrevEdge(graph_.GetEdge(edge_id).from)) {
+                edges.push_back(edge_id);
+            }
+            std::reverse(edges.begin(), edges.end());
+            return edges;
+        }
+
+        // Метод исключает ребро из следующих поисков
+        void BlockEdge(EdgeId edge_id) {
+            if (blocked_edges_.empty()) {
+                blocked_edges_.assign(graph_.GetEdgeCount(), 0);
+            }
+            blocked_edges_[edge_id] = block_stamp_;
+            has_blocked_ = true;
+        }
+
+        // Метод исключает вершину из следующих поисков, кроме поисков из неё самой
+        void BlockVertex(VertexId vertex) {
+            if (blocked_vertices_.empty()) {
+                blocked_vertices_.assign(graph_.GetVertexCount(), 0);
+            }
+            blocked_vertices_[vertex] = block_stamp_;
+            has_blocked_ = true;
+        }
+
+        // Метод снимает все исключения
+        void ClearBlocked() {
+            if (++block_stamp_ == 0) {
+                std::fill(blocked_edges_.begin(), blocked_edges_.end(), 0);
+                std::fill(blocked_vertices_.begin(), blocked_vertices_.end(), 0);
+                block_stamp_ = 1;
+            }
+            has_blocked_ = false;
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return vertices_[vertex].stamp == stamp_;
+        }
+
+        bool IsSettled(VertexId vertex) const {
+            return IsReached(vertex) && vertices_[vertex].settled;
+        }
+
+        // Вес найденного пути до вершины. Вызывается только для достигнутых вершин
+        Weight GetWeight(VertexId vertex) const {
+            return vertices_[vertex].weight;
+        }
+
+        // Последнее ребро найденного пути до вершины, NO_EDGE для начальной вершины
+        EdgeId GetPrevEdge(VertexId vertex) const {
+            return vertices_[vertex].prev_edge;
+        }
+
+    private:
+        struct VertexData {
+            Weight weight{};
+            EdgeId prev_edge = NO_EDGE;
+            uint32_t stamp = 0;
+            bool settled = false;
+        };
+
+        bool IsBlocked(EdgeId edge_id, VertexId to) const {
+            return (!blocked_edges_.empty() && blocked_edges_[edge_id] == block_stamp_)
+                || (!blocked_vertices_.empty() && blocked_vertices_[to] == block_stamp_);
+        }
+
+        void Reach(VertexId vertex, Weight weight, EdgeId prev_edge) {
+            VertexData& data = vertices_[vertex];
+            if (data.stamp != stamp_) {
+                data = { weight, prev_edge, stamp_, false };
+            }
+            else if (!data.settled && weight < data.weight) {
+                data.weight = weight;
+                data.prev_edge = prev_edge;
+            }
+            else {
+                return;
+            }
+            queue_.push_back({ weight, vertex });
+            std::push_heap(queue_.begin(), queue_.end(), std::greater<>{});
+        }
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        std::vector<VertexData> vertices_;
+        std::vector<std::pair<Weight, VertexId>> queue_;
+        uint32_t stamp_ = 0;
+        std::vector<uint32_t> blocked_edges_;
+        std::vector<uint32_t> blocked_vertices_;
+        uint32_t block_stamp_ = 1;
+        bool has_blocked_ = false;
+    };
+
+}  // namespace graph
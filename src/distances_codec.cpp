@@ -0,0 +1,122 @@
+#include "distances_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace distances_codec {
+
+namespace {
+
+// Расстояния не больше 2^52 метров точно представимы в double
+constexpr double MAX_INTEGER_DISTANCE = 4503599627370496.0;
+constexpr uint64_t FRACTIONAL_FLAG = 1;
+
+void WriteVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t ReadVarint(std::string_view& data) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (data.empty()) {
+            throw std::runtime_error("Road distances are truncated");
+        }
+        const uint8_t byte = static_cast<uint8_t>(data.front());
+        data.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Road distances contain an invalid varint");
+}
+
+void WriteDistance(std::string& out, double distance) {
+    if (distance >= 0.0 && distance <= MAX_INTEGER_DISTANCE && std::floor(distance) == distance) {
+        WriteVarint(out, static_cast<uint64_t>(distance) << 1);
+        return;
+    }
+
+    // битовое представление double пишется в порядке little-endian на любой платформе
+    static_assert(sizeof(double) == sizeof(uint64_t));
+    uint64_t bits = 0;
+    std::memcpy(&bits, &distance, sizeof(bits));
+    WriteVarint(out, FRACTIONAL_FLAG);
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+        out.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+}
+
+double ReadDistance(std::string_view& data) {
+    const uint64_t code = ReadVarint(data);
+    if (code != FRACTIONAL_FLAG) {
+        return static_cast<double>(code >> 1);
+    }
+
+    uint64_t bits = 0;
+    if (data.size() < sizeof(bits)) {
+        throw std::runtime_error("Road distances are truncated");
+    }
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+        bits |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    data.remove_prefix(sizeof(bits));
+
+    double distance = 0.0;
+    std::memcpy(&distance, &bits, sizeof(distance));
+    return distance;
+}
+
+} // namespace
+
+std::string Encode(std::vector<Neighbour> neighbours) {
+    std::sort(neighbours.begin(), neighbours.end(), [](const Neighbour& lhs, const Neighbour& rhs) {
+        return lhs.id < rhs.id;
+    });
+
+    std::string out;
+    WriteVarint(out, neighbours.size());
+
+    uint32_t previous_id = 0;
+    for (const Neighbour& neighbour : neighbours) {
+        WriteVarint(out, neighbour.id - previous_id);
+        WriteDistance(out, neighbour.distance);
+        previous_id = neighbour.id;
+    }
+
+    return out;
+}
+
+std::vector<Neighbour> Decode(std::string_view data) {
+    const uint64_t count = ReadVarint(data);
+    // каждый сосед занимает хотя бы два байта
+    if (count > data.size() / 2) {
+        throw std::runtime_error("Road distances are truncated");
+    }
+
+    std::vector<Neighbour> neighbours;
+    neighbours.reserve(count);
+
+    uint64_t id = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        id += ReadVarint(data);
+        if (id > UINT32_MAX) {
+            throw std::runtime_error("Road distances contain an invalid stop id");
+        }
+        neighbours.push_back({ static_cast<uint32_t>(id), ReadDistance(data) });
+    }
+
+    if (!data.empty()) {
+        throw std::runtime_error("Road distances contain trailing bytes");
+    }
+
+    return neighbours;
+}
+
+} // namespace distances_codec
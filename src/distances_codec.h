@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace distances_codec {
+
+/*
+* Компактная запись списка соседей остановки для базы.
+* Соседи упорядочены по номеру, номер записывается разностью с предыдущим,
+* все числа - varint. Целое расстояние в метрах занимает varint (метры << 1),
+* дробное - флаг 1 и восемь байт битового представления double в порядке little-endian,
+* поэтому запись не теряет точности и читается на любой платформе
+*/
+
+struct Neighbour {
+    uint32_t id = 0;
+    double distance = 0.0;
+};
+
+// Функция кодирует соседей остановки, порядок соседей во входном массиве не важен
+std::string Encode(std::vector<Neighbour> neighbours);
+
+// Функция раскодирует соседей в порядке возрастания номера. При повреждённых данных бросает std::runtime_error
+std::vector<Neighbour> Decode(std::string_view data);
+
+} // namespace distances_codec
@@ -1,5 +1,7 @@
 #include "domain.h"
 
+#include "distances_codec.h"
+
 #include <algorithm>
 #include <iomanip>
 #include <numeric>
@@ -38,6 +40,12 @@ const Stop* Catalogue::Push(std::string&& name, Coordinates&& coord) {
     return stop;
 }
 
+const Stop* Catalogue::Push(Stop&& stop_value) {
+    const Stop* stop = CatalogueTemplate::PushData(std::move(stop_value));
+    stop_buses_.insert({ stop, {} });
+    return stop;
+}
+
 const Stop* Catalogue::Push(size_t id, std::string&& name, Coordinates&& coord) {
     const Stop* stop = CatalogueTemplate::PushData(id, { std::move(name), std::move(coord) });
     stop_buses_.insert({ stop, {} });
@@ -55,6 +63,8 @@ void Catalogue::PushBusToStop(const Stop* stop, const std::string_view& bus_name
 }
 
 void Catalogue::AddDistance(const Stop* stop_1, const Stop* stop_2, double distance) {
+    LoadEncodedDistances();
+
     PointerPair<Stop> stop_pair_direct = { stop_1, stop_2 };
     PointerPair<Stop> stop_pair_reverse = { stop_2, stop_1 };
 
@@ -65,6 +75,74 @@ void Catalogue::AddDistance(const Stop* stop_1, const Stop* stop_2, double dista
     }
 }
 
+std::vector<std::string> Catalogue::EncodeDistances() const {
+    std::vector<std::vector<distances_codec::Neighbour>> neighbours(Size());
+    for (const auto& [stops, distance] : GetDistances()) {
+        const size_t from = GetId(stops.first);
+        if (from >= neighbours.size()) {
+            neighbours.resize(from + 1);
+        }
+        neighbours[from].push_back({ static_cast<uint32_t>(GetId(stops.second)), distance });
+    }
+
+    std::vector<std::string> encoded(neighbours.size());
+    for (size_t id = 0; id < neighbours.size(); ++id) {
+        if (!neighbours[id].empty()) {
+            encoded[id] = distances_codec::Encode(std::move(neighbours[id]));
+        }
+    }
+    return encoded;
+}
+
+void Catalogue::AddEncodedDistances(size_t id, std::string&& encoded) {
+    std::lock_guard guard(distances_mutex_);
+    encoded_distances_.emplace_back(id, std::move(encoded));
+    has_encoded_distances_ = true;
+}
+
+void Catalogue::LoadEncodedDistances() const {
+    if (!has_encoded_distances_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::lock_guard guard(distances_mutex_);
+    if (!has_encoded_distances_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    for (const auto& [id, encoded] : encoded_distances_) {
+        const auto stop_from = At(id);
+        if (!stop_from) {
+            throw std::logic_error("Couldn't find stop for road distances");
+        }
+        for (const distances_codec::Neighbour& neighbour : distances_codec::Decode(encoded)) {
+            const auto stop_to = At(neighbour.id);
+            if (!stop_to) {
+                throw std::logic_error("Couldn't find stop for road distances");
+            }
+            distances_between_stops_[{ *stop_from, *stop_to }] = neighbour.distance;
+        }
+    }
+
+    encoded_distances_.clear();
+    encoded_distances_.shrink_to_fit();
+    has_encoded_distances_.store(false, std::memory_order_release);
+}
+
+void Catalogue::AddMemoryUsage(memory_usage::Report& report) const {
+    using memory_usage::HeapSize;
+    CatalogueTemplate::AddMemoryUsage(report, "stops");
+    report.Add("stops.stop_buses", HeapSize(stop_buses_), stop_buses_.size());
+
+    std::lock_guard guard(distances_mutex_);
+    report.Add("stops.distances_between_stops", HeapSize(distances_between_stops_), distances_between_stops_.size());
+    report.Add("stops.encoded_distances", HeapSize(encoded_distances_), encoded_distances_.size());
+}
+
+size_t HeapSize(const Stop& stop) {
+    return memory_usage::HeapSize(stop.name);
+}
+
 } // namespace stop_catalogue
 
 // ----------------------------------------------------------------------------
@@ -169,6 +247,10 @@ std::ostream& operator<<(std::ostream& out, const Bus& bus) {
     return out;
 }
 
+size_t HeapSize(const Bus& bus) {
+    return memory_usage::HeapSize(bus.name) + memory_usage::HeapSize(bus.route);
+}
+
 } // namespace bus_catalogue
 
 // ----------------------------------------------------------------------------
@@ -1,15 +1,23 @@
 #pragma once
 
 #include "geo.h"
+#include "memory_usage.h"
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <deque>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <set>
+#include <string>
 #include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace transport_catalogue {
 
@@ -86,6 +94,15 @@ public:
         return data_to_id_.at(data);
     }
 
+    // Метод добавляет в отчёт память, занятую данными каталога и его индексами
+    void AddMemoryUsage(memory_usage::Report& report, const std::string& prefix) const {
+        using memory_usage::HeapSize;
+        report.Add(prefix + ".data", HeapSize(data_), data_.size());
+        report.Add(prefix + ".name_to_data", HeapSize(name_to_data_), name_to_data_.size());
+        report.Add(prefix + ".id_to_data", HeapSize(id_to_data_), id_to_data_.size());
+        report.Add(prefix + ".data_to_id", HeapSize(data_to_id_), data_to_id_.size());
+    }
+
     auto begin() const {
         return name_to_data_.begin();
     }
@@ -101,6 +118,65 @@ private:
     std::unordered_map<const Type*, size_t> data_to_id_ = {};
 };
 
+// 64-bitный FNV-1a: в отличие от std::hash даёт одинаковый результат
+// на разных платформах, поэтому годится для ключей, сохраняемых в базе.
+// Числа хешируются восемью байтами в порядке little-endian: целые расширяются
+// до 64 бит, дробные - до double, поэтому ключ не зависит от размера size_t и порядка байтов
+class Fnv1aHasher {
+public:
+    Fnv1aHasher& Add(const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            AddByte(bytes[i]);
+        }
+        return *this;
+    }
+
+    Fnv1aHasher& Add(std::string_view str) {
+        Add(static_cast<uint64_t>(str.size()));
+        return Add(str.data(), str.size());
+    }
+
+    template <typename Number, std::enable_if_t<std::is_arithmetic_v<Number>, bool> = true>
+    Fnv1aHasher& Add(Number value) {
+        if constexpr (std::is_floating_point_v<Number>) {
+            static_assert(sizeof(double) == sizeof(uint64_t));
+            const double double_value = static_cast<double>(value);
+            uint64_t bits = 0;
+            std::memcpy(&bits, &double_value, sizeof(bits));
+            return AddUint64(bits);
+        }
+        else if constexpr (std::is_signed_v<Number>) {
+            return AddUint64(static_cast<uint64_t>(static_cast<int64_t>(value)));
+        }
+        else {
+            return AddUint64(static_cast<uint64_t>(value));
+        }
+    }
+
+    uint64_t Get() const {
+        return hash_;
+    }
+
+private:
+    void AddByte(unsigned char byte) {
+        hash_ ^= byte;
+        hash_ *= PRIME;
+    }
+
+    Fnv1aHasher& AddUint64(uint64_t value) {
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            AddByte(static_cast<unsigned char>(value >> (8 * i)));
+        }
+        return *this;
+    }
+
+    static constexpr uint64_t OFFSET_BASIS = 14695981039346656037ull;
+    static constexpr uint64_t PRIME = 1099511628211ull;
+
+    uint64_t hash_ = OFFSET_BASIS;
+};
+
 template <typename Pointer>
 using PointerPair = std::pair<const Pointer*, const Pointer*>;
 
@@ -123,6 +199,8 @@ namespace stop_catalogue {
 struct Stop {
     std::string name;
     Coordinates coord;
+    // Время ожидания автобуса на остановке, если оно отличается от общего
+    std::optional<int> bus_wait_time = std::nullopt;
 
     bool operator== (const Stop& other) const {
         return name == other.name;
@@ -133,6 +211,9 @@ struct Stop {
     }
 };
 
+// Память, занятая остановкой в куче
+size_t HeapSize(const Stop& stop);
+
 using BusesToStopNames = std::set<std::string_view>;
 using DistancesContainer = std::unordered_map<detail::PointerPair<Stop>, double, detail::PointerPairHasher<Stop>>;
 
@@ -146,6 +227,8 @@ public:
 
     const Stop* Push(std::string&& name, Coordinates&& coord);
 
+    const Stop* Push(Stop&& stop_value);
+
     const Stop* Push(size_t id, std::string&& name, Coordinates&& coord);
 
     const Stop* Push(size_t id, Stop&& stop_value);
@@ -159,16 +242,34 @@ public:
     }
 
     const DistancesContainer& GetDistances() const {
+        LoadEncodedDistances();
         return distances_between_stops_;
     }
 
+    // Метод возвращает закодированные списки соседей остановок по их номерам в каталоге
+    std::vector<std::string> EncodeDistances() const;
+
+    // Метод запоминает закодированный список соседей остановки.
+    // Расстояния раскодируются при первом обращении к ним, когда загружены все остановки
+    void AddEncodedDistances(size_t id, std::string&& encoded);
+
     bool IsEmpty(const Stop* stop) const {
         return stop_buses_.count(stop) == 0 || stop_buses_.at(stop).empty();
     }
 
+    // Метод добавляет в отчёт память, занятую остановками, маршрутами остановок и расстояниями
+    void AddMemoryUsage(memory_usage::Report& report) const;
+
+private:
+    // Метод раскодирует отложенные списки соседей. Потокобезопасен, как и чтение расстояний
+    void LoadEncodedDistances() const;
+
 private:
     std::unordered_map<const Stop*, BusesToStopNames> stop_buses_ = {};
-    DistancesContainer distances_between_stops_ = {};
+    mutable DistancesContainer distances_between_stops_ = {};
+    mutable std::vector<std::pair<size_t, std::string>> encoded_distances_ = {};
+    mutable std::atomic_bool has_encoded_distances_ = false;
+    mutable std::mutex distances_mutex_;
 };
 
 } // namespace stop_catalogue
@@ -185,11 +286,15 @@ struct Bus {
     double route_true_length = 0.0;
     size_t stops_on_route = 0;
     size_t unique_stops = 0;
+    // Общие настройки маршрутов, скорость может быть задана для маршрута отдельно
     RouteSettings route_settings = {};
 
     Bus() = default;
 };
 
+// Память, занятая маршрутом в куче
+size_t HeapSize(const Bus& bus);
+
 class BusHelper {
 public:
     BusHelper& SetName(std::string&& name) {
@@ -239,6 +344,11 @@ public:
         return settings_;
     }
 
+    // Метод добавляет в отчёт память, занятую маршрутами
+    void AddMemoryUsage(memory_usage::Report& report) const {
+        CatalogueTemplate::AddMemoryUsage(report, "buses");
+    }
+
 private:
     RouteSettings settings_ = {};
 };
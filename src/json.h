@@ -27,12 +27,17 @@ using Array = std::vector<Node>;
 
 class NodePrinterHelper {
 public:
-    explicit NodePrinterHelper(std::ostream& out, char c = ' ')
+    explicit NodePrinterHelper(std::ostream& out, char c = ' ', bool compact = false)
         : out_(out)
-        , c_(c) {
+        , c_(c)
+        , compact_(compact) {
     }
 
     void PrintIndent() const {
+        if (compact_) {
+            is_map_value_ = false;
+            return;
+        }
         if (!is_map_value_) {
             for (size_t i = 0; i < indent_; ++i) {
                 out_ << c_;
@@ -45,26 +50,28 @@ public:
 
     void StartArray() const {
         PrintIndent();
-        out_ << '[' << '\n';
+        out_ << '[';
+        NewLine();
         indent_ += indent_step_;
     }
 
     void FinishArray() const {
         indent_ -= indent_step_;
-        out_ << '\n';
+        NewLine();
         PrintIndent();
         out_ << ']';
     }
 
     void StartMap() const {
         PrintIndent();
-        out_ << '{' << '\n';
+        out_ << '{';
+        NewLine();
         indent_ += indent_step_;
     }
 
     void FinishMap() const {
         indent_ -= indent_step_;
-        out_ << '\n';
+        NewLine();
         PrintIndent();
         out_ << '}';
     }
@@ -84,16 +91,27 @@ public:
     }
 
     void NextMapPair() const {
-        out_ << ',' << '\n';
+        out_ << ',';
+        NewLine();
     }
 
     void NextArrayValue() const {
-        out_ << ',' << '\n';
+        out_ << ',';
+        NewLine();
+    }
+
+private:
+    //          
+    void NewLine() const {
+        if (!compact_) {
+            out_ << '\n';
+        }
     }
 
 private:
     std::ostream& out_;
     char c_;
+    bool compact_ = false;
     mutable size_t indent_ = 0;
     mutable bool is_map_value_ = false;
     size_t indent_step_ = 4;
@@ -108,9 +126,9 @@ struct NodePrinter {
     void operator() (const Array& value) const;
     void operator() (const Dict& value) const;
 
-    NodePrinter(std::ostream& out)
+    NodePrinter(std::ostream& out, bool compact = false)
         : out(out)
-        , helper(NodePrinterHelper(out)) {
+        , helper(NodePrinterHelper(out, ' ', compact)) {
     }
 
     std::ostream& out;
@@ -56,10 +56,10 @@ Builder& Builder::Value(Node::Value&& value) {
         value.push_back(std::move(node));
     }
     else if (nodes_stack_.back()->IsString() && dict_counter_ > 0) {
-        Node key_node = *nodes_stack_.back();
+        std::string key = std::move(nodes_stack_.back()->AsString());
         nodes_stack_.pop_back();
         Dict& value = nodes_stack_.back()->AsDict();
-        value.insert({ key_node.AsString(), std::move(node) });
+        value.emplace(std::move(key), std::move(node));
     }
     else {
         throw std::logic_error("All objects have been done");
@@ -90,7 +90,7 @@ Builder& Builder::EndDict() {
         throw std::logic_error("EndDict method could only \"end\" the Dict");
     }
     dict_counter_--;
-    Dict value = nodes_stack_.back()->AsDict();
+    Dict value = std::move(nodes_stack_.back()->AsDict());
     nodes_stack_.pop_back();
     return Value(std::move(value));
 }
@@ -100,7 +100,7 @@ Builder& Builder::EndArray() {
         throw std::logic_error("EndArray method could only \"end\" the Array");
     }
     array_counter_--;
-    Array value = nodes_stack_.back()->AsArray();
+    Array value = std::move(nodes_stack_.back()->AsArray());
     nodes_stack_.pop_back();
     return Value(std::move(value));
 }
@@ -121,9 +121,9 @@ Node Builder::Build() {
     if (dict_counter_ > 0) {
         throw std::logic_error("Some Dict(map) are not closed");
     }
-    root_ = *nodes_stack_.back();
+    Node root = std::move(*nodes_stack_.back());
     nodes_stack_.pop_back();
-    return root_;
+    return root;
 }
 
 // ----------------------------------------------------------------------------
@@ -65,7 +65,6 @@ public:
     Node Build();
 
 private:
-    Node root_;
     std::vector<std::unique_ptr<Node>> nodes_stack_;
     int array_counter_ = 0;
     int dict_counter_ = 0;
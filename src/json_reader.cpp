@@ -1,4 +1,5 @@
 #include "json_reader.h"
+#include "metrics.h"
 
 #include <map>
 #include <set>
@@ -278,10 +279,23 @@ void Print(const Document& doc, std::ostream& output) {
     std::visit(NodePrinter{ output }, doc.GetRoot().Data());
 }
 
+void PrintCompact(const Document& doc, std::ostream& output) {
+    std::visit(NodePrinter{ output, true }, doc.GetRoot().Data());
+}
+
 // ---------- Reader ----------------------------------------------------------
 
+namespace {
+
+Document LoadWithMetrics(std::istream& input) {
+    METRICS_SCOPE(metrics::Stage::PARSE);
+    return Load(input);
+}
+
+} // namespace
+
 Reader::Reader(std::istream& input)
-    : doc_(std::move(json::Load(input))) {
+    : doc_(LoadWithMetrics(input)) {
     using namespace std::string_literals;
 
     const json::Dict& input_requests = doc_.GetRoot().AsMap();
@@ -30,6 +30,9 @@ Document Load(std::istream& input);
 
 void Print(const Document& doc, std::ostream& output);
 
+//     ,     
+void PrintCompact(const Document& doc, std::ostream& output);
+
 // ---------- Reader ----------------------------------------------------------
 
 class Reader {
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "dijkstra.h"
+#include "graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    /*
+    * Кратчайшие пути без повторяющихся вершин в порядке возрастания веса, алгоритм Йена.
+    * Каждый следующий путь получается из уже найденных: от каждой вершины последнего пути
+    * ищется ответвление, не совпадающее с найденными путями с тем же началом.
+    * Все поиски выполняются одним объектом Dijkstra, его состояние переиспользуется.
+    * Без ограничений k путей длиной до L рёбер стоят O(k * L * E log V). Если задано наибольшее
+    * количество путей max_paths, кандидат тяжелее кандидата с номером, равным числу ещё не выданных
+    * путей, уже не будет выдан: поиск ответвления останавливается на его весе, а вершины, вес
+    * начала пути до которых больше него, не просматриваются. Выдаваемые пути от этого не меняются
+    */
+    template <typename Weight>
+    class KShortestPaths {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        struct Path {
+            Weight weight{};
+            std::vector<EdgeId> edges;
+        };
+
+        static constexpr size_t NO_LIMIT = std::numeric_limits<size_t>::max();
+
+        KShortestPaths(const Graph& graph, VertexId from, VertexId to, size_t max_paths = NO_LIMIT)
+            : graph_(graph)
+            , search_(graph)
+            , from_(from)
+            , to_(to)
+            , max_paths_(max_paths) {
+        }
+
+        // Кратчайший путь уже известен (например, из таблицы Router), он будет возвращён первым
+        KShortestPaths(const Graph& graph, VertexId from, VertexId to, std::vector<EdgeId> shortest_path,
+            size_t max_paths = NO_LIMIT)
+            : KShortestPaths(graph, from, to, max_paths) {
+            shortest_path_ = std::move(shortest_path);
+        }
+
+        // Метод возвращает следующий по весу путь или nullopt, если путей больше нет
+        // или уже выдано max_paths путей
+        std::optional<Path> Next() {
+            if (paths_.size() >= max_paths_) {
+                return std::nullopt;
+            }
+            if (paths_.empty()) {
+                if (shortest_path_) {
+                    AddCandidate({}, *shortest_path_);
+                }
+                else if (search_.RunTo(from_, to_)) {
+                    AddCandidate({}, search_.GetPath(to_));
+                }
+                else {
+                    return std::nullopt;
+                }
+            }
+            else {
+                AddSpurCandidates(paths_.back());
+            }
+
+            if (candidates_.empty()) {
+                return std::nullopt;
+            }
+
+            auto best = std::min_element(candidates_.begin(), candidates_.end(),
+                [](const Path& lhs, const Path& rhs) {
+                    return std::tie(lhs.weight, lhs.edges) < std::tie(rhs.weight, rhs.edges);
+                });
+            paths_.push_back(std::move(*best));
+            candidates_.erase(best);
+
+            return paths_.back();
+        }
+
+    private:
+        // Вершина пути с номером position: начальная или конец ребра position - 1
+        VertexId GetPathVertex(const Path& path, size_t position) const {
+            return position == 0 ? from_ : graph_.GetEdge(path.edges[position - 1]).to;
+        }
+
+        // Вес, тяжелее которого кандидат уже не будет выдан: вес кандидата с номером needed
+        // по возрастанию, где needed - сколько путей ещё можно выдать
+        Weight GetCandidateBound() {
+            const size_t needed = max_paths_ - paths_.size();
+            if (candidates_.size() < needed) {
+                return INFINITE_WEIGHT;
+            }
+            candidate_weights_.clear();
+            for (const Path& candidate : candidates_) {
+                candidate_weights_.push_back(candidate.weight);
+            }
+            std::nth_element(candidate_weights_.begin(), candidate_weights_.begin() + (needed - 1), candidate_weights_.end());
+            return candidate_weights_[needed - 1];
+        }
+
+        void AddSpurCandidates(const Path& path) {
+            // вес начала пути до вершины ответвления, суммируется в порядке рёбер, как вес кандидата
+            Weight root_weight{};
+            for (size_t spur = 0; spur < path.edges.size(); ++spur) {
+                const Weight bound = GetCandidateBound();
+                // вес начала пути с ростом spur не убывает, дальше ответвления только тяжелее
+                if (root_weight > bound) {
+                    break;
+                }
+
+                search_.ClearBlocked();
+
+                // рёбра, которыми найденные пути с тем же началом уходят из вершины ответвления
+                for (const Path& found : paths_) {
+                    if (found.edges.size() > spur
+                        && std::equal(path.edges.begin(), path.edges.begin() + spur, found.edges.begin())) {
+                        search_.BlockEdge(found.edges[spur]);
+                    }
+                }
+                // вершины начала пути, чтобы ответвление не возвращалось в них
+                for (size_t position = 0; position < spur; ++position) {
+                    search_.BlockVertex(GetPathVertex(path, position));
+                }
+
+                // запас покрывает разный порядок сложения весов в поиске и в кандидате
+                const Weight max_spur_weight = bound - root_weight + std::abs(bound) * BOUND_TOLERANCE;
+                if (search_.RunTo(GetPathVertex(path, spur), to_, max_spur_weight)) {
+                    std::vector<EdgeId> edges(path.edges.begin(), path.edges.begin() + spur);
+                    AddCandidate(std::move(edges), search_.GetPath(to_));
+                }
+                root_weight += graph_.GetEdge(path.edges[spur]).weight;
+            }
+            search_.ClearBlocked();
+        }
+
+        void AddCandidate(std::vector<EdgeId>&& root, const std::vector<EdgeId>& spur) {
+            root.insert(root.end(), spur.begin(), spur.end());
+            if (!seen_.insert(root).second) {
+                return;
+            }
+
+            // вес считается по рёбрам в порядке пути, как и в Router::BuildRoute
+            Weight weight{};
+            for (const EdgeId edge_id : root) {
+                weight += graph_.GetEdge(edge_id).weight;
+            }
+            candidates_.push_back({ weight, std::move(root) });
+        }
+
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+        static constexpr Weight BOUND_TOLERANCE = 1e-9;
+
+        const Graph& graph_;
+        Dijkstra<Weight> search_;
+        VertexId from_;
+        VertexId to_;
+        size_t max_paths_;
+        std::vector<Weight> candidate_weights_;
+        std::optional<std::vector<EdgeId>> shortest_path_;
+        std::vector<Path> paths_;
+        std::vector<Path> candidates_;
+        std::set<std::vector<EdgeId>> seen_;
+    };
+
+}  // namespace graph
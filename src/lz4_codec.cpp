@@ -0,0 +1,389 @@
+#include "lz4_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace lz4_codec {
+
+namespace {
+
+constexpr uint32_t FRAME_MAGIC = 0x184D2204;
+constexpr uint8_t FLG_VERSION = 0x40;
+constexpr uint8_t FLG_VERSION_MASK = 0xC0;
+constexpr uint8_t FLG_BLOCK_INDEPENDENCE = 0x20;
+constexpr uint8_t FLG_BLOCK_CHECKSUM = 0x10;
+constexpr uint8_t FLG_CONTENT_SIZE = 0x08;
+constexpr uint8_t FLG_CONTENT_CHECKSUM = 0x04;
+constexpr uint8_t FLG_DICT_ID = 0x01;
+// Максимальный размер блока 4 МБ
+constexpr uint8_t BD_BLOCK_MAX_4MB = 7 << 4;
+constexpr uint32_t UNCOMPRESSED_BLOCK = 0x80000000;
+
+constexpr size_t MIN_MATCH = 4;
+// Последние байты блока всегда литералы, а совпадение начинается не ближе MF_LIMIT байт к концу
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MF_LIMIT = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_LOG = 16;
+constexpr uint32_t NO_POSITION = UINT32_MAX;
+// Без совпадений шаг поиска растёт, как ускорение в эталонной реализации
+constexpr int SKIP_TRIGGER = 6;
+
+size_t BlockMaxSize(uint8_t bd) {
+    const int code = (bd >> 4) & 0x7;
+    if (code < 4) {
+        throw std::runtime_error("LZ4 frame has invalid block size");
+    }
+    return size_t{ 1 } << (8 + 2 * code);
+}
+
+uint32_t Read32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t ReadLittleEndian32(const uint8_t* data) {
+    return uint32_t{ data[0] } | uint32_t{ data[1] } << 8 | uint32_t{ data[2] } << 16 | uint32_t{ data[3] } << 24;
+}
+
+void AppendLittleEndian(std::string& out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+uint32_t RotateLeft(uint32_t value, int shift) {
+    return (value << shift) | (value >> (32 - shift));
+}
+
+// xxHash32, нужен для контрольной суммы заголовка кадра
+uint32_t Xxh32(const uint8_t* data, size_t size, uint32_t seed) {
+    constexpr uint32_t PRIME1 = 2654435761u;
+    constexpr uint32_t PRIME2 = 2246822519u;
+    constexpr uint32_t PRIME3 = 3266489917u;
+    constexpr uint32_t PRIME4 = 668265263u;
+    constexpr uint32_t PRIME5 = 374761393u;
+
+    const uint8_t* end = data + size;
+    uint32_t hash;
+
+    if (size >= 16) {
+        uint32_t v1 = seed + PRIME1 + PRIME2;
+        uint32_t v2 = seed + PRIME2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - PRIME1;
+        for (; end - data >= 16; data += 16) {
+            v1 = RotateLeft(v1 + ReadLittleEndian32(data) * PRIME2, 13) * PRIME1;
+            v2 = RotateLeft(v2 + ReadLittleEndian32(data + 4) * PRIME2, 13) * PRIME1;
+            v3 = RotateLeft(v3 + ReadLittleEndian32(data + 8) * PRIME2, 13) * PRIME1;
+            v4 = RotateLeft(v4 + ReadLittleEndian32(data + 12) * PRIME2, 13) * PRIME1;
+        }
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+    }
+    else {
+        hash = seed + PRIME5;
+    }
+
+    hash += static_cast<uint32_t>(size);
+    for (; end - data >= 4; data += 4) {
+        hash = RotateLeft(hash + ReadLittleEndian32(data) * PRIME3, 17) * PRIME4;
+    }
+    for (; data < end; ++data) {
+        hash = RotateLeft(hash + *data * PRIME5, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 15;
+    hash *= PRIME2;
+    hash ^= hash >> 13;
+    hash *= PRIME3;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+uint32_t Hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+void AppendLength(std::string& out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void AppendSequence(std::string& out, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length) {
+    const size_t match_code = match_length - MIN_MATCH;
+    out.push_back(static_cast<char>((std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_code, 15)));
+    if (literal_length >= 15) {
+        AppendLength(out, literal_length - 15);
+    }
+    out.append(reinterpret_cast<const char*>(literals), literal_length);
+    AppendLittleEndian(out, offset, 2);
+    if (match_code >= 15) {
+        AppendLength(out, match_code - 15);
+    }
+}
+
+void AppendLastLiterals(std::string& out, const uint8_t* literals, size_t literal_length) {
+    out.push_back(static_cast<char>(std::min<size_t>(literal_length, 15) << 4));
+    if (literal_length >= 15) {
+        AppendLength(out, literal_length - 15);
+    }
+    out.append(reinterpret_cast<const char*>(literals), literal_length);
+}
+
+// Жадное сжатие блока: совпадения ищутся по хешу четырёх байт, таблица хранит последнюю позицию
+void CompressBlock(const uint8_t* src, size_t size, std::vector<uint32_t>& table, std::string& out) {
+    size_t anchor = 0;
+
+    if (size > MF_LIMIT) {
+        std::fill(table.begin(), table.end(), NO_POSITION);
+
+        const size_t match_start_limit = size - MF_LIMIT;
+        const size_t match_end_limit = size - LAST_LITERALS;
+        size_t position = 0;
+        size_t attempts = size_t{ 1 } << SKIP_TRIGGER;
+
+        while (position <= match_start_limit) {
+            const uint32_t sequence = Read32(src + position);
+            uint32_t& slot = table[Hash(sequence)];
+            const size_t candidate = slot;
+            slot = static_cast<uint32_t>(position);
+
+            if (candidate == NO_POSITION || position - candidate > MAX_OFFSET || Read32(src + candidate) != sequence) {
+                position += attempts++ >> SKIP_TRIGGER;
+                continue;
+            }
+            attempts = size_t{ 1 } << SKIP_TRIGGER;
+
+            size_t match = candidate;
+            while (position > anchor && match > 0 && src[position - 1] == src[match - 1]) {
+                --position;
+                --match;
+            }
+
+            size_t length = MIN_MATCH;
+            while (position + length < match_end_limit && src[position + length] == src[match + length]) {
+                ++length;
+            }
+
+            AppendSequence(out, src + anchor, position - anchor, position - match, length);
+            position += length;
+            anchor = position;
+
+            // позиция перед концом совпадения помогает найти следующее совпадение сразу
+            if (position <= match_start_limit) {
+                table[Hash(Read32(src + position - 2))] = static_cast<uint32_t>(position - 2);
+            }
+        }
+    }
+
+    AppendLastLiterals(out, src + anchor, size - anchor);
+}
+
+// Раскодирование блока в out[begin, begin + capacity). window - начало данных, на которые могут ссылаться совпадения
+size_t DecompressBlock(const uint8_t* src, size_t size, uint8_t* out, size_t begin, size_t capacity, size_t window) {
+    const uint8_t* const src_end = src + size;
+    size_t position = begin;
+    const size_t end = begin + capacity;
+
+    auto read_length = [&](size_t length) {
+        if (length != 15) {
+            return length;
+        }
+        uint8_t byte;
+        do {
+            if (src == src_end) {
+                throw std::runtime_error("LZ4 block is truncated");
+            }
+            byte = *src++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    };
+
+    while (true) {
+        if (src == src_end) {
+            throw std::runtime_error("LZ4 block is truncated");
+        }
+        const uint8_t token = *src++;
+
+        const size_t literal_length = read_length(token >> 4);
+        if (literal_length > static_cast<size_t>(src_end - src) || literal_length > end - position) {
+            throw std::runtime_error("LZ4 block is damaged");
+        }
+        std::memcpy(out + position, src, literal_length);
+        src += literal_length;
+        position += literal_length;
+
+        // последняя последовательность состоит только из литералов
+        if (src == src_end) {
+            return position - begin;
+        }
+
+        if (src_end - src < 2) {
+            throw std::runtime_error("LZ4 block is truncated");
+        }
+        const size_t offset = size_t{ src[0] } | size_t{ src[1] } << 8;
+        src += 2;
+
+        const size_t match_length = read_length(token & 0x0F) + MIN_MATCH;
+        if (offset == 0 || offset > position - window || match_length > end - position) {
+            throw std::runtime_error("LZ4 block is damaged");
+        }
+
+        const uint8_t* match = out + position - offset;
+        if (offset >= match_length) {
+            std::memcpy(out + position, match, match_length);
+        }
+        else {
+            // совпадение перекрывается с собственным продолжением, копируется побайтно
+            for (size_t i = 0; i < match_length; ++i) {
+                out[position + i] = match[i];
+            }
+        }
+        position += match_length;
+    }
+}
+
+} // namespace
+
+bool IsFrame(std::string_view data) {
+    return data.size() >= sizeof(uint32_t)
+        && ReadLittleEndian32(reinterpret_cast<const uint8_t*>(data.data())) == FRAME_MAGIC;
+}
+
+std::string CompressFrame(std::string_view data) {
+    const auto* src = reinterpret_cast<const uint8_t*>(data.data());
+    const size_t block_max_size = BlockMaxSize(BD_BLOCK_MAX_4MB);
+
+    std::string out;
+    out.reserve(data.size() / 2 + 64);
+
+    AppendLittleEndian(out, FRAME_MAGIC, 4);
+    const size_t descriptor = out.size();
+    out.push_back(static_cast<char>(FLG_VERSION | FLG_BLOCK_INDEPENDENCE | FLG_CONTENT_SIZE));
+    out.push_back(static_cast<char>(BD_BLOCK_MAX_4MB));
+    AppendLittleEndian(out, data.size(), 8);
+    const uint32_t header_checksum = Xxh32(reinterpret_cast<const uint8_t*>(out.data() + descriptor), out.size() - descriptor, 0);
+    out.push_back(static_cast<char>((header_checksum >> 8) & 0xFF));
+
+    std::vector<uint32_t> table(size_t{ 1 } << HASH_LOG);
+    std::string block;
+    for (size_t begin = 0; begin < data.size(); begin += block_max_size) {
+        const size_t size = std::min(block_max_size, data.size() - begin);
+
+        block.clear();
+        CompressBlock(src + begin, size, table, block);
+
+        if (block.size() < size) {
+            AppendLittleEndian(out, block.size(), 4);
+            out += block;
+        }
+        else {
+            AppendLittleEndian(out, size | UNCOMPRESSED_BLOCK, 4);
+            out.append(data.data() + begin, size);
+        }
+    }
+
+    AppendLittleEndian(out, 0, 4);
+    return out;
+}
+
+void DecompressFrame(std::string_view frame, std::string& out) {
+    const auto* data = reinterpret_cast<const uint8_t*>(frame.data());
+    const uint8_t* const end = data + frame.size();
+
+    auto require = [&](size_t size) {
+        if (static_cast<size_t>(end - data) < size) {
+            throw std::runtime_error("LZ4 frame is truncated");
+        }
+    };
+
+    require(4 + 3);
+    if (!IsFrame(frame)) {
+        throw std::runtime_error("LZ4 frame has no signature");
+    }
+    data += 4;
+
+    const uint8_t* const descriptor = data;
+    const uint8_t flags = *data++;
+    const uint8_t bd = *data++;
+    if ((flags & FLG_VERSION_MASK) != FLG_VERSION || (flags & FLG_DICT_ID) != 0) {
+        throw std::runtime_error("LZ4 frame has unsupported flags");
+    }
+    const size_t block_max_size = BlockMaxSize(bd);
+
+    out.clear();
+    uint64_t content_size = 0;
+    if (flags & FLG_CONTENT_SIZE) {
+        require(8 + 1);
+        for (int i = 0; i < 8; ++i) {
+            content_size |= uint64_t{ data[i] } << (8 * i);
+        }
+        data += 8;
+        // размер из заголовка не может превышать то, что вмещают блоки кадра
+        if (content_size / block_max_size > frame.size()) {
+            throw std::runtime_error("LZ4 frame is damaged");
+        }
+        out.reserve(content_size);
+    }
+
+    require(1);
+    const uint32_t header_checksum = Xxh32(descriptor, data - descriptor, 0);
+    if (*data++ != ((header_checksum >> 8) & 0xFF)) {
+        throw std::runtime_error("LZ4 frame header checksum mismatch");
+    }
+
+    const bool independent = (flags & FLG_BLOCK_INDEPENDENCE) != 0;
+    while (true) {
+        require(4);
+        const uint32_t block_header = ReadLittleEndian32(data);
+        data += 4;
+        if (block_header == 0) {
+            break;
+        }
+
+        const size_t block_size = block_header & ~UNCOMPRESSED_BLOCK;
+        require(block_size);
+        if (block_size > block_max_size) {
+            throw std::runtime_error("LZ4 frame is damaged");
+        }
+
+        const size_t begin = out.size();
+        if (block_header & UNCOMPRESSED_BLOCK) {
+            out.append(reinterpret_cast<const char*>(data), block_size);
+        }
+        else {
+            out.resize(begin + block_max_size);
+            const size_t size = DecompressBlock(data, block_size, reinterpret_cast<uint8_t*>(out.data()), begin,
+                block_max_size, independent ? begin : 0);
+            out.resize(begin + size);
+        }
+        data += block_size;
+
+        if (flags & FLG_BLOCK_CHECKSUM) {
+            require(4);
+            if (ReadLittleEndian32(data) != Xxh32(data - block_size, block_size, 0)) {
+                throw std::runtime_error("LZ4 block checksum mismatch");
+            }
+            data += 4;
+        }
+    }
+
+    if ((flags & FLG_CONTENT_SIZE) && out.size() != content_size) {
+        throw std::runtime_error("LZ4 frame content size mismatch");
+    }
+
+    if (flags & FLG_CONTENT_CHECKSUM) {
+        require(4);
+        if (ReadLittleEndian32(data) != Xxh32(reinterpret_cast<const uint8_t*>(out.data()), out.size(), 0)) {
+            throw std::runtime_error("LZ4 frame content checksum mismatch");
+        }
+    }
+}
+
+} // namespace lz4_codec
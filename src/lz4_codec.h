@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace lz4_codec {
+
+/*
+* Сжатие в формате кадра LZ4 (LZ4 Frame Format 1.6), совместимом с утилитой lz4 и библиотекой liblz4.
+* Кадр содержит размер исходных данных и независимые блоки до 4 МБ без контрольных сумм,
+* блок, который не удалось сжать, хранится как есть.
+* При разборе принимаются и кадры других кодировщиков: со связанными блоками,
+* контрольными суммами блоков и содержимого (они проверяются) и без размера данных
+*/
+
+// Функция сжимает данные в один кадр LZ4
+std::string CompressFrame(std::string_view data);
+
+// Функция раскодирует кадр LZ4 в out. При повреждённых данных бросает std::runtime_error
+void DecompressFrame(std::string_view frame, std::string& out);
+
+// Функция проверяет, что данные начинаются с сигнатуры кадра LZ4
+bool IsFrame(std::string_view data);
+
+} // namespace lz4_codec
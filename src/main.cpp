@@ -1,3 +1,4 @@
+#include "metrics.h"
 #include "request_handler.h"
 
 #ifdef _SIROTKIN_HOME_TESTS_
@@ -15,6 +16,22 @@
 
 using namespace std::literals;
 
+// Ключ --memory-report может стоять в любом месте после режима работы.
+// Функция убирает его из аргументов и возвращает, был ли он задан
+bool ExtractMemoryReportFlag(int& argc, const char** argv) {
+    bool found = false;
+    int count = 0;
+    for (int i = 0; i < argc; ++i) {
+        if (i > 0 && argv[i] == "--memory-report"sv) {
+            found = true;
+            continue;
+        }
+        argv[count++] = argv[i];
+    }
+    argc = count;
+    return found;
+}
+
 #ifdef _SIROTKIN_HOME_TESTS_
 
 void SetOldTestFilePath() {
@@ -45,15 +62,15 @@ void SetProcessRequestsFilePath() {
 #endif
 }
 
-int mainTests(int argc, const char** argv) {
+int mainTests(int argc, const char** argv, bool memory_report) {
     if (argc < 2) {
-        std::cerr << "Usage of home tests: [make_base/process_requests/old_tests] [file_name (optional)]"sv << std::endl;
+        std::cerr << "Usage of home tests: [make_base/process_requests/process_requests_stream/old_tests] [file_name (optional)] [--memory-report]"sv << std::endl;
         return 1;
     }
 
     request_handler::ProgrammType type = request_handler::ParseProgrammType(argc, argv);
     if (type == request_handler::ProgrammType::UNKNOWN) {
-        std::cerr << "Unknown file argument. Only [make_base/process_requests/old_tests] arguments are allowed"sv << std::endl;
+        std::cerr << "Unknown file argument. Only [make_base/process_requests/process_requests_stream/old_tests] arguments are allowed"sv << std::endl;
         return 2;
     }
 
@@ -61,6 +78,9 @@ int mainTests(int argc, const char** argv) {
         SetOldTestFilePath();
         TestTransportCatalogue();
     }
+    else if (type == request_handler::ProgrammType::PROCESS_REQUESTS_STREAM) {
+        request_handler::RequestStreamProcess(std::cin, std::cout).Execute();
+    }
     else {
         if (argc != 3) {
             std::cerr << "For arguments 'make_base' and 'process_requests' file_name is required"sv << std::endl;
@@ -71,11 +91,11 @@ int mainTests(int argc, const char** argv) {
 
         if (type == request_handler::ProgrammType::MAKE_BASE) {
             SetMakeBaseFilePath();
-            TestTransportCatalogueMakeBase(file_name);
+            TestTransportCatalogueMakeBase(file_name, memory_report);
         }
         else {
             SetProcessRequestsFilePath();
-            TestTransportCatalogueProcessRequests(file_name);
+            TestTransportCatalogueProcessRequests(file_name, memory_report);
         }
     }
 
@@ -84,7 +104,7 @@ int mainTests(int argc, const char** argv) {
 
 #endif
 
-int mainPlatform(int argc, const char** argv) {
+int mainPlatform(int argc, const char** argv, bool memory_report) {
     using namespace request_handler;
     request_handler::ProgrammType type = request_handler::ParseProgrammType(argc, argv);
 
@@ -92,6 +112,12 @@ int mainPlatform(int argc, const char** argv) {
         return 1;
     }
 
+    // В потоковом режиме вход читается построчно, а не одним документом
+    if (type == request_handler::ProgrammType::PROCESS_REQUESTS_STREAM) {
+        RequestStreamProcess(std::cin, std::cout).Execute();
+        return 0;
+    }
+
     RequestHandlerProcess rhp(std::cin, std::cout);
     if (type == request_handler::ProgrammType::MAKE_BASE) {
         rhp.ExecuteMakeBaseRequests();
@@ -103,14 +129,24 @@ int mainPlatform(int argc, const char** argv) {
         return 2;
     }
 
+    // Отчёт выводится в поток ошибок, чтобы не смешиваться с ответами
+    if (memory_report) {
+        rhp.PrintMemoryReport(std::cerr);
+    }
+
     return 0;
 }
 
 int main(int argc, const char** argv) {
+    // Метрики этапов включаются переменной окружения TRANSPORT_METRICS_FILE
+    metrics::InitFromEnvironment();
+
+    const bool memory_report = ExtractMemoryReportFlag(argc, argv);
+
 #ifdef _SIROTKIN_HOME_TESTS_
-    return mainTests(argc, argv);
+    return mainTests(argc, argv, memory_report);
 #else
-    return mainPlatform(argc, argv);
+    return mainPlatform(argc, argv, memory_report);
 #endif
     return 0;
 }
@@ -1,83 +1,350 @@
 #include "map_renderer.h"
 
 #include <algorithm>
+#include <cmath>
+#include <execution>
+#include <optional>
+#include <sstream>
+#include <thread>
 #include <utility>
 
+#include "raster.h"
+
 namespace map_renderer {
 
+uint64_t HashSettings(const MapRendererSettings& settings) {
+    transport_catalogue::detail::Fnv1aHasher hasher;
+
+    auto add_color = [&hasher](const svg::Color& color) {
+        hasher.Add(svg::ColorTypeToInt(svg::GetColorType(color))).Add(svg::GetColorStringName(color));
+    };
+
+    hasher.Add(settings.width).Add(settings.height).Add(settings.padding);
+    hasher.Add(settings.line_width).Add(settings.stop_radius);
+    hasher.Add(settings.bus_label_font_size).Add(settings.bus_label_offset.x).Add(settings.bus_label_offset.y);
+    hasher.Add(settings.stop_label_font_size).Add(settings.stop_label_offset.x).Add(settings.stop_label_offset.y);
+    add_color(settings.underlayer_color);
+    hasher.Add(settings.underlayer_width);
+    hasher.Add(settings.color_palette.size());
+    for (const svg::Color& color : settings.color_palette) {
+        add_color(color);
+    }
+    hasher.Add(settings.simplify_tolerance);
+
+    return hasher.Get();
+}
+
+std::optional<std::pair<svg::Point, svg::Point>> ClipSegment(
+    svg::Point from, svg::Point to, svg::Point min, svg::Point max) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+
+    double t_enter = 0.0;
+    double t_exit = 1.0;
+
+    auto clip = [&t_enter, &t_exit](double p, double q) {
+        if (std::abs(p) < 1e-12) {
+            return q >= 0.0;
+        }
+        const double t = q / p;
+        if (p < 0.0) {
+            if (t > t_exit) {
+                return false;
+            }
+            t_enter = std::max(t_enter, t);
+        }
+        else {
+            if (t < t_enter) {
+                return false;
+            }
+            t_exit = std::min(t_exit, t);
+        }
+        return true;
+    };
+
+    if (!clip(-dx, from.x - min.x) || !clip(dx, max.x - from.x)
+        || !clip(-dy, from.y - min.y) || !clip(dy, max.y - from.y)) {
+        return std::nullopt;
+    }
+
+    // концы внутри области сохраняются без изменений
+    return std::make_pair(
+        t_enter > 0.0 ? svg::Point(from.x + t_enter * dx, from.y + t_enter * dy) : from,
+        t_exit < 1.0 ? svg::Point(from.x + t_exit * dx, from.y + t_exit * dy) : to);
+}
+
+namespace {
+
+bool IsInside(svg::Point point, svg::Point min, svg::Point max) {
+    return point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y;
+}
+
+// Квадрат расстояния от точки до отрезка [from, to]
+double SquaredDistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length = dx * dx + dy * dy;
+
+    double t = 0.0;
+    if (length > 0.0) {
+        t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length, 0.0, 1.0);
+    }
+
+    const double px = from.x + t * dx - point.x;
+    const double py = from.y + t * dy - point.y;
+    return px * px + py * py;
+}
+
+} // namespace
+
+std::vector<uint32_t> SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance) {
+    const size_t size = points.size();
+    std::vector<uint32_t> result;
+
+    if (size <= 2) {
+        for (size_t i = 0; i < size; ++i) {
+            result.push_back(static_cast<uint32_t>(i));
+        }
+        return result;
+    }
+
+    const double squared_tolerance = tolerance * tolerance;
+    std::vector<bool> keep(size, false);
+    keep.front() = true;
+    keep.back() = true;
+
+    // рекурсия заменена явным стеком, длинные маршруты не переполнят стек вызовов
+    std::vector<std::pair<size_t, size_t>> ranges = { { 0, size - 1 } };
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+
+        double max_distance = 0.0;
+        size_t max_index = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double distance = SquaredDistanceToSegment(points[i], points[first], points[last]);
+            if (distance > max_distance) {
+                max_distance = distance;
+                max_index = i;
+            }
+        }
+
+        if (max_distance > squared_tolerance) {
+            keep[max_index] = true;
+            ranges.emplace_back(first, max_index);
+            ranges.emplace_back(max_index, last);
+        }
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        if (keep[i]) {
+            result.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    return result;
+}
+
+bool IsTileRequestValid(const TileRequest& request) {
+    if (const TileIndex* tile = std::get_if<TileIndex>(&request)) {
+        if (tile->z > MAX_TILE_ZOOM) {
+            return false;
+        }
+        const uint32_t count = 1u << tile->z;
+        return tile->x < count && tile->y < count;
+    }
+    const GeoBounds& bounds = std::get<GeoBounds>(request);
+    return bounds.max.lat > bounds.min.lat && bounds.max.lng > bounds.min.lng;
+}
+
+std::string GetTileRequestKey(const TileRequest& request) {
+    std::ostringstream key;
+    if (const TileIndex* tile = std::get_if<TileIndex>(&request)) {
+        key << tile->z << '/' << tile->x << '/' << tile->y;
+    }
+    else {
+        const GeoBounds& bounds = std::get<GeoBounds>(request);
+        key.precision(17);
+        key << "bbox:" << bounds.min.lat << ',' << bounds.min.lng << ',' << bounds.max.lat << ',' << bounds.max.lng;
+    }
+    return key.str();
+}
+
+// ----------------------------------------------------------------------------
+
+TileCache::TileCache(size_t capacity)
+    : capacity_(std::max<size_t>(1, capacity)) {
+}
+
+const std::string* TileCache::Find(const std::string& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+    items_.splice(items_.begin(), items_, it->second);
+    return &it->second->second;
+}
+
+const std::string& TileCache::Insert(std::string key, std::string tile) {
+    if (const std::string* cached = Find(key)) {
+        return *cached;
+    }
+    if (items_.size() == capacity_) {
+        index_.erase(items_.back().first);
+        items_.pop_back();
+    }
+    items_.emplace_front(std::move(key), std::move(tile));
+    index_.emplace(items_.front().first, items_.begin());
+    return items_.front().second;
+}
+
+void TileCache::Clear() {
+    index_.clear();
+    items_.clear();
+}
+
+// ----------------------------------------------------------------------------
+
+SpatialGrid::SpatialGrid(svg::Point min, svg::Point max, size_t cells_per_side)
+    : min_(min)
+    , cells_per_side_(std::max<size_t>(1, cells_per_side))
+    , cells_(cells_per_side_ * cells_per_side_) {
+    cell_width_ = std::max(1e-6, (max.x - min.x) / cells_per_side_);
+    cell_height_ = std::max(1e-6, (max.y - min.y) / cells_per_side_);
+}
+
+size_t SpatialGrid::CellX(double x) const {
+    const double cell = std::floor((x - min_.x) / cell_width_);
+    return static_cast<size_t>(std::clamp(cell, 0.0, static_cast<double>(cells_per_side_ - 1)));
+}
+
+size_t SpatialGrid::CellY(double y) const {
+    const double cell = std::floor((y - min_.y) / cell_height_);
+    return static_cast<size_t>(std::clamp(cell, 0.0, static_cast<double>(cells_per_side_ - 1)));
+}
+
+void SpatialGrid::Insert(uint32_t item, svg::Point from, svg::Point to) {
+    const size_t x_begin = CellX(std::min(from.x, to.x));
+    const size_t x_end = CellX(std::max(from.x, to.x));
+    const size_t y_begin = CellY(std::min(from.y, to.y));
+    const size_t y_end = CellY(std::max(from.y, to.y));
+
+    for (size_t y = y_begin; y <= y_end; ++y) {
+        for (size_t x = x_begin; x <= x_end; ++x) {
+            std::vector<uint32_t>& cell = cells_[y * cells_per_side_ + x];
+            // отрезки одного маршрута добавляются подряд, повторы отбрасываются сразу
+            if (cell.empty() || cell.back() != item) {
+                cell.push_back(item);
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> SpatialGrid::Query(svg::Point min, svg::Point max) const {
+    std::vector<uint32_t> result;
+    if (cells_.empty()) {
+        return result;
+    }
+
+    const size_t x_begin = CellX(min.x);
+    const size_t x_end = CellX(max.x);
+    const size_t y_begin = CellY(min.y);
+    const size_t y_end = CellY(max.y);
+
+    for (size_t y = y_begin; y <= y_end; ++y) {
+        for (size_t x = x_begin; x <= x_end; ++x) {
+            const std::vector<uint32_t>& cell = cells_[y * cells_per_side_ + x];
+            result.insert(result.end(), cell.begin(), cell.end());
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+
 MapRendererCreator::MapRendererCreator(MapRendererSettings&& render_settings)
     : render_settings_(std::move(render_settings)) {
 }
 
-svg::Polyline MapRendererCreator::CreateLine(int color_index) {
-    svg::Polyline polyline;
-    polyline.SetFillColor(svg::Color());
-    polyline.SetStrokeWidth(render_settings_.line_width);
-    polyline.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-    polyline.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-    polyline.SetStrokeColor(render_settings_.color_palette.at(color_index % render_settings_.color_palette.size()));
-    return polyline;
+svg::Style MapRendererCreator::CreateLine(int color_index) const {
+    svg::Style style;
+    style.SetFillColor(svg::Color());
+    style.SetStrokeWidth(render_settings_.line_width);
+    style.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
+    style.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    style.SetStrokeColor(render_settings_.color_palette.at(color_index % render_settings_.color_palette.size()));
+    return style;
 }
 
-svg::Text MapRendererCreator::CreateBusText() {
+svg::Style MapRendererCreator::CreateBusText() const {
     using namespace std::string_literals;
-    svg::Text text;
-    text.SetOffset(render_settings_.bus_label_offset);
-    text.SetFontSize(render_settings_.bus_label_font_size);
-    text.SetFontFamily("Verdana"s);
-    text.SetFontWeight("bold"s);
-    return text;
+    svg::Style style;
+    style.SetOffset(render_settings_.bus_label_offset);
+    style.SetFontSize(render_settings_.bus_label_font_size);
+    style.SetFontFamily("Verdana"s);
+    style.SetFontWeight("bold"s);
+    return style;
 }
 
-svg::Text MapRendererCreator::CreateUnderlayerBusText() {
-    svg::Text text = CreateBusText();
-    text.SetFillColor(render_settings_.underlayer_color);
-    text.SetStrokeColor(render_settings_.underlayer_color);
-    text.SetStrokeWidth(render_settings_.underlayer_width);
-    text.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-    text.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-    return text;
+svg::Style MapRendererCreator::CreateUnderlayerBusText() const {
+    svg::Style style = CreateBusText();
+    style.SetFillColor(render_settings_.underlayer_color);
+    style.SetStrokeColor(render_settings_.underlayer_color);
+    style.SetStrokeWidth(render_settings_.underlayer_width);
+    style.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
+    style.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    return style;
 }
 
-svg::Text MapRendererCreator::CreateDataBusText(int color_index) {
-    svg::Text text = CreateBusText();
-    text.SetFillColor(render_settings_.color_palette.at(color_index % render_settings_.color_palette.size()));
-    return text;
+svg::Style MapRendererCreator::CreateDataBusText(int color_index) const {
+    svg::Style style = CreateBusText();
+    style.SetFillColor(render_settings_.color_palette.at(color_index % render_settings_.color_palette.size()));
+    return style;
 }
 
-svg::Text MapRendererCreator::CreateStopText() {
+svg::Style MapRendererCreator::CreateStopText() const {
     using namespace std::string_literals;
-    svg::Text text;
-    text.SetOffset(render_settings_.stop_label_offset);
-    text.SetFontSize(render_settings_.stop_label_font_size);
-    text.SetFontFamily("Verdana"s);
-    return text;
+    svg::Style style;
+    style.SetOffset(render_settings_.stop_label_offset);
+    style.SetFontSize(render_settings_.stop_label_font_size);
+    style.SetFontFamily("Verdana"s);
+    return style;
 }
 
-svg::Text MapRendererCreator::CreateUnderlayerStopText() {
-    svg::Text text = CreateStopText();
-    text.SetFillColor(render_settings_.underlayer_color);
-    text.SetStrokeColor(render_settings_.underlayer_color);
-    text.SetStrokeWidth(render_settings_.underlayer_width);
-    text.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-    text.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-    return text;
+svg::Style MapRendererCreator::CreateUnderlayerStopText() const {
+    svg::Style style = CreateStopText();
+    style.SetFillColor(render_settings_.underlayer_color);
+    style.SetStrokeColor(render_settings_.underlayer_color);
+    style.SetStrokeWidth(render_settings_.underlayer_width);
+    style.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
+    style.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    return style;
 }
 
-svg::Text MapRendererCreator::CreateDataStopText() {
+svg::Style MapRendererCreator::CreateDataStopText() const {
     using namespace std::string_literals;
-    svg::Text text = CreateStopText();
-    text.SetFillColor(svg::Color("black"s));
-    return text;
+    svg::Style style = CreateStopText();
+    style.SetFillColor(svg::Color("black"s));
+    return style;
 }
 
-svg::Circle MapRendererCreator::CreateCircle(const svg::Point& center) {
+svg::Style MapRendererCreator::CreateCircle() const {
     using namespace std::string_literals;
-    svg::Circle circle;
-    circle.SetCenter(center);
-    circle.SetRadius(render_settings_.stop_radius);
-    circle.SetFillColor(svg::Color("white"s));
-    return circle;
+    svg::Style style;
+    style.SetFillColor(svg::Color("white"s));
+    return style;
+}
+
+svg::Style MapRendererCreator::CreateIsochroneCircle(size_t band) const {
+    // от зелёного для ближних остановок к красному для дальних
+    const int red = static_cast<int>(255 * band / (ISOCHRONE_BANDS - 1));
+    svg::Style style;
+    style.SetFillColor(svg::Color(svg::Rgba(red, 255 - red, 0, 0.85)));
+    style.SetStrokeColor(svg::Color(svg::Rgb(0, 0, 0)));
+    style.SetStrokeWidth(1.0);
+    return style;
 }
 
 // ----------------------------------------------------------------------------
@@ -85,16 +352,314 @@ svg::Circle MapRendererCreator::CreateCircle(const svg::Point& center) {
 MapRenderer::MapRenderer(
     MapRendererSettings render_settings,
     const transport_catalogue::stop_catalogue::Catalogue& stops,
-    const transport_catalogue::bus_catalogue::Catalogue& buses)
-    : MapRendererCreator(std::move(render_settings)) {
+    const transport_catalogue::bus_catalogue::Catalogue& buses,
+    PolylineLod polyline_lod)
+    : MapRendererCreator(std::move(render_settings))
+    , polyline_lod_(std::move(polyline_lod)) {
     InitNotEmptyStops(stops);
     InitNotEmptyBuses(buses);
     CalculateZoomCoef();
     CalculateStopZoomedCoords();
-    DrawLines();
-    DrawBusText();
-    DrawStopCircles();
-    DrawStopText();
+    InitStyles();
+    InitPolylineLod();
+}
+
+void MapRenderer::Render(std::ostream& out) const {
+    std::vector<Shard> shards = CreateShards();
+
+    std::for_each(std::execution::par, shards.begin(), shards.end(),
+        [this](Shard& shard) {
+            DrawShard(shard);
+        });
+
+    svg::Document::RenderBegin(out);
+    for (const Shard& shard : shards) {
+        out << shard.buffer;
+    }
+    svg::Document::RenderEnd(out);
+}
+
+void MapRenderer::RenderTile(const TileRequest& request, std::ostream& out, MapFormat format) const {
+    const svg::CommandList commands = CreateTileCommands(request);
+
+    if (format == MapFormat::PNG) {
+        RenderRaster(commands, out);
+        return;
+    }
+
+    std::string buffer;
+    commands.Render(styles_, buffer);
+
+    svg::Document::RenderBegin(out);
+    out << buffer;
+    svg::Document::RenderEnd(out);
+}
+
+void MapRenderer::RenderPng(std::ostream& out) const {
+    svg::CommandList commands;
+    DrawLines(0, buses_.size(), commands);
+    DrawBusText(0, buses_.size(), commands);
+    DrawStopCircles(0, stops_.size(), commands);
+    DrawStopText(0, stops_.size(), commands);
+
+    RenderRaster(commands, out);
+}
+
+void MapRenderer::RenderIsochrone(const std::vector<IsochroneStop>& stops, double max_time, std::ostream& out) const {
+    svg::CommandList commands;
+    DrawLines(0, buses_.size(), commands);
+
+    // остановки без маршрутов на карте не отображаются
+    std::vector<std::pair<svg::Point, const IsochroneStop*>> points;
+    for (const IsochroneStop& isochrone_stop : stops) {
+        const auto it = stop_point_.find(isochrone_stop.stop);
+        if (it != stop_point_.end()) {
+            points.push_back({ it->second, &isochrone_stop });
+        }
+    }
+
+    for (const auto& [point, isochrone_stop] : points) {
+        const size_t band = max_time > 0.0
+            ? std::min(ISOCHRONE_BANDS - 1, static_cast<size_t>(isochrone_stop->time / max_time * ISOCHRONE_BANDS))
+            : 0;
+        commands.AddCircle(isochrone_styles_[band], point, 2.0 * render_settings_.stop_radius);
+    }
+    for (const auto& [point, isochrone_stop] : points) {
+        commands.AddText(stop_underlayer_style_, point, isochrone_stop->stop->name);
+        commands.AddText(stop_text_style_, point, isochrone_stop->stop->name);
+    }
+
+    std::string buffer;
+    commands.Render(styles_, buffer);
+
+    svg::Document::RenderBegin(out);
+    out << buffer;
+    svg::Document::RenderEnd(out);
+}
+
+void MapRenderer::RenderRaster(const svg::CommandList& commands, std::ostream& out) const {
+    auto to_size = [](double size) {
+        return static_cast<int>(std::clamp(std::ceil(size), 1.0, static_cast<double>(MAX_RASTER_SIZE)));
+    };
+    out << raster::RenderPng(commands, styles_, to_size(render_settings_.width), to_size(render_settings_.height));
+}
+
+svg::CommandList MapRenderer::CreateTileCommands(const TileRequest& request) const {
+    std::call_once(spatial_index_flag_, [this]() {
+        InitSpatialIndex();
+    });
+
+    const Viewport viewport = CreateViewport(request);
+
+    // запас вокруг области, чтобы не потерять частично видимые линии и круги остановок
+    const double margin = std::max({ render_settings_.line_width, render_settings_.stop_radius,
+        render_settings_.simplify_tolerance }) / viewport.scale;
+    const size_t level = static_cast<size_t>(std::max(0.0, std::floor(std::log2(viewport.scale) + 1e-9)));
+    const svg::Point min(viewport.min.x - margin, viewport.min.y - margin);
+    const svg::Point max(viewport.max.x + margin, viewport.max.y + margin);
+
+    auto transform = [&viewport](svg::Point point) {
+        return svg::Point((point.x - viewport.min.x) * viewport.scale, (point.y - viewport.min.y) * viewport.scale);
+    };
+
+    const std::vector<uint32_t> bus_ids = bus_grid_.Query(min, max);
+    // ячейки сетки покрывают область с избытком, остановки отбираются точно
+    std::vector<uint32_t> stop_ids = stop_grid_.Query(min, max);
+    stop_ids.erase(std::remove_if(stop_ids.begin(), stop_ids.end(),
+        [&](uint32_t i) {
+            return !IsInside(stop_point_.at(stops_[i].second), min, max);
+        }), stop_ids.end());
+
+    svg::CommandList commands;
+
+    for (uint32_t color_index : bus_ids) {
+        const std::vector<svg::Point> points = GetBusPolyline(color_index, level);
+        const svg::StyleId style = line_styles_.at(color_index % line_styles_.size());
+
+        if (points.size() == 1) {
+            if (IsInside(points.front(), min, max)) {
+                commands.StartPolyline(style);
+                commands.AddPoint(transform(points.front()));
+            }
+            continue;
+        }
+
+        // ломаная разрезается на куски, лежащие внутри области
+        svg::Point last{};
+        bool has_last = false;
+        for (size_t i = 0; i + 1 < points.size(); ++i) {
+            const auto clipped = ClipSegment(points[i], points[i + 1], min, max);
+            if (!clipped) {
+                has_last = false;
+                continue;
+            }
+            if (!has_last || last != clipped->first) {
+                commands.StartPolyline(style);
+                commands.AddPoint(transform(clipped->first));
+            }
+            commands.AddPoint(transform(clipped->second));
+            last = clipped->second;
+            // кусок, обрезанный границей, со следующим не соединяется
+            has_last = clipped->second == points[i + 1];
+        }
+    }
+
+    for (uint32_t color_index : bus_ids) {
+        const auto& [name, bus] = buses_[color_index];
+        const svg::StyleId data_style = bus_text_styles_.at(color_index % bus_text_styles_.size());
+
+        auto add_label = [&](const transport_catalogue::stop_catalogue::Stop* stop) {
+            const svg::Point point = stop_point_.at(stop);
+            if (IsInside(point, min, max)) {
+                commands.AddText(bus_underlayer_style_, transform(point), name);
+                commands.AddText(data_style, transform(point), name);
+            }
+        };
+
+        add_label(bus->route.front());
+        if (bus->route_type == transport_catalogue::RouteType::BackAndForth && *bus->route.front() != *bus->route.back()) {
+            add_label(bus->route.back());
+        }
+    }
+
+    for (uint32_t i : stop_ids) {
+        commands.AddCircle(circle_style_, transform(stop_point_.at(stops_[i].second)), render_settings_.stop_radius);
+    }
+
+    for (uint32_t i : stop_ids) {
+        const auto& [name, stop] = stops_[i];
+        commands.AddText(stop_underlayer_style_, transform(stop_point_.at(stop)), name);
+        commands.AddText(stop_text_style_, transform(stop_point_.at(stop)), name);
+    }
+
+    return commands;
+}
+
+void MapRenderer::InitSpatialIndex() const {
+    svg::Point min(0.0, 0.0);
+    svg::Point max(render_settings_.width, render_settings_.height);
+    for (const auto& [stop, point] : stop_point_) {
+        min = svg::Point(std::min(min.x, point.x), std::min(min.y, point.y));
+        max = svg::Point(std::max(max.x, point.x), std::max(max.y, point.y));
+    }
+
+    // в среднем несколько остановок на ячейку
+    const size_t cells_per_side = std::clamp<size_t>(
+        static_cast<size_t>(std::sqrt(static_cast<double>(stops_.size()))), 1, 256);
+
+    bus_grid_ = SpatialGrid(min, max, cells_per_side);
+    stop_grid_ = SpatialGrid(min, max, cells_per_side);
+
+    for (size_t i = 0; i < buses_.size(); ++i) {
+        const std::vector<svg::Point> points = GetBusPolyline(buses_[i].second);
+        bus_grid_.Insert(static_cast<uint32_t>(i), points.front(), points.front());
+        for (size_t j = 0; j + 1 < points.size(); ++j) {
+            bus_grid_.Insert(static_cast<uint32_t>(i), points[j], points[j + 1]);
+        }
+    }
+
+    for (size_t i = 0; i < stops_.size(); ++i) {
+        const svg::Point point = stop_point_.at(stops_[i].second);
+        stop_grid_.Insert(static_cast<uint32_t>(i), point, point);
+    }
+}
+
+MapRenderer::Viewport MapRenderer::CreateViewport(const TileRequest& request) const {
+    Viewport viewport;
+
+    if (const TileIndex* tile = std::get_if<TileIndex>(&request)) {
+        const double count = static_cast<double>(1u << tile->z);
+        const double tile_width = render_settings_.width / count;
+        const double tile_height = render_settings_.height / count;
+        viewport.min = svg::Point(tile->x * tile_width, tile->y * tile_height);
+        viewport.max = svg::Point(viewport.min.x + tile_width, viewport.min.y + tile_height);
+        viewport.scale = count;
+        return viewport;
+    }
+
+    const GeoBounds& bounds = std::get<GeoBounds>(request);
+    viewport.min.x = (bounds.min.lng - min_longitude_) * zoom_coef_ + render_settings_.padding;
+    viewport.min.y = (max_latitude_ - bounds.max.lat) * zoom_coef_ + render_settings_.padding;
+    viewport.max.x = (bounds.max.lng - min_longitude_) * zoom_coef_ + render_settings_.padding;
+    viewport.max.y = (max_latitude_ - bounds.min.lat) * zoom_coef_ + render_settings_.padding;
+
+    const double width = viewport.max.x - viewport.min.x;
+    const double height = viewport.max.y - viewport.min.y;
+    viewport.scale = (width > 1e-9 && height > 1e-9)
+        ? std::min(render_settings_.width / width, render_settings_.height / height)
+        : 1.0;
+    return viewport;
+}
+
+void MapRenderer::InitPolylineLod() {
+    if (render_settings_.simplify_tolerance <= 0.0) {
+        polyline_lod_.clear();
+        return;
+    }
+
+    // готовые линии, например из базы, принимаются, если они построены для тех же маршрутов
+    const bool is_valid = polyline_lod_.size() == LOD_LEVELS
+        && std::all_of(polyline_lod_.begin(), polyline_lod_.end(), [this](const auto& level) {
+            return level.size() == buses_.size();
+        });
+    if (is_valid) {
+        return;
+    }
+
+    polyline_lod_.assign(LOD_LEVELS, std::vector<std::vector<uint32_t>>(buses_.size()));
+    for (size_t i = 0; i < buses_.size(); ++i) {
+        const std::vector<svg::Point> points = GetBusPolyline(buses_[i].second);
+        for (size_t level = 0; level < LOD_LEVELS; ++level) {
+            const double tolerance = render_settings_.simplify_tolerance / static_cast<double>(1u << level);
+            polyline_lod_[level][i] = SimplifyPolyline(points, tolerance);
+        }
+    }
+}
+
+std::vector<svg::Point> MapRenderer::GetBusPolyline(size_t bus_index, size_t level) const {
+    std::vector<svg::Point> points = GetBusPolyline(buses_[bus_index].second);
+    if (level >= polyline_lod_.size()) {
+        return points;
+    }
+
+    std::vector<svg::Point> simplified;
+    simplified.reserve(polyline_lod_[level][bus_index].size());
+    for (uint32_t vertex : polyline_lod_[level][bus_index]) {
+        simplified.push_back(points.at(vertex));
+    }
+    return simplified;
+}
+
+std::vector<svg::Point> MapRenderer::GetBusPolyline(const transport_catalogue::bus_catalogue::Bus* bus) const {
+    std::vector<svg::Point> points;
+    points.reserve(bus->route.size() * 2);
+
+    for (const auto& stop : bus->route) {
+        points.push_back(stop_point_.at(stop));
+    }
+
+    if (bus->route_type == transport_catalogue::RouteType::BackAndForth && !bus->route.empty()) {
+        for (auto it = bus->route.rbegin() + 1; it != bus->route.rend(); ++it) {
+            points.push_back(stop_point_.at(*it));
+        }
+    }
+
+    return points;
+}
+
+void MapRenderer::InitStyles() {
+    const size_t palette_size = render_settings_.color_palette.size();
+    for (size_t color_index = 0; color_index < palette_size; ++color_index) {
+        line_styles_.push_back(styles_.Add(CreateLine(color_index)));
+        bus_text_styles_.push_back(styles_.Add(CreateDataBusText(color_index)));
+    }
+    bus_underlayer_style_ = styles_.Add(CreateUnderlayerBusText());
+    circle_style_ = styles_.Add(CreateCircle());
+    stop_underlayer_style_ = styles_.Add(CreateUnderlayerStopText());
+    stop_text_style_ = styles_.Add(CreateDataStopText());
+    for (size_t band = 0; band < ISOCHRONE_BANDS; ++band) {
+        isochrone_styles_.push_back(styles_.Add(CreateIsochroneCircle(band)));
+    }
 }
 
 void MapRenderer::InitNotEmptyStops(
@@ -102,20 +667,21 @@ void MapRenderer::InitNotEmptyStops(
     for (const auto& [name, stop] : stops) {
         if (!stops.IsEmpty(stop)) {
             stop_point_.emplace(stop, svg::Point{});
-            stops_.emplace(name, stop);
+            stops_.emplace_back(name, stop);
         }
     }
+    std::sort(stops_.begin(), stops_.end());
 }
 
 void MapRenderer::InitNotEmptyBuses(
     const transport_catalogue::bus_catalogue::Catalogue& buses) {
     for (const auto& [name, bus] : buses) {
         if (bus->stops_on_route > 0) {
-            buses_.emplace(name, bus);
+            buses_.emplace_back(name, bus);
         }
     }
+    std::sort(buses_.begin(), buses_.end());
 }
-
 void MapRenderer::CalculateZoomCoef() {
     const auto [bottom_it, top_it] = std::minmax_element(stop_point_.begin(), stop_point_.end(),
         [](const auto& lhs, const auto& rhs) {
@@ -150,60 +716,91 @@ void MapRenderer::CalculateStopZoomedCoords() {
     }
 }
 
-void MapRenderer::DrawLines() {
-    size_t color_index = 0;
-    for (const auto& [name, bus] : buses_) {
-        svg::Polyline polyline = CreateLine(color_index++);
+std::vector<MapRenderer::Shard> MapRenderer::CreateShards() const {
+    const size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    std::vector<Shard> shards;
+    for (Layer layer : { Layer::LINES, Layer::BUS_TEXT, Layer::STOP_CIRCLES, Layer::STOP_TEXT }) {
+        const size_t count = (layer == Layer::LINES || layer == Layer::BUS_TEXT) ? buses_.size() : stops_.size();
+        const size_t shard_size = std::max(MIN_SHARD_SIZE, (count + threads - 1) / threads);
+        for (size_t begin = 0; begin < count; begin += shard_size) {
+            shards.push_back({ layer, begin, std::min(count, begin + shard_size) });
+        }
+    }
+    return shards;
+}
+
+void MapRenderer::DrawShard(Shard& shard) const {
+    svg::CommandList commands;
+
+    switch (shard.layer) {
+    case Layer::LINES:
+        DrawLines(shard.begin, shard.end, commands);
+        break;
+    case Layer::BUS_TEXT:
+        DrawBusText(shard.begin, shard.end, commands);
+        break;
+    case Layer::STOP_CIRCLES:
+        DrawStopCircles(shard.begin, shard.end, commands);
+        break;
+    case Layer::STOP_TEXT:
+        DrawStopText(shard.begin, shard.end, commands);
+        break;
+    }
+
+    commands.Render(styles_, shard.buffer);
+}
+
+void MapRenderer::DrawLines(size_t begin, size_t end, svg::CommandList& commands) const {
+    for (size_t color_index = begin; color_index < end; ++color_index) {
+        const transport_catalogue::bus_catalogue::Bus* bus = buses_[color_index].second;
+        commands.StartPolyline(line_styles_.at(color_index % line_styles_.size()));
+
+        if (!polyline_lod_.empty()) {
+            for (const svg::Point& point : GetBusPolyline(color_index, 0)) {
+                commands.AddPoint(point);
+            }
+            continue;
+        }
 
         for (const auto& stop : bus->route) {
-            polyline.AddPoint(stop_point_.at(stop));
+            commands.AddPoint(stop_point_.at(stop));
         }
 
         if (bus->route_type == transport_catalogue::RouteType::BackAndForth && !bus->route.empty()) {
             for (auto it = bus->route.rbegin() + 1; it != bus->route.rend(); ++it) {
-                polyline.AddPoint(stop_point_.at(*it));
+                commands.AddPoint(stop_point_.at(*it));
             }
         }
-
-        Add(std::move(polyline));
     }
 }
 
-void MapRenderer::DrawBusText() {
-    size_t color_index = 0;
-    for (const auto& [name, bus] : buses_) {
-        svg::Text underlayer_text = CreateUnderlayerBusText().SetData(std::string(name));
-        svg::Text data_text = CreateDataBusText(color_index++).SetData(std::string(name));;
-
-        underlayer_text.SetPosition(stop_point_.at(bus->route.front()));
-        data_text.SetPosition(stop_point_.at(bus->route.front()));
+void MapRenderer::DrawBusText(size_t begin, size_t end, svg::CommandList& commands) const {
+    for (size_t color_index = begin; color_index < end; ++color_index) {
+        const auto& [name, bus] = buses_[color_index];
+        const svg::StyleId data_style = bus_text_styles_.at(color_index % bus_text_styles_.size());
 
-        Add(underlayer_text);
-        Add(data_text);
+        commands.AddText(bus_underlayer_style_, stop_point_.at(bus->route.front()), name);
+        commands.AddText(data_style, stop_point_.at(bus->route.front()), name);
 
         if (bus->route_type == transport_catalogue::RouteType::BackAndForth && !bus->route.empty() && *bus->route.front() != *bus->route.back()) {
-            underlayer_text.SetPosition(stop_point_.at(bus->route.back()));
-            data_text.SetPosition(stop_point_.at(bus->route.back()));
-
-            Add(std::move(underlayer_text));
-            Add(std::move(data_text));
+            commands.AddText(bus_underlayer_style_, stop_point_.at(bus->route.back()), name);
+            commands.AddText(data_style, stop_point_.at(bus->route.back()), name);
         }
     }
 }
 
-void MapRenderer::DrawStopCircles() {
-    for (const auto& [name, stop] : stops_) {
-        Add(std::move(CreateCircle(stop_point_.at(stop))));
+void MapRenderer::DrawStopCircles(size_t begin, size_t end, svg::CommandList& commands) const {
+    for (size_t i = begin; i < end; ++i) {
+        commands.AddCircle(circle_style_, stop_point_.at(stops_[i].second), render_settings_.stop_radius);
     }
 }
 
-void MapRenderer::DrawStopText() {
-    for (const auto& [name, stop] : stops_) {
-        svg::Text underlayer_text = CreateUnderlayerStopText().SetData(std::string(name)).SetPosition(stop_point_.at(stop));
-        svg::Text data_text = CreateDataStopText().SetData(std::string(name)).SetPosition(stop_point_.at(stop));;
-
-        Add(std::move(underlayer_text));
-        Add(std::move(data_text));
+void MapRenderer::DrawStopText(size_t begin, size_t end, svg::CommandList& commands) const {
+    for (size_t i = begin; i < end; ++i) {
+        const auto& [name, stop] = stops_[i];
+        commands.AddText(stop_underlayer_style_, stop_point_.at(stop), name);
+        commands.AddText(stop_text_style_, stop_point_.at(stop), name);
     }
 }
 
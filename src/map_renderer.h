@@ -3,12 +3,21 @@
 #include <algorithm>
 #include <deque>
 #include <iostream>
+#include <list>
 #include <map>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include "domain.h"
 #include "geo.h"
+#include "memory_usage.h"
 #include "svg.h"
 
 namespace map_renderer {
@@ -64,6 +73,135 @@ struct MapRendererSettings {
 
     //  ,    
     std::vector<svg::Color> color_palette = {};
+
+    //       , 0 -  
+    //     0
+    double simplify_tolerance = 0.0;
+};
+
+//     .  L  
+//   z = L,        
+static constexpr uint32_t LOD_LEVELS = 8;
+
+//   :       
+// (  )     
+using PolylineLod = std::vector<std::vector<std::vector<uint32_t>>>;
+
+//   [from, to]  [min, max]  -.
+//      nullopt,     
+std::optional<std::pair<svg::Point, svg::Point>> ClipSegment(
+    svg::Point from, svg::Point to, svg::Point min, svg::Point max);
+
+//    -,    
+std::vector<uint32_t> SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance);
+
+//   ,       
+uint64_t HashSettings(const MapRendererSettings& settings);
+
+// ----------------------------------------------------------------------------
+
+//  :   z     2^z x 2^z  ,
+// x  y -    ,     
+struct TileIndex {
+    uint32_t z = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+};
+
+//       
+struct GeoBounds {
+    Coordinates min = {};
+    Coordinates max = {};
+};
+
+using TileRequest = std::variant<TileIndex, GeoBounds>;
+
+//   
+enum class MapFormat {
+    SVG,
+    PNG
+};
+
+//       
+static constexpr int MAX_RASTER_SIZE = 8192;
+
+//    
+static constexpr uint32_t MAX_TILE_ZOOM = 24;
+
+// ,   ,    
+bool IsTileRequestValid(const TileRequest& request);
+
+//      
+std::string GetTileRequestKey(const TileRequest& request);
+
+// ----------------------------------------------------------------------------
+
+// ,    ,      
+struct IsochroneStop {
+    const transport_catalogue::stop_catalogue::Stop* stop = nullptr;
+    double time = 0.0;
+};
+
+//    :   max_time    
+static constexpr size_t ISOCHRONE_BANDS = 4;
+
+// ----------------------------------------------------------------------------
+
+//   ,     (LRU)
+class TileCache {
+public:
+    explicit TileCache(size_t capacity);
+
+    //      nullptr,     
+    const std::string* Find(const std::string& key);
+
+    //    ,     
+    const std::string& Insert(std::string key, std::string tile);
+
+    void Clear();
+
+    size_t Size() const {
+        return items_.size();
+    }
+
+    //  ,     
+    size_t GetHeapSize() const {
+        return memory_usage::HeapSize(items_) + memory_usage::HeapSize(index_);
+    }
+
+private:
+    using Item = std::pair<std::string, std::string>;
+
+    size_t capacity_ = 0;
+    //      
+    std::list<Item> items_;
+    std::unordered_map<std::string_view, std::list<Item>::iterator> index_;
+};
+
+// ----------------------------------------------------------------------------
+
+//        ,   
+class SpatialGrid {
+public:
+    SpatialGrid() = default;
+
+    SpatialGrid(svg::Point min, svg::Point max, size_t cells_per_side);
+
+    //   item   ,    [from, to]
+    void Insert(uint32_t item, svg::Point from, svg::Point to);
+
+    //        ,  
+    std::vector<uint32_t> Query(svg::Point min, svg::Point max) const;
+
+private:
+    size_t CellX(double x) const;
+    size_t CellY(double y) const;
+
+    svg::Point min_ = {};
+    double cell_width_ = 1.0;
+    double cell_height_ = 1.0;
+    size_t cells_per_side_ = 0;
+    std::vector<std::vector<uint32_t>> cells_;
 };
 
 // ----------------------------------------------------------------------------
@@ -72,17 +210,19 @@ class MapRendererCreator {
 public:
     MapRendererCreator(MapRendererSettings&& render_settings);
 
-    svg::Polyline CreateLine(int color_index);
+    svg::Style CreateLine(int color_index) const;
 
-    svg::Text CreateBusText();
-    svg::Text CreateUnderlayerBusText();
-    svg::Text CreateDataBusText(int color_index);
+    svg::Style CreateBusText() const;
+    svg::Style CreateUnderlayerBusText() const;
+    svg::Style CreateDataBusText(int color_index) const;
 
-    svg::Text CreateStopText();
-    svg::Text CreateUnderlayerStopText();
-    svg::Text CreateDataStopText();
+    svg::Style CreateStopText() const;
+    svg::Style CreateUnderlayerStopText() const;
+    svg::Style CreateDataStopText() const;
 
-    svg::Circle CreateCircle(const svg::Point& center);
+    svg::Style CreateCircle() const;
+
+    svg::Style CreateIsochroneCircle(size_t band) const;
 
 protected:
     const MapRendererSettings render_settings_;
@@ -90,14 +230,60 @@ protected:
 
 // ----------------------------------------------------------------------------
 
-class MapRenderer : public svg::Document, private MapRendererCreator {
+class MapRenderer : private MapRendererCreator {
 public:
     MapRenderer(
         MapRendererSettings render_settings,
         const transport_catalogue::stop_catalogue::Catalogue& stops,
-        const transport_catalogue::bus_catalogue::Catalogue& buses);
+        const transport_catalogue::bus_catalogue::Catalogue& buses,
+        PolylineLod polyline_lod = {});
+
+    //    ,     
+    const PolylineLod& GetPolylineLod() const {
+        return polyline_lod_;
+    }
+
+    //  svg- .   ,
+    //      ,     
+    void Render(std::ostream& out) const;
+
+    //  svg-    width x height:  ,
+    //    ,      
+    void RenderTile(const TileRequest& request, std::ostream& out, MapFormat format = MapFormat::SVG) const;
+
+    //     PNG  width x height
+    void RenderPng(std::ostream& out) const;
+
+    //  svg-      :  
+    //   ,        ,  
+    void RenderIsochrone(const std::vector<IsochroneStop>& stops, double max_time, std::ostream& out) const;
 
 private:
+    //       
+    struct Viewport {
+        svg::Point min;
+        svg::Point max;
+        double scale = 1.0;
+    };
+    //      
+    enum class Layer {
+        LINES,
+        BUS_TEXT,
+        STOP_CIRCLES,
+        STOP_TEXT
+    };
+
+    //  :         
+    struct Shard {
+        Layer layer;
+        size_t begin = 0;
+        size_t end = 0;
+        std::string buffer = {};
+    };
+
+    //     ,     
+    static constexpr size_t MIN_SHARD_SIZE = 64;
+
     //   ,       
     void InitNotEmptyStops(
         const transport_catalogue::stop_catalogue::Catalogue& stops);
@@ -112,17 +298,47 @@ private:
     //       
     void CalculateStopZoomedCoords();
 
+    //   ,    
+    void InitStyles();
+
+    //        
+    std::vector<Shard> CreateShards() const;
+
+    //      
+    void DrawShard(Shard& shard) const;
+
     //   
-    void DrawLines();
+    void DrawLines(size_t begin, size_t end, svg::CommandList& commands) const;
 
     //   
-    void DrawBusText();
+    void DrawBusText(size_t begin, size_t end, svg::CommandList& commands) const;
 
     //   
-    void DrawStopCircles();
+    void DrawStopCircles(size_t begin, size_t end, svg::CommandList& commands) const;
 
     //   
-    void DrawStopText();
+    void DrawStopText(size_t begin, size_t end, svg::CommandList& commands) const;
+
+    //    
+    svg::CommandList CreateTileCommands(const TileRequest& request) const;
+
+    //      width x height
+    void RenderRaster(const svg::CommandList& commands, std::ostream& out) const;
+
+    //      ,     
+    void InitSpatialIndex() const;
+
+    //   ,  
+    Viewport CreateViewport(const TileRequest& request) const;
+
+    //        
+    void InitPolylineLod();
+
+    //     
+    std::vector<svg::Point> GetBusPolyline(const transport_catalogue::bus_catalogue::Bus* bus) const;
+
+    //      bus_index    level
+    std::vector<svg::Point> GetBusPolyline(size_t bus_index, size_t level) const;
 
 private:
     double zoom_coef_ = 0.0;
@@ -130,8 +346,23 @@ private:
     double max_latitude_ = 0.0;
 
     std::map<const transport_catalogue::stop_catalogue::Stop*, svg::Point> stop_point_;
-    std::map<std::string_view, const transport_catalogue::stop_catalogue::Stop*> stops_;
-    std::map<std::string_view, const transport_catalogue::bus_catalogue::Bus*> buses_;
+    std::vector<std::pair<std::string_view, const transport_catalogue::stop_catalogue::Stop*>> stops_;
+    std::vector<std::pair<std::string_view, const transport_catalogue::bus_catalogue::Bus*>> buses_;
+
+    svg::StyleSheet styles_;
+    std::vector<svg::StyleId> line_styles_;
+    std::vector<svg::StyleId> bus_text_styles_;
+    svg::StyleId bus_underlayer_style_ = 0;
+    svg::StyleId circle_style_ = 0;
+    svg::StyleId stop_underlayer_style_ = 0;
+    svg::StyleId stop_text_style_ = 0;
+    std::vector<svg::StyleId> isochrone_styles_;
+
+    PolylineLod polyline_lod_;
+
+    mutable std::once_flag spatial_index_flag_;
+    mutable SpatialGrid bus_grid_;
+    mutable SpatialGrid stop_grid_;
 };
 
 } // namespace map_renderer
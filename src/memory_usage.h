@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace memory_usage {
+
+// ---------- Report ----------------------------------------------------------
+
+// Память, занятая одной структурой данных
+struct Item {
+    std::string name;
+    size_t bytes = 0;
+    size_t items = 0;
+};
+
+// Отчёт о памяти, занятой структурами данных базы
+class Report {
+public:
+    void Add(std::string name, size_t bytes, size_t items) {
+        items_.push_back({ std::move(name), bytes, items });
+    }
+
+    const std::vector<Item>& GetItems() const {
+        return items_;
+    }
+
+    size_t GetTotalBytes() const {
+        size_t total = 0;
+        for (const Item& item : items_) {
+            total += item.bytes;
+        }
+        return total;
+    }
+
+private:
+    std::vector<Item> items_;
+};
+
+// ---------- HeapSize --------------------------------------------------------
+
+/*
+* Оценка памяти, которую контейнер занимает в куче, без размера самого объекта.
+* Размеры узлов и блоков соответствуют libstdc++, каждое выделение учитывается
+* с накладными расходами malloc из glibc
+*/
+
+// Размер блока, который malloc из glibc выделяет под bytes байт
+inline size_t AllocationSize(size_t bytes) {
+    if (bytes == 0) {
+        return 0;
+    }
+    return std::max<size_t>(32, (bytes + sizeof(size_t) + 15) & ~size_t(15));
+}
+
+// Типы без собственной памяти в куче: числа, указатели, простые структуры
+template <typename Type, std::enable_if_t<std::is_trivially_copyable_v<Type>, bool> = true>
+size_t HeapSize(const Type&) {
+    return 0;
+}
+
+inline size_t HeapSize(const std::string& str) {
+    // короткие строки хранятся внутри объекта
+    constexpr size_t SSO_CAPACITY = 15;
+    return str.capacity() > SSO_CAPACITY ? AllocationSize(str.capacity() + 1) : 0;
+}
+
+template <typename First, typename Second>
+size_t HeapSize(const std::pair<First, Second>& value);
+
+template <typename Type>
+size_t HeapSize(const std::optional<Type>& value);
+
+template <typename Type>
+size_t HeapSize(const std::vector<Type>& container);
+
+template <typename Type>
+size_t HeapSize(const std::deque<Type>& container);
+
+template <typename Type>
+size_t HeapSize(const std::list<Type>& container);
+
+template <typename Key, typename Compare>
+size_t HeapSize(const std::set<Key, Compare>& container);
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+size_t HeapSize(const std::unordered_map<Key, Value, Hash, Equal>& container);
+
+// Сумма памяти элементов контейнера в куче
+template <typename Container>
+size_t ElementsHeapSize(const Container& container) {
+    size_t bytes = 0;
+    for (const auto& value : container) {
+        bytes += HeapSize(value);
+    }
+    return bytes;
+}
+
+template <typename First, typename Second>
+size_t HeapSize(const std::pair<First, Second>& value) {
+    return HeapSize(value.first) + HeapSize(value.second);
+}
+
+template <typename Type>
+size_t HeapSize(const std::optional<Type>& value) {
+    return value ? HeapSize(*value) : 0;
+}
+
+template <typename Type>
+size_t HeapSize(const std::vector<Type>& container) {
+    return AllocationSize(container.capacity() * sizeof(Type)) + ElementsHeapSize(container);
+}
+
+template <typename Type>
+size_t HeapSize(const std::deque<Type>& container) {
+    // deque хранит элементы блоками по 512 байт и массив указателей на блоки
+    constexpr size_t BLOCK_BYTES = 512;
+    constexpr size_t BLOCK_SIZE = sizeof(Type) < BLOCK_BYTES ? BLOCK_BYTES / sizeof(Type) : 1;
+    const size_t blocks = container.size() / BLOCK_SIZE + 1;
+    const size_t map_size = std::max<size_t>(8, blocks + 2);
+    return blocks * AllocationSize(BLOCK_SIZE * sizeof(Type)) + AllocationSize(map_size * sizeof(void*))
+        + ElementsHeapSize(container);
+}
+
+template <typename Type>
+size_t HeapSize(const std::list<Type>& container) {
+    // узел списка: два указателя и значение
+    return container.size() * AllocationSize(2 * sizeof(void*) + sizeof(Type)) + ElementsHeapSize(container);
+}
+
+template <typename Key, typename Compare>
+size_t HeapSize(const std::set<Key, Compare>& container) {
+    // узел красно-чёрного дерева: цвет, три указателя и значение
+    constexpr size_t NODE_HEADER = 4 * sizeof(void*);
+    return container.size() * AllocationSize(NODE_HEADER + sizeof(Key)) + ElementsHeapSize(container);
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+size_t HeapSize(const std::unordered_map<Key, Value, Hash, Equal>& container) {
+    using ValueType = typename std::unordered_map<Key, Value, Hash, Equal>::value_type;
+    // узел: указатель на следующий, значение и сохранённый хеш; единственная корзина хранится в объекте
+    constexpr size_t NODE_SIZE = sizeof(void*) + sizeof(ValueType) + sizeof(size_t);
+    const size_t buckets = container.bucket_count() > 1 ? AllocationSize(container.bucket_count() * sizeof(void*)) : 0;
+    return buckets + container.size() * AllocationSize(NODE_SIZE) + ElementsHeapSize(container);
+}
+
+} // namespace memory_usage
@@ -0,0 +1,325 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _LINUX_OS_
+#include <csignal>
+#include <pthread.h>
+#include <thread>
+#endif
+
+namespace metrics {
+
+using namespace std::literals;
+
+std::string_view GetStageName(Stage stage) {
+    switch (stage) {
+    case Stage::PARSE: return "parse"sv;
+    case Stage::ADD_STOPS: return "add_stops"sv;
+    case Stage::ADD_DISTANCES: return "add_distances"sv;
+    case Stage::BUILD_BUSES: return "build_buses"sv;
+    case Stage::BUILD_GRAPH: return "build_graph"sv;
+    case Stage::BUILD_ROUTER: return "build_router"sv;
+    case Stage::SERIALIZE: return "serialize"sv;
+    case Stage::DESERIALIZE: return "deserialize"sv;
+    case Stage::LOAD_ROUTER: return "load_router"sv;
+    case Stage::QUERY_STOP: return "query_stop"sv;
+    case Stage::QUERY_BUS: return "query_bus"sv;
+    case Stage::QUERY_MAP: return "query_map"sv;
+    case Stage::QUERY_MAP_TILE: return "query_map_tile"sv;
+    case Stage::QUERY_ROUTE: return "query_route"sv;
+    case Stage::QUERY_ROUTE_MATRIX: return "query_route_matrix"sv;
+    case Stage::QUERY_ISOCHRONE: return "query_isochrone"sv;
+    case Stage::QUERY_ALTERNATIVE_ROUTES: return "query_alternative_routes"sv;
+    case Stage::QUERY_PARETO_ROUTES: return "query_pareto_routes"sv;
+    case Stage::PRINT_RESPONSE: return "print_response"sv;
+    case Stage::COUNT: break;
+    }
+    return "unknown"sv;
+}
+
+// ---------- Histogram -------------------------------------------------------
+
+size_t Histogram::GetBucketIndex(uint64_t value) {
+    // значения меньше SUB_BUCKETS хранятся точно, каждое в своей корзине
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+
+    int exponent = 63;
+    while ((value >> exponent) == 0) {
+        --exponent;
+    }
+    if (exponent >= MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const size_t segment = static_cast<size_t>(shift + 1);
+    const size_t sub_bucket = static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+    return segment * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t Histogram::GetBucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    const int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value) {
+    Add(buckets_[GetBucketIndex(value)], 1);
+    Add(count_, 1);
+    Add(sum_, value);
+}
+
+void Histogram::Merge(const Histogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        const uint64_t count = other.GetBucketCount(i);
+        if (count > 0) {
+            Add(buckets_[i], count);
+        }
+    }
+    Add(count_, other.GetCount());
+    Add(sum_, other.GetSum());
+}
+
+uint64_t Histogram::GetQuantile(double q) const {
+    const uint64_t count = GetCount();
+    if (count == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * count)));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        cumulative += GetBucketCount(i);
+        if (cumulative >= rank) {
+            return GetBucketUpperBound(i);
+        }
+    }
+    return GetBucketUpperBound(BUCKET_COUNT - 1);
+}
+
+// ---------- Registry --------------------------------------------------------
+
+namespace {
+
+using StageHistograms = std::array<Histogram, STAGE_COUNT>;
+
+/*
+* Реестр гистограмм всех потоков. Каждый поток пишет только в свои гистограммы,
+* реестр нужен для чтения: при выводе метрик гистограммы потоков складываются.
+* Гистограммы завершившихся потоков прибавляются к retired_
+*/
+class Registry {
+public:
+    void Register(const StageHistograms* histograms) {
+        std::lock_guard guard(mutex_);
+        threads_.push_back(histograms);
+    }
+
+    void Unregister(const StageHistograms* histograms) {
+        std::lock_guard guard(mutex_);
+        threads_.erase(std::remove(threads_.begin(), threads_.end(), histograms), threads_.end());
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            retired_[i].Merge((*histograms)[i]);
+        }
+    }
+
+    // Возвращает сумму гистограмм всех потоков
+    std::unique_ptr<StageHistograms> Collect() const {
+        auto result = std::make_unique<StageHistograms>();
+
+        std::lock_guard guard(mutex_);
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            (*result)[i].Merge(retired_[i]);
+            for (const StageHistograms* histograms : threads_) {
+                (*result)[i].Merge((*histograms)[i]);
+            }
+        }
+        return result;
+    }
+
+    void SetFileName(const std::string& file_name) {
+        std::lock_guard guard(mutex_);
+        file_name_ = file_name;
+    }
+
+    std::string GetFileName() const {
+        std::lock_guard guard(mutex_);
+        return file_name_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<const StageHistograms*> threads_;
+    StageHistograms retired_;
+    std::string file_name_;
+};
+
+// Реестр не разрушается: потоки и обработчик atexit могут обратиться к нему при завершении программы
+Registry& GetRegistry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+// Гистограммы потока, создаются при первой записи из этого потока
+class ThreadHistograms {
+public:
+    ThreadHistograms()
+        : histograms_(std::make_unique<StageHistograms>()) {
+        GetRegistry().Register(histograms_.get());
+    }
+
+    ~ThreadHistograms() {
+        GetRegistry().Unregister(histograms_.get());
+    }
+
+    Histogram& Get(Stage stage) {
+        return (*histograms_)[static_cast<size_t>(stage)];
+    }
+
+private:
+    std::unique_ptr<StageHistograms> histograms_;
+};
+
+std::atomic<bool> enabled = false;
+
+// Границы корзин гистограммы Prometheus в секундах
+const std::vector<double> PROMETHEUS_BUCKETS = {
+    1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4,
+    1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0 };
+
+const std::vector<std::pair<std::string_view, double>> PROMETHEUS_QUANTILES = {
+    { "0.5"sv, 0.5 }, { "0.9"sv, 0.9 }, { "0.99"sv, 0.99 }, { "0.999"sv, 0.999 } };
+
+constexpr double NANOSECONDS_IN_SECOND = 1e9;
+
+#ifdef _LINUX_OS_
+// Поток, выводящий метрики по сигналу SIGUSR1. Сигнал блокируется во всех потоках
+// и принимается через sigwait, поэтому вывод выполняется вне обработчика сигнала
+void StartSignalThread() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    if (pthread_sigmask(SIG_BLOCK, &signals, nullptr) != 0) {
+        return;
+    }
+
+    std::thread([signals]() {
+        while (true) {
+            int signal = 0;
+            if (sigwait(&signals, &signal) == 0 && signal == SIGUSR1) {
+                Dump();
+            }
+        }
+    }).detach();
+}
+#endif
+
+} // namespace
+
+bool IsEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Init(const std::string& file_name) {
+    enabled.store(true, std::memory_order_relaxed);
+
+    if (file_name.empty()) {
+        return;
+    }
+
+    GetRegistry().SetFileName(file_name);
+    std::atexit(Dump);
+
+#ifdef _LINUX_OS_
+    StartSignalThread();
+#endif
+}
+
+void InitFromEnvironment() {
+    if (const char* file_name = std::getenv("TRANSPORT_METRICS_FILE")) {
+        Init(file_name);
+    }
+}
+
+void Record(Stage stage, uint64_t nanoseconds) {
+    thread_local ThreadHistograms histograms;
+    histograms.Get(stage).Record(nanoseconds);
+}
+
+void PrintPrometheus(std::ostream& out) {
+    const auto histograms = GetRegistry().Collect();
+
+    out << "# HELP transport_stage_duration_seconds Duration of transport catalogue processing stages.\n"sv;
+    out << "# TYPE transport_stage_duration_seconds histogram\n"sv;
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        const Histogram& histogram = (*histograms)[i];
+        const std::string_view name = GetStageName(static_cast<Stage>(i));
+
+        // корзины Prometheus складываются из мелких корзин, верхняя граница которых не больше le
+        size_t bucket = 0;
+        uint64_t cumulative = 0;
+        for (double le : PROMETHEUS_BUCKETS) {
+            const double le_ns = le * NANOSECONDS_IN_SECOND;
+            while (bucket < Histogram::BUCKET_COUNT && Histogram::GetBucketUpperBound(bucket) <= le_ns) {
+                cumulative += histogram.GetBucketCount(bucket++);
+            }
+            out << "transport_stage_duration_seconds_bucket{stage=\""sv << name << "\",le=\""sv << le << "\"} "sv
+                << cumulative << '\n';
+        }
+        out << "transport_stage_duration_seconds_bucket{stage=\""sv << name << "\",le=\"+Inf\"} "sv
+            << histogram.GetCount() << '\n';
+        out << "transport_stage_duration_seconds_sum{stage=\""sv << name << "\"} "sv
+            << histogram.GetSum() / NANOSECONDS_IN_SECOND << '\n';
+        out << "transport_stage_duration_seconds_count{stage=\""sv << name << "\"} "sv
+            << histogram.GetCount() << '\n';
+    }
+
+    out << "# HELP transport_stage_duration_quantile_seconds Latency quantiles of transport catalogue processing stages.\n"sv;
+    out << "# TYPE transport_stage_duration_quantile_seconds gauge\n"sv;
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        const Histogram& histogram = (*histograms)[i];
+        if (histogram.GetCount() == 0) {
+            continue;
+        }
+
+        const std::string_view name = GetStageName(static_cast<Stage>(i));
+        for (const auto& [label, q] : PROMETHEUS_QUANTILES) {
+            out << "transport_stage_duration_quantile_seconds{stage=\""sv << name << "\",quantile=\""sv << label << "\"} "sv
+                << histogram.GetQuantile(q) / NANOSECONDS_IN_SECOND << '\n';
+        }
+    }
+}
+
+void Dump() {
+    const std::string file_name = GetRegistry().GetFileName();
+    if (file_name.empty()) {
+        return;
+    }
+
+    // метрики пишутся во временный файл и переименовываются, чтобы читатель не увидел половину файла
+    const std::string temp_file_name = file_name + ".tmp"s;
+    {
+        std::ofstream out(temp_file_name, std::ofstream::out | std::ofstream::trunc);
+        if (!out) {
+            return;
+        }
+        PrintPrometheus(out);
+    }
+    std::rename(temp_file_name.c_str(), file_name.c_str());
+}
+
+} // namespace metrics
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace metrics {
+
+// Этапы работы программы, время которых измеряется
+enum class Stage : uint8_t {
+    PARSE,
+    ADD_STOPS,
+    ADD_DISTANCES,
+    BUILD_BUSES,
+    BUILD_GRAPH,
+    BUILD_ROUTER,
+    SERIALIZE,
+    DESERIALIZE,
+    LOAD_ROUTER,
+    QUERY_STOP,
+    QUERY_BUS,
+    QUERY_MAP,
+    QUERY_MAP_TILE,
+    QUERY_ROUTE,
+    QUERY_ROUTE_MATRIX,
+    QUERY_ISOCHRONE,
+    QUERY_ALTERNATIVE_ROUTES,
+    QUERY_PARETO_ROUTES,
+    PRINT_RESPONSE,
+    COUNT
+};
+
+constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+
+// Название этапа в метках Prometheus
+std::string_view GetStageName(Stage stage);
+
+// ---------- Histogram -------------------------------------------------------
+
+/*
+* Гистограмма задержек в наносекундах с логарифмически-линейными корзинами, как в HdrHistogram:
+* значения делятся по степеням двойки, каждая степень - на SUB_BUCKETS равных частей.
+* Относительная погрешность не больше 1 / SUB_BUCKETS при фиксированном размере.
+* Пишет в гистограмму только её поток, читать можно из любого
+*/
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    // значения до 2^MAX_EXPONENT наносекунд (больше 18 минут), большие попадают в последнюю корзину
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Добавляет значение. Вызывается только потоком-владельцем
+    void Record(uint64_t value);
+
+    // Прибавляет к гистограмме значения другой
+    void Merge(const Histogram& other);
+
+    uint64_t GetCount() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetSum() const {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetBucketCount(size_t index) const {
+        return buckets_[index].load(std::memory_order_relaxed);
+    }
+
+    // Номер корзины значения
+    static size_t GetBucketIndex(uint64_t value);
+
+    // Наибольшее значение, попадающее в корзину
+    static uint64_t GetBucketUpperBound(size_t index);
+
+    // Значение квантиля q из [0, 1] с точностью до корзины
+    uint64_t GetQuantile(double q) const;
+
+private:
+    static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+        // единственный писатель, поэтому атомарное сложение не нужно
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_ = {};
+    std::atomic<uint64_t> count_ = 0;
+    std::atomic<uint64_t> sum_ = 0;
+};
+
+// ---------- Registry --------------------------------------------------------
+
+// Включена ли запись метрик. Пока метрики выключены, таймеры не обращаются к часам
+bool IsEnabled();
+
+// Включает запись метрик; при непустом file_name метрики записываются в файл при выходе из
+// программы и, в Linux, по сигналу SIGUSR1. Вызывается в начале main до запуска потоков
+void Init(const std::string& file_name);
+
+// Включает метрики, если задана переменная окружения TRANSPORT_METRICS_FILE
+void InitFromEnvironment();
+
+// Добавляет длительность этапа в гистограмму текущего потока
+void Record(Stage stage, uint64_t nanoseconds);
+
+// Выводит метрики всех потоков в текстовом формате Prometheus
+void PrintPrometheus(std::ostream& out);
+
+// Записывает метрики в файл, заданный в Init
+void Dump();
+
+// ---------- ScopedTimer -----------------------------------------------------
+
+// Измеряет время жизни объекта и добавляет его в гистограмму этапа
+class ScopedTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedTimer(Stage stage)
+        : stage_(stage)
+        , enabled_(IsEnabled()) {
+        if (enabled_) {
+            start_ = Clock::now();
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator= (const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        if (enabled_) {
+            const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_);
+            Record(stage_, static_cast<uint64_t>(duration.count()));
+        }
+    }
+
+private:
+    Stage stage_;
+    bool enabled_ = false;
+    Clock::time_point start_;
+};
+
+} // namespace metrics
+
+#define METRICS_CONCAT_INTERNAL(X, Y) X ## Y
+#define METRICS_CONCAT(X, Y) METRICS_CONCAT_INTERNAL(X, Y)
+#define METRICS_SCOPE(stage) metrics::ScopedTimer METRICS_CONCAT(metricsTimer, __LINE__)(stage)
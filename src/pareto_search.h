@@ -0,0 +1,168 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+namespace graph {
+
+    /*
+    * Поиск путей, оптимальных по Парето по двум критериям: весу и количеству отмеченных рёбер
+    * (например, посадок в транспорт). Метка - пара (вершина, количество отмеченных рёбер),
+    * метки фиксируются в порядке возрастания веса, как в алгоритме Дейкстры.
+    * Метка отбрасывается, если в её вершине уже зафиксирована метка не хуже по обоим критериям,
+    * поэтому у каждой вершины фиксируется не больше max_count + 1 метки.
+    * Состояние поиска переиспользуется между запусками: метки прошлого поиска помечены старой
+    * меткой запуска, поэтому сброс не требует обхода меток. Память растёт, только если
+    * очередной запуск требует больше слоёв или вершин, чем предыдущие
+    */
+    template <typename Weight>
+    class ParetoSearch {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        struct Path {
+            Weight weight{};
+            uint32_t count = 0;
+            std::vector<EdgeId> edges;
+        };
+
+        ParetoSearch() = default;
+
+        ParetoSearch(const Graph& graph, uint32_t max_count) {
+            Prepare(graph, max_count);
+        }
+
+        // Метод задаёт граф и наибольшее количество отмеченных рёбер для следующих запусков.
+        // Память перевыделяется, только если не хватает слоёв или вершин
+        void Prepare(const Graph& graph, uint32_t max_count) {
+            graph_ = &graph;
+            max_count_ = max_count;
+            const size_t vertex_count = graph.GetVertexCount();
+            if (max_count + 1 > layers_) {
+                layers_ = max_count + 1;
+                vertex_capacity_ = std::max(vertex_capacity_, vertex_count);
+                labels_.assign(vertex_capacity_ * layers_, Label{});
+                vertices_.assign(vertex_capacity_, VertexData{});
+            }
+            else if (vertex_count > vertex_capacity_) {
+                vertex_capacity_ = vertex_count;
+                labels_.resize(vertex_capacity_ * layers_);
+                vertices_.resize(vertex_capacity_);
+            }
+        }
+
+        /*
+        * Метод возвращает Парето-фронт путей из from в to с не более чем max_count отмеченными
+        * рёбрами в порядке возрастания веса (и убывания количества отмеченных рёбер).
+        * is_counted(edge_id) сообщает, отмечено ли ребро
+        */
+        template <typename IsCounted>
+        std::vector<Path> Run(VertexId from, VertexId to, IsCounted is_counted) {
+            std::vector<Path> front;
+            Start();
+            Push(from, 0, ZERO_WEIGHT, NO_EDGE);
+
+            while (!queue_.empty()) {
+                std::pop_heap(queue_.begin(), queue_.end(), std::greater<>{});
+                const auto [weight, count, vertex] = queue_.back();
+                queue_.pop_back();
+
+                const Label& label = labels_[vertex * layers_ + count];
+                if (weight > label.weight || IsDominated(vertex, count) || IsDominated(to, count)) {
+                    continue;
+                }
+                vertices_[vertex] = { count, stamp_ };
+
+                if (vertex == to) {
+                    front.push_back({ weight, count, GetPath(to, count, is_counted) });
+                    continue;
+                }
+
+                for (const EdgeId edge_id : graph_->GetIncidentEdges(vertex)) {
+                    const auto& edge = graph_->GetEdge(edge_id);
+                    const uint32_t next_count = count + (is_counted(edge_id) ? 1 : 0);
+                    if (next_count <= max_count_ && !IsDominated(edge.to, next_count)) {
+                        Push(edge.to, next_count, weight + edge.weight, edge_id);
+                    }
+                }
+            }
+
+            return front;
+        }
+
+    private:
+        static constexpr uint32_t NO_COUNT = std::numeric_limits<uint32_t>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        static constexpr Weight ZERO_WEIGHT{};
+
+        struct Label {
+            Weight weight{};
+            EdgeId prev_edge = NO_EDGE;
+            uint32_t stamp = 0;
+        };
+
+        // Наименьшее количество отмеченных рёбер среди зафиксированных меток вершины
+        struct VertexData {
+            uint32_t min_settled_count = NO_COUNT;
+            uint32_t stamp = 0;
+        };
+
+        // Метод начинает новый запуск, метки прошлых запусков становятся недействительными
+        void Start() {
+            if (++stamp_ == 0) {
+                // после переполнения метки старые пометки могли бы совпасть с новыми
+                std::fill(labels_.begin(), labels_.end(), Label{});
+                std::fill(vertices_.begin(), vertices_.end(), VertexData{});
+                stamp_ = 1;
+            }
+            queue_.clear();
+        }
+
+        // В вершине уже зафиксирована метка с не большим весом и не большим количеством
+        bool IsDominated(VertexId vertex, uint32_t count) const {
+            const VertexData& data = vertices_[vertex];
+            return data.stamp == stamp_ && data.min_settled_count <= count;
+        }
+
+        void Push(VertexId vertex, uint32_t count, Weight weight, EdgeId prev_edge) {
+            Label& label = labels_[vertex * layers_ + count];
+            if (label.stamp == stamp_ && !(weight < label.weight)) {
+                return;
+            }
+            label = { weight, prev_edge, stamp_ };
+            queue_.push_back({ weight, count, vertex });
+            std::push_heap(queue_.begin(), queue_.end(), std::greater<>{});
+        }
+
+        template <typename IsCounted>
+        std::vector<EdgeId> GetPath(VertexId vertex, uint32_t count, IsCounted& is_counted) const {
+            std::vector<EdgeId> edges;
+            for (EdgeId edge_id = labels_[vertex * layers_ + count].prev_edge; edge_id != NO_EDGE;
+                edge_id = labels_[vertex * layers_ + count].prev_edge) {
+                edges.push_back(edge_id);
+                count -= is_counted(edge_id) ? 1 : 0;
+                vertex = graph_->GetEdge(edge_id).from;
+            }
+            std::reverse(edges.begin(), edges.end());
+            return edges;
+        }
+
+        const Graph* graph_ = nullptr;
+        uint32_t max_count_ = 0;
+        // Слоёв и вершин, под которые выделена память; индекс метки - vertex * layers_ + count
+        uint32_t layers_ = 0;
+        size_t vertex_capacity_ = 0;
+        std::vector<Label> labels_;
+        std::vector<VertexData> vertices_;
+        std::vector<std::tuple<Weight, uint32_t, VertexId>> queue_;
+        uint32_t stamp_ = 0;
+    };
+
+}  // namespace graph
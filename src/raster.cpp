@@ -0,0 +1,496 @@
+#include "raster.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <zlib.h>
+
+namespace raster {
+
+namespace {
+
+// Растровый шрифт 5x7 для символов ASCII с кодами от 32 до 126.
+// Каждый символ - пять столбцов, младший бит столбца - верхняя строка
+constexpr uint8_t FONT_FIRST_CHAR = 32;
+constexpr uint8_t FONT_LAST_CHAR = 126;
+constexpr int FONT_COLUMNS = 5;
+constexpr int FONT_ROWS = 7;
+// ширина и высота ячейки символа вместе с промежутками
+constexpr int FONT_CELL_WIDTH = 6;
+constexpr int FONT_CELL_HEIGHT = 8;
+
+constexpr uint8_t FONT[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1][FONT_COLUMNS] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 },
+    { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 },
+    { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 }, { 0x00, 0x1C, 0x22, 0x41, 0x00 },
+    { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },
+    { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 },
+    { 0x20, 0x10, 0x08, 0x04, 0x02 }, { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 },
+    { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 }, { 0x18, 0x14, 0x12, 0x7F, 0x10 },
+    { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+    { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x36, 0x36, 0x00, 0x00 },
+    { 0x00, 0x56, 0x36, 0x00, 0x00 }, { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 },
+    { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 }, { 0x32, 0x49, 0x79, 0x41, 0x3E },
+    { 0x7E, 0x11, 0x11, 0x11, 0x7E }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },
+    { 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x09, 0x01 },
+    { 0x3E, 0x41, 0x49, 0x49, 0x7A }, { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 },
+    { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 }, { 0x7F, 0x40, 0x40, 0x40, 0x40 },
+    { 0x7F, 0x02, 0x0C, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },
+    { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 },
+    { 0x46, 0x49, 0x49, 0x49, 0x31 }, { 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F },
+    { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F }, { 0x63, 0x14, 0x08, 0x14, 0x63 },
+    { 0x07, 0x08, 0x70, 0x08, 0x07 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 },
+    { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 },
+    { 0x40, 0x40, 0x40, 0x40, 0x40 }, { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 },
+    { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 }, { 0x38, 0x44, 0x44, 0x48, 0x7F },
+    { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x0C, 0x52, 0x52, 0x52, 0x3E },
+    { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3D, 0x00 },
+    { 0x7F, 0x10, 0x28, 0x44, 0x00 }, { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 },
+    { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 }, { 0x7C, 0x14, 0x14, 0x14, 0x08 },
+    { 0x08, 0x14, 0x14, 0x18, 0x7C }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+    { 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C },
+    { 0x3C, 0x40, 0x30, 0x40, 0x3C }, { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C },
+    { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 }, { 0x00, 0x00, 0x7F, 0x00, 0x00 },
+    { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x10, 0x08, 0x08, 0x10, 0x08 },
+};
+
+const std::unordered_map<std::string_view, Pixel>& GetNamedColors() {
+    static const std::unordered_map<std::string_view, Pixel> colors = {
+        { "black", { 0, 0, 0, 255 } }, { "white", { 255, 255, 255, 255 } },
+        { "red", { 255, 0, 0, 255 } }, { "green", { 0, 128, 0, 255 } },
+        { "blue", { 0, 0, 255, 255 } }, { "yellow", { 255, 255, 0, 255 } },
+        { "orange", { 255, 165, 0, 255 } }, { "purple", { 128, 0, 128, 255 } },
+        { "gray", { 128, 128, 128, 255 } }, { "grey", { 128, 128, 128, 255 } },
+        { "brown", { 165, 42, 42, 255 } }, { "pink", { 255, 192, 203, 255 } },
+        { "cyan", { 0, 255, 255, 255 } }, { "aqua", { 0, 255, 255, 255 } },
+        { "magenta", { 255, 0, 255, 255 } }, { "fuchsia", { 255, 0, 255, 255 } },
+        { "lime", { 0, 255, 0, 255 } }, { "maroon", { 128, 0, 0, 255 } },
+        { "navy", { 0, 0, 128, 255 } }, { "olive", { 128, 128, 0, 255 } },
+        { "teal", { 0, 128, 128, 255 } }, { "silver", { 192, 192, 192, 255 } },
+        { "gold", { 255, 215, 0, 255 } }, { "violet", { 238, 130, 238, 255 } },
+        { "indigo", { 75, 0, 130, 255 } }, { "coral", { 255, 127, 80, 255 } },
+        { "salmon", { 250, 128, 114, 255 } }, { "khaki", { 240, 230, 140, 255 } },
+        { "crimson", { 220, 20, 60, 255 } }, { "darkgreen", { 0, 100, 0, 255 } },
+        { "darkblue", { 0, 0, 139, 255 } }, { "darkred", { 139, 0, 0, 255 } },
+        { "lightgray", { 211, 211, 211, 255 } }, { "lightgrey", { 211, 211, 211, 255 } },
+    };
+    return colors;
+}
+
+struct PixelGetter {
+    std::optional<Pixel> operator()(std::monostate) const {
+        return std::nullopt;
+    }
+
+    std::optional<Pixel> operator()(const std::string& color) const {
+        const auto& colors = GetNamedColors();
+        auto it = colors.find(color);
+        if (it == colors.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::optional<Pixel> operator()(const svg::Rgb& rgb) const {
+        return Pixel{ rgb.red, rgb.green, rgb.blue, 255 };
+    }
+
+    std::optional<Pixel> operator()(const svg::Rgba& rgba) const {
+        const double opacity = std::clamp(rgba.opacity, 0.0, 1.0);
+        return Pixel{ rgba.red, rgba.green, rgba.blue, static_cast<uint8_t>(std::lround(opacity * 255.0)) };
+    }
+};
+
+// Деление на 255 с округлением для значений до 255 * 255
+inline uint32_t Div255(uint32_t value) {
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+void AppendUint32(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>((value >> 24) & 0xFF));
+    out.push_back(static_cast<char>((value >> 16) & 0xFF));
+    out.push_back(static_cast<char>((value >> 8) & 0xFF));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+void AppendPngChunk(std::string& out, const char* type, const std::string& data) {
+    AppendUint32(out, static_cast<uint32_t>(data.size()));
+    const size_t type_begin = out.size();
+    out.append(type, 4);
+    out.append(data);
+    const uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(out.data() + type_begin), static_cast<uInt>(out.size() - type_begin));
+    AppendUint32(out, static_cast<uint32_t>(crc));
+}
+
+} // namespace
+
+std::optional<Pixel> ToPixel(const svg::Color& color) {
+    return std::visit(PixelGetter{}, color);
+}
+
+// ---------- SpanBuffer ------------------------------------------------------
+
+SpanBuffer::SpanBuffer(int width, int height)
+    : width_(width)
+    , height_(height)
+    , rows_(std::max(0, height)) {
+}
+
+void SpanBuffer::Add(int y, double x_begin, double x_end) {
+    if (y < 0 || y >= height_) {
+        return;
+    }
+    // закрашиваются пиксели, центры которых попадают в отрезок
+    const int begin = std::max(0, static_cast<int>(std::ceil(x_begin - 0.5)));
+    const int end = std::min(width_ - 1, static_cast<int>(std::floor(x_end - 0.5)));
+    if (begin <= end) {
+        rows_[y].emplace_back(begin, end);
+    }
+}
+
+void SpanBuffer::AddCircle(svg::Point center, double radius) {
+    const int y_begin = std::max(0, static_cast<int>(std::floor(center.y - radius)));
+    const int y_end = std::min(height_ - 1, static_cast<int>(std::ceil(center.y + radius)));
+
+    for (int y = y_begin; y <= y_end; ++y) {
+        const double dy = y + 0.5 - center.y;
+        const double square = radius * radius - dy * dy;
+        if (square >= 0.0) {
+            const double dx = std::sqrt(square);
+            Add(y, center.x - dx, center.x + dx);
+        }
+    }
+}
+
+void SpanBuffer::AddRing(svg::Point center, double inner_radius, double outer_radius) {
+    const int y_begin = std::max(0, static_cast<int>(std::floor(center.y - outer_radius)));
+    const int y_end = std::min(height_ - 1, static_cast<int>(std::ceil(center.y + outer_radius)));
+
+    for (int y = y_begin; y <= y_end; ++y) {
+        const double dy = y + 0.5 - center.y;
+        const double outer = outer_radius * outer_radius - dy * dy;
+        if (outer < 0.0) {
+            continue;
+        }
+        const double outer_dx = std::sqrt(outer);
+        const double inner = inner_radius * inner_radius - dy * dy;
+        if (inner <= 0.0) {
+            Add(y, center.x - outer_dx, center.x + outer_dx);
+            continue;
+        }
+        const double inner_dx = std::sqrt(inner);
+        Add(y, center.x - outer_dx, center.x - inner_dx);
+        Add(y, center.x + inner_dx, center.x + outer_dx);
+    }
+}
+
+void SpanBuffer::AddCapsule(svg::Point from, svg::Point to, double width) {
+    const double radius = width / 2.0;
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length = std::sqrt(dx * dx + dy * dy);
+
+    if (length < 1e-9) {
+        AddCircle(from, radius);
+        return;
+    }
+
+    // углы прямоугольника, заметаемого отрезком
+    const double nx = -dy / length * radius;
+    const double ny = dx / length * radius;
+    const std::array<svg::Point, 4> quad = {
+        svg::Point(from.x + nx, from.y + ny), svg::Point(to.x + nx, to.y + ny),
+        svg::Point(to.x - nx, to.y - ny), svg::Point(from.x - nx, from.y - ny) };
+
+    const int y_begin = std::max(0, static_cast<int>(std::floor(std::min(from.y, to.y) - radius)));
+    const int y_end = std::min(height_ - 1, static_cast<int>(std::ceil(std::max(from.y, to.y) + radius)));
+
+    for (int y = y_begin; y <= y_end; ++y) {
+        const double center_y = y + 0.5;
+        double x_begin = std::numeric_limits<double>::max();
+        double x_end = std::numeric_limits<double>::lowest();
+
+        // скруглённые концы
+        for (const svg::Point& end : { from, to }) {
+            const double square = radius * radius - (center_y - end.y) * (center_y - end.y);
+            if (square >= 0.0) {
+                const double half = std::sqrt(square);
+                x_begin = std::min(x_begin, end.x - half);
+                x_end = std::max(x_end, end.x + half);
+            }
+        }
+
+        // тело отрезка: пересечение строки со сторонами прямоугольника
+        for (size_t i = 0; i < quad.size(); ++i) {
+            const svg::Point& p = quad[i];
+            const svg::Point& q = quad[(i + 1) % quad.size()];
+            if ((p.y - center_y) * (q.y - center_y) <= 0.0 && std::abs(q.y - p.y) > 1e-12) {
+                const double x = p.x + (center_y - p.y) * (q.x - p.x) / (q.y - p.y);
+                x_begin = std::min(x_begin, x);
+                x_end = std::max(x_end, x);
+            }
+        }
+
+        // фигура выпуклая, поэтому пересечение со строкой - один отрезок
+        if (x_begin <= x_end) {
+            Add(y, x_begin, x_end);
+        }
+    }
+}
+
+void SpanBuffer::AddRect(double x_begin, double y_begin, double x_end, double y_end) {
+    const int row_begin = std::max(0, static_cast<int>(std::ceil(y_begin - 0.5)));
+    const int row_end = std::min(height_ - 1, static_cast<int>(std::floor(y_end - 0.5)));
+    for (int y = row_begin; y <= row_end; ++y) {
+        Add(y, x_begin, x_end);
+    }
+}
+
+std::vector<std::pair<int, int>> SpanBuffer::GetRow(int y) {
+    std::vector<std::pair<int, int>>& row = rows_[y];
+    if (row.size() < 2) {
+        return row;
+    }
+
+    std::sort(row.begin(), row.end());
+    std::vector<std::pair<int, int>> merged = { row.front() };
+    for (size_t i = 1; i < row.size(); ++i) {
+        if (row[i].first <= merged.back().second + 1) {
+            merged.back().second = std::max(merged.back().second, row[i].second);
+        }
+        else {
+            merged.push_back(row[i]);
+        }
+    }
+    return merged;
+}
+
+void SpanBuffer::Clear() {
+    for (auto& row : rows_) {
+        row.clear();
+    }
+}
+
+// ---------- Canvas ----------------------------------------------------------
+
+Canvas::Canvas(int width, int height)
+    : width_(std::max(0, width))
+    , height_(std::max(0, height))
+    , data_(static_cast<size_t>(width_) * height_ * 4, 255) {
+}
+
+void Canvas::FillSpan(int y, int x_begin, int x_end, Pixel color) {
+    uint8_t* pixels = data_.data() + (static_cast<size_t>(y) * width_ + x_begin) * 4;
+    const int count = x_end - x_begin + 1;
+
+    // простые циклы без ветвлений внутри компилятор разворачивает в векторные инструкции
+    if (color.alpha == 255) {
+        for (int i = 0; i < count; ++i) {
+            pixels[4 * i + 0] = color.red;
+            pixels[4 * i + 1] = color.green;
+            pixels[4 * i + 2] = color.blue;
+            pixels[4 * i + 3] = 255;
+        }
+        return;
+    }
+
+    const uint32_t alpha = color.alpha;
+    const uint32_t inverse = 255 - alpha;
+    const uint32_t red = color.red * alpha;
+    const uint32_t green = color.green * alpha;
+    const uint32_t blue = color.blue * alpha;
+
+    for (int i = 0; i < count; ++i) {
+        pixels[4 * i + 0] = static_cast<uint8_t>(Div255(red + pixels[4 * i + 0] * inverse));
+        pixels[4 * i + 1] = static_cast<uint8_t>(Div255(green + pixels[4 * i + 1] * inverse));
+        pixels[4 * i + 2] = static_cast<uint8_t>(Div255(blue + pixels[4 * i + 2] * inverse));
+    }
+}
+
+void Canvas::Fill(SpanBuffer& spans, Pixel color) {
+    if (color.alpha == 0) {
+        spans.Clear();
+        return;
+    }
+    for (int y = 0; y < spans.GetHeight(); ++y) {
+        for (const auto& [begin, end] : spans.GetRow(y)) {
+            FillSpan(y, begin, end, color);
+        }
+    }
+    spans.Clear();
+}
+
+std::string Canvas::EncodePng() const {
+    // каждая строка начинается с байта фильтра, фильтр 0 - без преобразования
+    const size_t row_size = static_cast<size_t>(width_) * 4;
+    std::string raw;
+    raw.reserve((row_size + 1) * height_);
+    for (int y = 0; y < height_; ++y) {
+        raw.push_back('\0');
+        raw.append(reinterpret_cast<const char*>(data_.data()) + y * row_size, row_size);
+    }
+
+    uLongf compressed_size = compressBound(static_cast<uLong>(raw.size()));
+    std::string compressed(compressed_size, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size,
+        reinterpret_cast<const Bytef*>(raw.data()), static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::runtime_error("PNG compression failed");
+    }
+    compressed.resize(compressed_size);
+
+    std::string header;
+    AppendUint32(header, static_cast<uint32_t>(width_));
+    AppendUint32(header, static_cast<uint32_t>(height_));
+    // 8 бит на компоненту, тип цвета 6 - RGBA, стандартные сжатие и фильтрация, без чересстрочности
+    header.append({ '\x08', '\x06', '\x00', '\x00', '\x00' });
+
+    std::string png = "\x89PNG\r\n\x1a\n";
+    AppendPngChunk(png, "IHDR", header);
+    AppendPngChunk(png, "IDAT", compressed);
+    AppendPngChunk(png, "IEND", std::string());
+    return png;
+}
+
+// ---------- Rasterizer ------------------------------------------------------
+
+Rasterizer::Rasterizer(int width, int height)
+    : canvas_(width, height)
+    , spans_(width, height) {
+}
+
+void Rasterizer::Draw(const svg::CommandList& commands, const svg::StyleSheet& styles) {
+    for (const svg::CommandList::Command& command : commands.GetCommands()) {
+        const svg::Style& style = styles.Get(command.style);
+        switch (command.type) {
+        case svg::CommandType::CIRCLE:
+            DrawCircle(command, style);
+            break;
+        case svg::CommandType::POLYLINE:
+            DrawPolyline(commands, command, style);
+            break;
+        case svg::CommandType::TEXT:
+            DrawText(commands.GetText(command), command.point, style);
+            break;
+        }
+    }
+}
+
+void Rasterizer::DrawCircle(const svg::CommandList::Command& command, const svg::Style& style) {
+    const std::optional<Pixel> fill = style.GetFillColor() ? ToPixel(*style.GetFillColor()) : Pixel{ 0, 0, 0, 255 };
+    const std::optional<Pixel> stroke = style.GetStrokeColor() ? ToPixel(*style.GetStrokeColor()) : std::nullopt;
+    const double stroke_width = style.GetStrokeWidth().value_or(1.0);
+
+    if (fill) {
+        spans_.AddCircle(command.point, command.radius);
+        canvas_.Fill(spans_, *fill);
+    }
+    if (stroke) {
+        // контур - кольцо толщины stroke_width по окружности
+        spans_.AddRing(command.point, command.radius - stroke_width / 2.0, command.radius + stroke_width / 2.0);
+        canvas_.Fill(spans_, *stroke);
+    }
+}
+
+void Rasterizer::DrawPolyline(const svg::CommandList& commands, const svg::CommandList::Command& command, const svg::Style& style) {
+    const std::optional<Pixel> stroke = style.GetStrokeColor() ? ToPixel(*style.GetStrokeColor()) : std::nullopt;
+    if (!stroke || command.begin == command.end) {
+        return;
+    }
+
+    // отрезки со скруглёнными концами вместе дают скруглённые концы и соединения ломаной
+    const std::vector<svg::Point>& points = commands.GetPoints();
+    const double width = style.GetStrokeWidth().value_or(1.0);
+    spans_.AddCircle(points[command.begin], width / 2.0);
+    for (uint32_t i = command.begin; i + 1 < command.end; ++i) {
+        spans_.AddCapsule(points[i], points[i + 1], width);
+    }
+    canvas_.Fill(spans_, *stroke);
+}
+
+void Rasterizer::DrawText(std::string_view text, svg::Point position, const svg::Style& style) {
+    const std::optional<Pixel> fill = style.GetFillColor() ? ToPixel(*style.GetFillColor()) : Pixel{ 0, 0, 0, 255 };
+    const std::optional<Pixel> stroke = style.GetStrokeColor() ? ToPixel(*style.GetStrokeColor()) : std::nullopt;
+    const bool is_bold = style.GetFontWeight() && *style.GetFontWeight() == "bold";
+
+    const double scale = static_cast<double>(style.GetFontSize()) / FONT_CELL_HEIGHT;
+    const double left = position.x + style.GetOffset().x;
+    // базовая линия проходит под последней строкой символа
+    const double top = position.y + style.GetOffset().y - FONT_ROWS * scale;
+
+    auto add_glyphs = [&](double grow) {
+        double x = left;
+        for (unsigned char c : text) {
+            // продолжения многобайтовых символов UTF-8 пропускаются, сам символ заменяется на '?'
+            if ((c & 0xC0) == 0x80) {
+                continue;
+            }
+            if (c < FONT_FIRST_CHAR || c > FONT_LAST_CHAR) {
+                c = '?';
+            }
+            const uint8_t* glyph = FONT[c - FONT_FIRST_CHAR];
+            for (int column = 0; column < FONT_COLUMNS; ++column) {
+                for (int row = 0; row < FONT_ROWS; ++row) {
+                    if ((glyph[column] >> row) & 1) {
+                        const double x_begin = x + column * scale;
+                        const double y_begin = top + row * scale;
+                        const double x_end = x_begin + scale * (is_bold ? 2.0 : 1.0);
+                        spans_.AddRect(x_begin - grow, y_begin - grow, x_end + grow, y_begin + scale + grow);
+                    }
+                }
+            }
+            x += FONT_CELL_WIDTH * scale + (is_bold ? scale : 0.0);
+        }
+    };
+
+    if (fill) {
+        add_glyphs(0.0);
+        canvas_.Fill(spans_, *fill);
+    }
+    if (stroke) {
+        add_glyphs(style.GetStrokeWidth().value_or(1.0) / 2.0);
+        canvas_.Fill(spans_, *stroke);
+    }
+}
+
+std::string RenderPng(const svg::CommandList& commands, const svg::StyleSheet& styles, int width, int height) {
+    Rasterizer rasterizer(width, height);
+    rasterizer.Draw(commands, styles);
+    return rasterizer.GetCanvas().EncodePng();
+}
+
+std::string EncodeBase64(std::string_view data) {
+    static constexpr char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string result;
+    result.reserve((data.size() + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        const uint32_t value = (static_cast<uint8_t>(data[i]) << 16) | (static_cast<uint8_t>(data[i + 1]) << 8) | static_cast<uint8_t>(data[i + 2]);
+        result.push_back(ALPHABET[(value >> 18) & 0x3F]);
+        result.push_back(ALPHABET[(value >> 12) & 0x3F]);
+        result.push_back(ALPHABET[(value >> 6) & 0x3F]);
+        result.push_back(ALPHABET[value & 0x3F]);
+    }
+
+    if (i < data.size()) {
+        uint32_t value = static_cast<uint8_t>(data[i]) << 16;
+        if (i + 1 < data.size()) {
+            value |= static_cast<uint8_t>(data[i + 1]) << 8;
+        }
+        result.push_back(ALPHABET[(value >> 18) & 0x3F]);
+        result.push_back(ALPHABET[(value >> 12) & 0x3F]);
+        result.push_back(i + 1 < data.size() ? ALPHABET[(value >> 6) & 0x3F] : '=');
+        result.push_back('=');
+    }
+
+    return result;
+}
+
+} // namespace raster
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "svg.h"
+
+namespace raster {
+
+// ---------- Pixel -----------------------------------------------------------
+
+// Цвет пикселя: компоненты красного, зелёного, синего и непрозрачность
+struct Pixel {
+    uint8_t red = 0;
+    uint8_t green = 0;
+    uint8_t blue = 0;
+    uint8_t alpha = 0;
+};
+
+// Переводит цвет svg в пиксель. Для цвета "none" и неизвестных названий возвращает nullopt
+std::optional<Pixel> ToPixel(const svg::Color& color);
+
+// ---------- SpanBuffer ------------------------------------------------------
+
+/*
+* Набор горизонтальных отрезков по строкам изображения. Фигура сначала собирается
+* целиком, пересекающиеся отрезки объединяются, и каждый пиксель закрашивается
+* ровно один раз - полупрозрачные фигуры не темнеют в местах наложения
+*/
+class SpanBuffer {
+public:
+    SpanBuffer(int width, int height);
+
+    // Добавляет отрезок [x_begin, x_end] в строке y, координаты в пикселях холста
+    void Add(int y, double x_begin, double x_end);
+
+    // Добавляет закрашенный круг
+    void AddCircle(svg::Point center, double radius);
+
+    // Добавляет кольцо между окружностями радиусов inner_radius и outer_radius
+    void AddRing(svg::Point center, double inner_radius, double outer_radius);
+
+    // Добавляет отрезок [from, to] толщины width со скруглёнными концами
+    void AddCapsule(svg::Point from, svg::Point to, double width);
+
+    // Добавляет прямоугольник
+    void AddRect(double x_begin, double y_begin, double x_end, double y_end);
+
+    // Возвращает объединённые отрезки строки y
+    std::vector<std::pair<int, int>> GetRow(int y);
+
+    int GetHeight() const {
+        return height_;
+    }
+
+    void Clear();
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<std::vector<std::pair<int, int>>> rows_;
+};
+
+// ---------- Canvas ----------------------------------------------------------
+
+/*
+* Изображение RGBA на непрозрачном белом фоне. Пиксели хранятся построчно,
+* по четыре байта на пиксель
+*/
+class Canvas {
+public:
+    Canvas(int width, int height);
+
+    int GetWidth() const {
+        return width_;
+    }
+
+    int GetHeight() const {
+        return height_;
+    }
+
+    // Закрашивает пиксели строки y с x_begin по x_end включительно, смешивая цвета
+    void FillSpan(int y, int x_begin, int x_end, Pixel color);
+
+    // Закрашивает все отрезки буфера и очищает его
+    void Fill(SpanBuffer& spans, Pixel color);
+
+    // Кодирует изображение в PNG
+    std::string EncodePng() const;
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<uint8_t> data_;
+};
+
+// ---------- Rasterizer ------------------------------------------------------
+
+/*
+* Растеризатор списка команд отрисовки: те же примитивы и стили, что выводятся
+* в svg, рисуются в изображение. Текст выводится встроенным растровым шрифтом 5x7
+*/
+class Rasterizer {
+public:
+    Rasterizer(int width, int height);
+
+    // Рисует все команды списка в порядке их добавления
+    void Draw(const svg::CommandList& commands, const svg::StyleSheet& styles);
+
+    const Canvas& GetCanvas() const {
+        return canvas_;
+    }
+
+private:
+    void DrawCircle(const svg::CommandList::Command& command, const svg::Style& style);
+    void DrawPolyline(const svg::CommandList& commands, const svg::CommandList::Command& command, const svg::Style& style);
+    void DrawText(std::string_view text, svg::Point position, const svg::Style& style);
+
+    Canvas canvas_;
+    SpanBuffer spans_;
+};
+
+// Растеризует список команд в PNG размером width x height
+std::string RenderPng(const svg::CommandList& commands, const svg::StyleSheet& styles, int width, int height);
+
+// Кодирует данные в base64 для передачи внутри JSON
+std::string EncodeBase64(std::string_view data);
+
+} // namespace raster
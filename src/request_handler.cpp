@@ -1,6 +1,8 @@
 #include "request_handler.h"
 
 #include "geo.h"
+#include "metrics.h"
+#include "raster.h"
 #include "serialization.h"
 
 #ifdef _SIROTKIN_HOME_TESTS_
@@ -13,8 +15,13 @@
 
 #include <algorithm>
 #include <cmath>
+#include <execution>
+#include <filesystem>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <stdexcept>
+#include <tuple>
 #include <utility>
 
 namespace request_handler {
@@ -33,6 +40,9 @@ ProgrammType ParseProgrammType(int argc, const char** argv) {
         else if (argument == "process_requests"sv) {
             return ProgrammType::PROCESS_REQUESTS;
         }
+        else if (argument == "process_requests_stream"sv) {
+            return ProgrammType::PROCESS_REQUESTS_STREAM;
+        }
         else if (argument == "old_tests") {
             return ProgrammType::OLD_TESTS;
         }
@@ -44,7 +54,8 @@ ProgrammType ParseProgrammType(int argc, const char** argv) {
 // ---------- RequestHandler --------------------------------------------------
 
 RequestHandler::RequestHandler(transport_catalogue::TransportCatalogue& catalogue)
-    : catalogue_(catalogue) {
+    : catalogue_(catalogue)
+    , tile_cache_(TILE_CACHE_CAPACITY) {
 }
 
 void RequestHandler::AddStop(std::string&& name, Coordinates&& coord) {
@@ -63,18 +74,125 @@ void RequestHandler::AddBus(transport_catalogue::bus_catalogue::BusHelper&& bus_
     catalogue_.AddBus(std::move(bus_helper.Build(catalogue_.GetStops())));
 }
 
-void RequestHandler::RenderMap(MapRendererSettings&& settings) {
+void RequestHandler::SetMapRenderSettings(MapRendererSettings&& settings) {
+    std::lock_guard guard(map_mutex_);
     map_render_settings_ = std::move(settings);
+    map_renderer_value_.reset();
+    map_png_value_.reset();
+    map_renderer_.reset();
+    polyline_lod_.clear();
+    tile_cache_.Clear();
+}
+
+void RequestHandler::SetMap(std::string&& map) const {
+    std::lock_guard guard(map_mutex_);
+    map_renderer_value_ = std::move(map);
+}
+
+void RequestHandler::SetPolylineLod(map_renderer::PolylineLod&& polyline_lod) const {
+    std::lock_guard guard(map_mutex_);
+    polyline_lod_ = std::move(polyline_lod);
+    map_renderer_.reset();
+    map_png_value_.reset();
+}
+
+const map_renderer::PolylineLod& RequestHandler::GetPolylineLod() const {
+    std::lock_guard guard(map_mutex_);
+    return GetMapRenderer().GetPolylineLod();
+}
+
+const std::optional<std::string>& RequestHandler::GetMap() const {
+    std::lock_guard guard(map_mutex_);
+
+    if (!map_renderer_value_ && map_render_settings_) {
+        std::ostringstream oss;
+        GetMapRenderer().Render(oss);
+
+        map_renderer_value_ = oss.str();
+    }
+
+    return map_renderer_value_;
+}
+
+const std::optional<std::string>& RequestHandler::GetMapPng() const {
+    std::lock_guard guard(map_mutex_);
 
-    MapRenderer render(
-        map_render_settings_.value(),
-        catalogue_.GetStops(),
-        catalogue_.GetBuses());
+    if (!map_png_value_ && map_render_settings_) {
+        std::ostringstream oss;
+        GetMapRenderer().RenderPng(oss);
+
+        map_png_value_ = oss.str();
+    }
+
+    return map_png_value_;
+}
+
+std::optional<std::string> RequestHandler::GetMapTile(
+    const map_renderer::TileRequest& request,
+    map_renderer::MapFormat format) const {
+    using namespace std::literals;
+
+    std::lock_guard guard(map_mutex_);
+
+    if (!map_render_settings_) {
+        return std::nullopt;
+    }
+
+    std::string key = map_renderer::GetTileRequestKey(request);
+    if (format == map_renderer::MapFormat::PNG) {
+        key = "png:"s + key;
+    }
+    if (const std::string* tile = tile_cache_.Find(key)) {
+        return *tile;
+    }
 
     std::ostringstream oss;
-    render.Render(oss);
+    GetMapRenderer().RenderTile(request, oss, format);
 
-    map_renderer_value_ = oss.str();
+    return tile_cache_.Insert(std::move(key), oss.str());
+}
+
+const MapRenderer& RequestHandler::GetMapRenderer() const {
+    if (!map_renderer_) {
+        map_renderer_ = std::make_unique<MapRenderer>(
+            map_render_settings_.value(),
+            catalogue_.GetStops(),
+            catalogue_.GetBuses(),
+            std::move(polyline_lod_));
+        polyline_lod_.clear();
+    }
+    return *map_renderer_;
+}
+
+memory_usage::Report RequestHandler::GetMemoryReport() const {
+    using memory_usage::HeapSize;
+
+    memory_usage::Report report;
+    catalogue_.AddMemoryUsage(report);
+
+    if (graph_) {
+        graph_->AddMemoryUsage(report);
+    }
+
+    if (router_) {
+        router_->AddMemoryUsage(report);
+    }
+
+    std::lock_guard guard(map_mutex_);
+    report.Add("map.svg", HeapSize(map_renderer_value_), map_renderer_value_ ? 1 : 0);
+    report.Add("map.png", HeapSize(map_png_value_), map_png_value_ ? 1 : 0);
+    report.Add("map.tile_cache", tile_cache_.GetHeapSize(), tile_cache_.Size());
+
+    return report;
+}
+
+uint64_t RequestHandler::GetMapCacheKey() const {
+    transport_catalogue::detail::Fnv1aHasher hasher;
+    if (map_render_settings_) {
+        hasher.Add(HashSettings(*map_render_settings_));
+    }
+    hasher.Add(catalogue_.GetVersion());
+    return hasher.Get();
 }
 
 bool RequestHandler::IsRouteValid(
@@ -112,22 +230,164 @@ std::optional<RequestHandler::RouteData> RequestHandler::GetRoute(std::string_vi
     auto stop_to = catalogue_.GetStops().At(to);
 
     if (stop_from && stop_to) {
-        return router_->GetRoute(*stop_from, *stop_to);
+        return router_->GetRoute(
+            static_cast<uint32_t>(catalogue_.GetId(*stop_from)),
+            static_cast<uint32_t>(catalogue_.GetId(*stop_to)));
     } else {
         return std::nullopt;
     }
 }
 
-void RequestHandler::InitRouter() const {
-    using namespace transport_graph;
+std::optional<transport_graph::TransportTime> RequestHandler::FindRoute(
+    std::string_view from, std::string_view to, transport_graph::RouteScratch& scratch) const {
+    InitRouter();
+
+    auto stop_from = catalogue_.GetStops().At(from);
+    auto stop_to = catalogue_.GetStops().At(to);
+
+    if (!stop_from || !stop_to) {
+        return std::nullopt;
+    }
+    return router_->FindRoute(
+        static_cast<uint32_t>(catalogue_.GetId(*stop_from)),
+        static_cast<uint32_t>(catalogue_.GetId(*stop_to)),
+        scratch);
+}
+
+std::vector<RequestHandler::RouteTimes> RequestHandler::GetRouteTimes(
+    const std::vector<std::string_view>& from,
+    const std::vector<std::string_view>& to) const {
+    InitRouter();
+
+    std::vector<uint32_t> to_ids;
+    std::vector<size_t> to_indexes;
+    for (size_t i = 0; i < to.size(); ++i) {
+        if (auto stop = catalogue_.GetStops().At(to[i])) {
+            to_ids.push_back(static_cast<uint32_t>(catalogue_.GetId(*stop)));
+            to_indexes.push_back(i);
+        }
+    }
+
+    std::vector<RouteTimes> times(from.size(), RouteTimes(to.size()));
+    std::vector<size_t> rows(from.size());
+    std::iota(rows.begin(), rows.end(), 0);
 
-    if (!graph_) {
-        graph_ = std::make_unique<TransportGraph>(catalogue_);
+    std::for_each(std::execution::par, rows.begin(), rows.end(),
+        [&](size_t row) {
+            auto stop = catalogue_.GetStops().At(from[row]);
+            if (!stop) {
+                return;
+            }
+            const auto row_times = router_->GetRouteTimes(static_cast<uint32_t>(catalogue_.GetId(*stop)), to_ids);
+            for (size_t i = 0; i < row_times.size(); ++i) {
+                times[row][to_indexes[i]] = row_times[i];
+            }
+        });
+
+    return times;
+}
+
+std::vector<std::optional<std::vector<map_renderer::IsochroneStop>>> RequestHandler::GetIsochrones(
+    const std::vector<std::string_view>& from, double max_time) const {
+    InitRouter();
+
+    std::vector<std::optional<std::vector<IsochroneStop>>> isochrones(from.size());
+    std::vector<size_t> indexes(from.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+        [&](size_t index) {
+            auto stop = catalogue_.GetStops().At(from[index]);
+            if (!stop) {
+                return;
+            }
+
+            std::vector<IsochroneStop> isochrone;
+            for (const auto& [stop_id, time] : router_->GetReachableStops(static_cast<uint32_t>(catalogue_.GetId(*stop)), max_time)) {
+                isochrone.push_back({ graph_->GetStop(stop_id), time });
+            }
+            std::sort(isochrone.begin(), isochrone.end(),
+                [](const IsochroneStop& lhs, const IsochroneStop& rhs) {
+                    return std::tie(lhs.time, lhs.stop->name) < std::tie(rhs.time, rhs.stop->name);
+                });
+
+            isochrones[index] = std::move(isochrone);
+        });
+
+    return isochrones;
+}
+
+std::optional<std::string> RequestHandler::GetIsochroneMap(
+    const std::vector<map_renderer::IsochroneStop>& stops, double max_time) const {
+    std::lock_guard guard(map_mutex_);
+
+    if (!map_render_settings_) {
+        return std::nullopt;
     }
 
-    if (!router_) {
-        router_ = std::make_unique<TransportRouter>(*graph_);
+    std::ostringstream oss;
+    GetMapRenderer().RenderIsochrone(stops, max_time, oss);
+    return oss.str();
+}
+
+std::vector<RequestHandler::RouteData> RequestHandler::GetAlternativeRoutes(
+    std::string_view from, std::string_view to, size_t count) const {
+    InitRouter();
+
+    auto stop_from = catalogue_.GetStops().At(from);
+    auto stop_to = catalogue_.GetStops().At(to);
+
+    if (!stop_from || !stop_to) {
+        return {};
     }
+    return router_->GetAlternativeRoutes(
+        static_cast<uint32_t>(catalogue_.GetId(*stop_from)),
+        static_cast<uint32_t>(catalogue_.GetId(*stop_to)),
+        count);
+}
+
+std::vector<RequestHandler::RouteData> RequestHandler::GetParetoRoutes(
+    std::string_view from, std::string_view to, uint32_t max_transfers) const {
+    InitRouter();
+
+    auto stop_from = catalogue_.GetStops().At(from);
+    auto stop_to = catalogue_.GetStops().At(to);
+
+    if (!stop_from || !stop_to) {
+        return {};
+    }
+    return router_->GetParetoRoutes(
+        static_cast<uint32_t>(catalogue_.GetId(*stop_from)),
+        static_cast<uint32_t>(catalogue_.GetId(*stop_to)),
+        max_transfers);
+}
+
+void RequestHandler::InitRouter() const {
+    using namespace transport_graph;
+
+    //    ,    
+    std::call_once(router_flag_, [this]() {
+        if (router_source_) {
+            METRICS_SCOPE(metrics::Stage::LOAD_ROUTER);
+            if (!graph_) {
+                graph_ = router_source_->LoadGraph(catalogue_);
+            }
+            if (graph_ && !router_) {
+                router_ = router_source_->LoadRouter(*graph_);
+            }
+            router_source_.reset();
+        }
+
+        if (!graph_) {
+            METRICS_SCOPE(metrics::Stage::BUILD_GRAPH);
+            graph_ = std::make_unique<TransportGraph>(catalogue_);
+        }
+
+        if (!router_) {
+            METRICS_SCOPE(metrics::Stage::BUILD_ROUTER);
+            router_ = std::make_unique<TransportRouter>(*graph_);
+        }
+    });
 }
 
 std::vector<const transport_catalogue::stop_catalogue::Stop*> RequestHandler::GetStops() const {
@@ -150,6 +410,98 @@ std::vector<const transport_catalogue::bus_catalogue::Bus*> RequestHandler::GetB
     return buses;
 }
 
+// ---------- BaseSnapshot ----------------------------------------------------
+
+BaseSnapshot::BaseSnapshot()
+    : handler_(catalogue_) {
+}
+
+std::shared_ptr<const BaseSnapshot> BaseSnapshot::Load(const std::string& file_name) {
+    using namespace std::literals;
+
+    std::ifstream in(file_name, std::ifstream::in | std::ifstream::binary);
+    if (!in) {
+        throw std::runtime_error("Couldn't open base file "s + file_name);
+    }
+
+    auto snapshot = std::make_shared<BaseSnapshot>();
+    transport_serialization::Deserialize(snapshot->handler_, std::move(in));
+
+    return snapshot;
+}
+
+// ---------- BaseSnapshotHolder ----------------------------------------------
+
+BaseSnapshotHolder::~BaseSnapshotHolder() {
+    if (reload_.valid()) {
+        reload_.wait();
+    }
+}
+
+void BaseSnapshotHolder::Reload(const std::string& file_name) {
+    Publish(BaseSnapshot::Load(file_name));
+}
+
+void BaseSnapshotHolder::ReloadAsync(std::string file_name, ReloadCallback on_finish) {
+    using namespace std::literals;
+
+    PendingReload reload{ std::move(file_name), std::move(on_finish) };
+    std::optional<PendingReload> superseded;
+    {
+        std::lock_guard guard(reload_mutex_);
+        if (is_reloading_) {
+            //    ,        
+            superseded = std::move(pending_reload_);
+            pending_reload_ = std::move(reload);
+        }
+        else {
+            is_reloading_ = true;
+            if (reload_.valid()) {
+                //        
+                reload_.get();
+            }
+            reload_ = std::async(std::launch::async, [this, reload = std::move(reload)]() mutable {
+                RunReloads(std::move(reload));
+            });
+        }
+    }
+
+    if (superseded) {
+        superseded->on_finish(std::make_exception_ptr(
+            std::runtime_error("Reload of "s + superseded->file_name + " is superseded by a later ReloadBase"s)));
+    }
+}
+
+void BaseSnapshotHolder::RunReloads(PendingReload reload) {
+    while (true) {
+        std::exception_ptr error;
+        try {
+            //    ,          
+            auto snapshot = BaseSnapshot::Load(reload.file_name);
+            snapshot->GetHandler().InitRouter();
+            Publish(std::move(snapshot));
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        reload.on_finish(error);
+
+        std::lock_guard guard(reload_mutex_);
+        if (!pending_reload_) {
+            is_reloading_ = false;
+            return;
+        }
+        reload = std::move(*pending_reload_);
+        pending_reload_.reset();
+    }
+}
+
+void BaseSnapshotHolder::WaitReload() {
+    if (reload_.valid()) {
+        reload_.get();
+    }
+}
+
 // ----------------------------------------------------------------------------
 
 namespace detail_base {
@@ -161,9 +513,16 @@ void RequestBaseStopProcess(
 
     const json::Dict& request = node->AsMap();
 
-    std::string name = request.at("name"s).AsString();
+    stop_catalogue::Stop stop;
+    stop.name = request.at("name"s).AsString();
+    stop.coord = Coordinates{ request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() };
+
+    //         routing_settings
+    if (auto it = request.find("bus_wait_time"s); it != request.end()) {
+        stop.bus_wait_time = it->second.AsInt();
+    }
 
-    request_handler.AddStop(std::move(name), Coordinates{ request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() });
+    request_handler.AddStop(std::move(stop));
 }
 
 RouteSettings CreateRouteSettings(const std::unordered_map<std::string_view, const json::Node*> input_route_settings) {
@@ -179,7 +538,7 @@ RouteSettings CreateRouteSettings(const std::unordered_map<std::string_view, con
     return settings;
 }
 
-transport_catalogue::bus_catalogue::BusHelper RequestBaseBusProcess(const json::Node* node) {
+transport_catalogue::bus_catalogue::BusHelper RequestBaseBusProcess(const json::Node* node, const RouteSettings& common_settings) {
     using namespace std::literals;
     using namespace bus_catalogue;
 
@@ -196,7 +555,13 @@ transport_catalogue::bus_catalogue::BusHelper RequestBaseBusProcess(const json::
         route.push_back(node_stops.AsString());
     }
 
-    return BusHelper().SetName(std::move(name)).SetStopNames(std::move(route)).SetRouteType(type);
+    //       routing_settings
+    RouteSettings settings = common_settings;
+    if (auto it = request.find("bus_velocity"s); it != request.end()) {
+        settings.bus_velocity = it->second.AsDouble();
+    }
+
+    return BusHelper().SetName(std::move(name)).SetStopNames(std::move(route)).SetRouteType(type).SetRouteSettings(std::move(settings));
 }
 
 svg::Color ParseColor(const json::Node* node) {
@@ -253,8 +618,11 @@ void RequestBaseMapProcess(
     settings.underlayer_color = std::move(ParseColor(render_settings.at("underlayer_color"sv)));
     settings.underlayer_width = render_settings.at("underlayer_width"sv)->AsDouble();
     settings.color_palette = std::move(ParsePaletteColors(render_settings.at("color_palette"sv)->AsArray()));
+    if (render_settings.count("simplify_tolerance"sv) > 0) {
+        settings.simplify_tolerance = render_settings.at("simplify_tolerance"sv)->AsDouble();
+    }
 
-    request_handler.RenderMap(std::move(settings));
+    request_handler.SetMapRenderSettings(std::move(settings));
 }
 
 } // namespace detail_base
@@ -327,18 +695,50 @@ void RequestStatBusProcess(
     }
 }
 
+namespace {
+
+//      "format": "svg" ( )  "png"
+map_renderer::MapFormat ParseMapFormat(const json::Dict& request) {
+    using namespace std::literals;
+
+    auto it = request.find("format"s);
+    if (it == request.end() || it->second.AsString() == "svg"sv) {
+        return map_renderer::MapFormat::SVG;
+    }
+    if (it->second.AsString() == "png"sv) {
+        return map_renderer::MapFormat::PNG;
+    }
+    throw json::ParsingError("Unknown map format "s + it->second.AsString());
+}
+
+} // namespace
+
 void RequestMapProcess(
     json::Builder& builder,
     const RequestHandler& request_handler,
     const json::Dict& request) {
     using namespace std::literals;
 
+    int id = request.at("id"s).AsInt();
+
+    // PNG   JSON  base64
+    if (ParseMapFormat(request) == map_renderer::MapFormat::PNG) {
+        if (!request_handler.GetMapPng()) {
+            throw std::logic_error("Map hasn't been rendered!"s);
+        }
+
+        builder
+            .StartDict()
+                .Key("map"s).Value(raster::EncodeBase64(*request_handler.GetMapPng()))
+                .Key("request_id"s).Value(id)
+            .EndDict();
+        return;
+    }
+
     if (!request_handler.GetMap()) {
         throw std::logic_error("Map hasn't been rendered!"s);
     }
 
-    int id = request.at("id"s).AsInt();
-
     builder
         .StartDict()
             .Key("map"s).Value(*request_handler.GetMap())
@@ -346,6 +746,134 @@ void RequestMapProcess(
         .EndDict();
 }
 
+void RequestMapTileProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request) {
+    using namespace std::literals;
+
+    map_renderer::TileRequest tile_request;
+    if (request.count("bbox"s) > 0) {
+        const json::Array& bbox = request.at("bbox"s).AsArray();
+        if (bbox.size() != 4) {
+            throw json::ParsingError("bbox must contain min_lat, min_lng, max_lat, max_lng"s);
+        }
+        tile_request = map_renderer::GeoBounds{
+            { bbox[0].AsDouble(), bbox[1].AsDouble() },
+            { bbox[2].AsDouble(), bbox[3].AsDouble() } };
+    }
+    else {
+        const int z = request.at("z"s).AsInt();
+        const int x = request.at("x"s).AsInt();
+        const int y = request.at("y"s).AsInt();
+        if (z < 0 || x < 0 || y < 0) {
+            throw json::ParsingError("Tile indices must be non-negative"s);
+        }
+        tile_request = map_renderer::TileIndex{
+            static_cast<uint32_t>(z), static_cast<uint32_t>(x), static_cast<uint32_t>(y) };
+    }
+
+    int id = request.at("id"s).AsInt();
+    const map_renderer::MapFormat format = ParseMapFormat(request);
+
+    std::optional<std::string> tile;
+    if (map_renderer::IsTileRequestValid(tile_request)) {
+        tile = request_handler.GetMapTile(tile_request, format);
+    }
+    if (tile && format == map_renderer::MapFormat::PNG) {
+        tile = raster::EncodeBase64(*tile);
+    }
+
+    if (tile) {
+        builder
+            .StartDict()
+                .Key("map"s).Value(std::move(*tile))
+                .Key("request_id"s).Value(id)
+            .EndDict();
+    }
+    else {
+        builder
+            .StartDict()
+                .Key("request_id"s).Value(id)
+                .Key("error_message"s).Value("not found"s)
+            .EndDict();
+    }
+}
+
+namespace {
+
+//   Wait  Bus   ,    builder
+void PrintRouteItem(json::Builder& builder, const transport_graph::TransportRouteItem& item) {
+    using namespace std::literals;
+
+    if (item.from == item.to) {
+        builder.StartDict()
+                   .Key("stop_name"s).Value(item.from->name)
+                   .Key("time"s).Value(item.time)
+                   .Key("type"s).Value("Wait"s)
+               .EndDict();
+    } else {
+        builder.StartDict()
+                   .Key("bus"s).Value(item.bus->name)
+                   .Key("span_count"s).Value(item.stop_count)
+                   .Key("time"s).Value(item.time)
+                   .Key("type"s).Value("Bus"s)
+               .EndDict();
+    }
+}
+
+void PrintRouteItems(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const transport_graph::TransportRouter::TransportRouterData& route_data) {
+    using namespace std::literals;
+
+    //           assert
+    (void)request_handler;
+#ifdef _SIROTKIN_HOME_TESTS_
+    double check_total_time = 0.0;
+#endif
+    builder.Key("items"s).StartArray();
+    for (const transport_graph::TransportRouteItem& item : route_data.route) {
+#ifdef _SIROTKIN_HOME_TESTS_
+        assert(request_handler.IsRouteValid(item.from, item.to, item.bus, item.stop_count, item.time));
+        check_total_time += item.time;
+#endif
+        PrintRouteItem(builder, item);
+    }
+#ifdef _SIROTKIN_HOME_TESTS_
+    assert(std::abs(check_total_time - route_data.time) < 1e-6);
+    (void)check_total_time;
+#endif
+    builder.EndArray();
+}
+
+//   :   ,  
+int CountTransfers(const transport_graph::TransportRouter::TransportRouterData& route_data) {
+    const auto boardings = std::count_if(route_data.route.begin(), route_data.route.end(),
+        [](const transport_graph::TransportRouteItem& item) {
+            return item.from == item.to;
+        });
+    return std::max(0, static_cast<int>(boardings) - 1);
+}
+
+//     max_transfers
+std::optional<uint32_t> ParseMaxTransfers(const json::Dict& request) {
+    using namespace std::literals;
+
+    const auto it = request.find("max_transfers"s);
+    if (it == request.end()) {
+        return std::nullopt;
+    }
+    const int max_transfers = it->second.AsInt();
+    if (max_transfers < 0 || max_transfers > MAX_TRANSFERS) {
+        throw json::ParsingError("max_transfers must be from 0 to "s + std::to_string(MAX_TRANSFERS));
+    }
+    return static_cast<uint32_t>(max_transfers);
+}
+
+} // namespace
+
 void RequestRouteProcess(
     json::Builder& builder,
     const RequestHandler& request_handler,
@@ -357,52 +885,318 @@ void RequestRouteProcess(
 
     int id = request.at("id"s).AsInt();
 
-    const auto route_data = request_handler.GetRoute(name_from, name_to);
-
-    if (route_data) {
+    //         -
+    if (const auto max_transfers = ParseMaxTransfers(request)) {
+        const auto routes = request_handler.GetParetoRoutes(name_from, name_to, *max_transfers);
+        if (!routes.empty()) {
+            builder.StartDict();
+            PrintRouteItems(builder, request_handler, routes.front());
+            builder
+                .Key("request_id"s).Value(id)
+                .Key("total_time"s).Value(routes.front().time)
+                .EndDict();
+            return;
+        }
+    }
+    else {
+        //      ,      
+        thread_local transport_graph::RouteScratch scratch;
+        if (const auto total_time = request_handler.FindRoute(name_from, name_to, scratch)) {
 #ifdef _SIROTKIN_HOME_TESTS_
-        double check_total_time = 0.0;
+            double check_total_time = 0.0;
 #endif
-        builder.StartDict()
-                   .Key("items"s)
-                       .StartArray();
-        // --------------------------------------------------------------------
-        for (const auto& [from, to, bus, span, time] : route_data->route) {
+            builder.StartDict().Key("items"s).StartArray();
+            request_handler.VisitRouteItems(scratch, [&](const transport_graph::TransportRouteItem& item) {
 #ifdef _SIROTKIN_HOME_TESTS_
-            assert(request_handler.IsRouteValid(from, to, bus, span, time));
-            check_total_time += time;
+                assert(request_handler.IsRouteValid(item.from, item.to, item.bus, item.stop_count, item.time));
+                check_total_time += item.time;
 #endif
-            if (from == to) {
-                builder.StartDict()
-                           .Key("stop_name"s).Value(from->name)
-                           .Key("time"s).Value(time)
-                           .Key("type"s).Value("Wait"s)
-                       .EndDict();
-            } else {
-                builder.StartDict()
-                           .Key("bus"s).Value(bus->name)
-                           .Key("span_count"s).Value(span)
-                           .Key("time"s).Value(time)
-                           .Key("type"s).Value("Bus"s)
-                       .EndDict();
-            }
-        }
+                PrintRouteItem(builder, item);
+            });
 #ifdef _SIROTKIN_HOME_TESTS_
-            assert(std::abs(check_total_time - route_data->time) < 1e-6);
+            assert(std::abs(check_total_time - *total_time) < 1e-6);
 #endif
-        // --------------------------------------------------------------------
-                       builder.EndArray()
-                   .Key("request_id"s).Value(id)
-                   .Key("total_time"s).Value(route_data->time)
-               .EndDict();
+            builder.EndArray()
+                .Key("request_id"s).Value(id)
+                .Key("total_time"s).Value(*total_time)
+                .EndDict();
+            return;
+        }
     }
-    else {
-       builder
-           .StartDict()
-               .Key("error_message"s).Value("not found"s)
-               .Key("request_id"s).Value(id)
-           .EndDict();
+
+    builder
+        .StartDict()
+            .Key("error_message"s).Value("not found"s)
+            .Key("request_id"s).Value(id)
+        .EndDict();
+}
+
+void RequestParetoRoutesProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request) {
+    using namespace std::literals;
+
+    std::string_view name_from = request.at("from"s).AsString();
+    std::string_view name_to = request.at("to"s).AsString();
+    const uint32_t max_transfers = ParseMaxTransfers(request).value_or(MAX_TRANSFERS);
+
+    int id = request.at("id"s).AsInt();
+
+    const auto routes = request_handler.GetParetoRoutes(name_from, name_to, max_transfers);
+
+    if (routes.empty()) {
+        builder
+            .StartDict()
+                .Key("error_message"s).Value("not found"s)
+                .Key("request_id"s).Value(id)
+            .EndDict();
+        return;
+    }
+
+    builder.StartDict().Key("request_id"s).Value(id).Key("routes"s).StartArray();
+    for (const auto& route_data : routes) {
+        builder.StartDict();
+        PrintRouteItems(builder, request_handler, route_data);
+        builder
+            .Key("total_time"s).Value(route_data.time)
+            .Key("transfers"s).Value(CountTransfers(route_data))
+            .EndDict();
+    }
+    builder.EndArray().EndDict();
+}
+
+void RequestAlternativeRoutesProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request) {
+    using namespace std::literals;
+
+    std::string_view name_from = request.at("from"s).AsString();
+    std::string_view name_to = request.at("to"s).AsString();
+
+    const auto count_it = request.find("count"s);
+    const int count = count_it != request.end() ? count_it->second.AsInt() : DEFAULT_ALTERNATIVE_ROUTES;
+    if (count < 1 || count > MAX_ALTERNATIVE_ROUTES) {
+        throw json::ParsingError("AlternativeRoutes count must be from 1 to "s + std::to_string(MAX_ALTERNATIVE_ROUTES));
+    }
+
+    int id = request.at("id"s).AsInt();
+
+    const auto routes = request_handler.GetAlternativeRoutes(name_from, name_to, static_cast<size_t>(count));
+
+    if (routes.empty()) {
+        builder
+            .StartDict()
+                .Key("error_message"s).Value("not found"s)
+                .Key("request_id"s).Value(id)
+            .EndDict();
+        return;
+    }
+
+    builder.StartDict().Key("request_id"s).Value(id).Key("routes"s).StartArray();
+    for (const auto& route_data : routes) {
+        builder.StartDict();
+        PrintRouteItems(builder, request_handler, route_data);
+        builder.Key("total_time"s).Value(route_data.time).EndDict();
     }
+    builder.EndArray().EndDict();
+}
+
+namespace {
+
+//    json 
+std::vector<std::string_view> ParseStopNames(const json::Array& array) {
+    std::vector<std::string_view> names;
+    names.reserve(array.size());
+    for (const json::Node& node : array) {
+        names.push_back(node.AsString());
+    }
+    return names;
+}
+
+//     ,   - null
+json::Array CreateRouteTimesArray(const RequestHandler::RouteTimes& times) {
+    json::Array array;
+    array.reserve(times.size());
+    for (const auto& time : times) {
+        if (time) {
+            array.emplace_back(*time);
+        }
+        else {
+            array.emplace_back(nullptr);
+        }
+    }
+    return array;
+}
+
+} // namespace
+
+void RequestRouteOneToManyProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request) {
+    using namespace std::literals;
+
+    const std::vector<std::string_view> from = { request.at("from"s).AsString() };
+    const std::vector<std::string_view> to = ParseStopNames(request.at("to"s).AsArray());
+
+    int id = request.at("id"s).AsInt();
+
+    auto times = request_handler.GetRouteTimes(from, to);
+
+    builder
+        .StartDict()
+            .Key("request_id"s).Value(id)
+            .Key("total_times"s).Value(CreateRouteTimesArray(times.front()))
+        .EndDict();
+}
+
+void RequestRouteMatrixProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request) {
+    using namespace std::literals;
+
+    const std::vector<std::string_view> from = ParseStopNames(request.at("from"s).AsArray());
+    const std::vector<std::string_view> to = ParseStopNames(request.at("to"s).AsArray());
+
+    int id = request.at("id"s).AsInt();
+
+    json::Array matrix;
+    matrix.reserve(from.size());
+    for (const RequestHandler::RouteTimes& times : request_handler.GetRouteTimes(from, to)) {
+        matrix.push_back(CreateRouteTimesArray(times));
+    }
+
+    builder
+        .StartDict()
+            .Key("request_id"s).Value(id)
+            .Key("total_times"s).Value(std::move(matrix))
+        .EndDict();
+}
+
+namespace {
+
+//       ,  ,     ,    builder
+void PrintIsochrone(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const std::vector<map_renderer::IsochroneStop>& isochrone,
+    double max_time, bool render) {
+    using namespace std::literals;
+
+    builder.Key("stops"s).StartArray();
+    for (const map_renderer::IsochroneStop& isochrone_stop : isochrone) {
+        builder
+            .StartDict()
+                .Key("stop_name"s).Value(isochrone_stop.stop->name)
+                .Key("time"s).Value(isochrone_stop.time)
+            .EndDict();
+    }
+    builder.EndArray();
+
+    if (render) {
+        auto map = request_handler.GetIsochroneMap(isochrone, max_time);
+        if (!map) {
+            throw std::logic_error("Map hasn't been rendered!"s);
+        }
+        builder.Key("map"s).Value(std::move(*map));
+    }
+}
+
+} // namespace
+
+void RequestIsochroneProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request) {
+    using namespace std::literals;
+
+    // from -         
+    const json::Node& from_node = request.at("from"s);
+    const std::vector<std::string_view> from = from_node.IsArray()
+        ? ParseStopNames(from_node.AsArray())
+        : std::vector<std::string_view>{ from_node.AsString() };
+
+    const double max_time = request.at("max_time"s).AsDouble();
+    if (!std::isfinite(max_time) || max_time < 0.0) {
+        throw json::ParsingError("max_time must be a non-negative number"s);
+    }
+    const auto render_it = request.find("render"s);
+    const bool render = render_it != request.end() && render_it->second.AsBool();
+
+    int id = request.at("id"s).AsInt();
+
+    const auto isochrones = request_handler.GetIsochrones(from, max_time);
+
+    if (!from_node.IsArray()) {
+        builder.StartDict();
+        if (isochrones.front()) {
+            PrintIsochrone(builder, request_handler, *isochrones.front(), max_time, render);
+        }
+        else {
+            builder.Key("error_message"s).Value("not found"s);
+        }
+        builder.Key("request_id"s).Value(id);
+        builder.EndDict();
+        return;
+    }
+
+    builder.StartDict().Key("isochrones"s).StartArray();
+    for (size_t i = 0; i < from.size(); ++i) {
+        builder.StartDict().Key("from"s).Value(std::string(from[i]));
+        if (isochrones[i]) {
+            PrintIsochrone(builder, request_handler, *isochrones[i], max_time, render);
+        }
+        else {
+            builder.Key("error_message"s).Value("not found"s);
+        }
+        builder.EndDict();
+    }
+    builder.EndArray().Key("request_id"s).Value(id).EndDict();
+}
+
+namespace {
+
+//    int   double
+json::Node::Value CreateSizeValue(size_t size) {
+    if (size <= static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return static_cast<int>(size);
+    }
+    return static_cast<double>(size);
+}
+
+} // namespace
+
+void PrintMemoryReport(json::Builder& builder, const memory_usage::Report& report) {
+    using namespace std::literals;
+
+    builder.Key("total_bytes"s).Value(CreateSizeValue(report.GetTotalBytes()));
+    builder.Key("structures"s).StartArray();
+    for (const memory_usage::Item& item : report.GetItems()) {
+        builder
+            .StartDict()
+                .Key("name"s).Value(item.name)
+                .Key("bytes"s).Value(CreateSizeValue(item.bytes))
+                .Key("items"s).Value(CreateSizeValue(item.items))
+            .EndDict();
+    }
+    builder.EndArray();
+}
+
+void RequestStatsProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request) {
+    using namespace std::literals;
+
+    int id = request.at("id"s).AsInt();
+
+    builder.StartDict();
+    PrintMemoryReport(builder, request_handler.GetMemoryReport());
+    builder.Key("request_id"s).Value(id);
+    builder.EndDict();
 }
 
 void RequestStatProcess(
@@ -415,17 +1209,48 @@ void RequestStatProcess(
     std::string_view type = request.at("type"s).AsString();
 
     if (type == "Stop"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_STOP);
         RequestStatStopProcess(builder, request_handler, request);
     }
     else if (type == "Bus"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_BUS);
         RequestStatBusProcess(builder, request_handler, request);
     }
     else if (type == "Map"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_MAP);
         RequestMapProcess(builder, request_handler, request);
     }
+    else if (type == "MapTile"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_MAP_TILE);
+        RequestMapTileProcess(builder, request_handler, request);
+    }
     else if (type == "Route"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_ROUTE);
         RequestRouteProcess(builder, request_handler, request);
     }
+    else if (type == "RouteOneToMany"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_ROUTE_MATRIX);
+        RequestRouteOneToManyProcess(builder, request_handler, request);
+    }
+    else if (type == "RouteMatrix"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_ROUTE_MATRIX);
+        RequestRouteMatrixProcess(builder, request_handler, request);
+    }
+    else if (type == "Isochrone"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_ISOCHRONE);
+        RequestIsochroneProcess(builder, request_handler, request);
+    }
+    else if (type == "AlternativeRoutes"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_ALTERNATIVE_ROUTES);
+        RequestAlternativeRoutesProcess(builder, request_handler, request);
+    }
+    else if (type == "ParetoRoutes"sv) {
+        METRICS_SCOPE(metrics::Stage::QUERY_PARETO_ROUTES);
+        RequestParetoRoutesProcess(builder, request_handler, request);
+    }
+    else if (type == "Stats"sv) {
+        RequestStatsProcess(builder, request_handler, request);
+    }
     else {
         throw json::ParsingError("Unknown type "s + std::string(type) + " in RequestStatProcess"s);
     }
@@ -437,7 +1262,7 @@ void RequestStatProcess(
 
 void RequestHandlerProcess::RunOldTests() {
     ExecuteBaseProcess();
-    ExecuteStatProcess();
+    ExecuteStatProcess(handler_);
 }
 
 void RequestHandlerProcess::ExecuteMakeBaseRequests() {
@@ -447,28 +1272,67 @@ void RequestHandlerProcess::ExecuteMakeBaseRequests() {
 
     handler_.InitRouter();
 
-    std::ofstream out(
-        reader_.SerializationSettings().at("file"sv)->AsString(),
-        std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    const auto& serialization_settings = reader_.SerializationSettings();
+
+    transport_serialization::SerializationSettings settings;
+    if (serialization_settings.count("cache_map"sv) > 0) {
+        settings.cache_map = serialization_settings.at("cache_map"sv)->AsBool();
+    }
+    //       "codec": "none" ( )  "lz4"
+    if (serialization_settings.count("codec"sv) > 0) {
+        const std::string& codec = serialization_settings.at("codec"sv)->AsString();
+        if (codec == "lz4"sv) {
+            settings.codec = base_container::Codec::LZ4;
+        }
+        else if (codec != "none"sv) {
+            throw json::ParsingError("Unknown base codec "s + codec);
+        }
+    }
 
-    transport_serialization::Serialize(out, handler_);
+    //         :   
+    //         ,      
+    const std::string& file_name = serialization_settings.at("file"sv)->AsString();
+    const std::string temp_file_name = file_name + ".tmp"s;
+    {
+        std::ofstream out(temp_file_name, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!out) {
+            throw std::runtime_error("Couldn't create base file "s + temp_file_name);
+        }
+        transport_serialization::Serialize(out, handler_, settings);
+        if (!out.flush()) {
+            throw std::runtime_error("Couldn't write base file "s + temp_file_name);
+        }
+    }
+    std::filesystem::rename(temp_file_name, file_name);
 }
 
 void RequestHandlerProcess::ExecuteProcessRequests() {
     using namespace std::literals;
 
-    std::ifstream in(
-        reader_.SerializationSettings().at("file"sv)->AsString(),
-        std::ofstream::in | std::ofstream::binary);
+    snapshots_.Reload(reader_.SerializationSettings().at("file"sv)->AsString());
 
-    transport_serialization::Deserialize(handler_, in);
+    //     ,       
+    const auto snapshot = snapshots_.Acquire();
+    ExecuteStatProcess(snapshot->GetHandler());
+}
 
-    ExecuteStatProcess();
+void RequestHandlerProcess::PrintMemoryReport(std::ostream& out) const {
+    //  process_requests     ,  make_base -   
+    const auto snapshot = snapshots_.Acquire();
+    const RequestHandler& handler = snapshot ? snapshot->GetHandler() : handler_;
+
+    json::Builder builder;
+    builder.StartDict();
+    detail_stat::PrintMemoryReport(builder, handler.GetMemoryReport());
+    builder.EndDict();
+
+    json::Print(json::Document(builder.Build()), out);
+    out << std::endl;
 }
 
 void RequestHandlerProcess::ExecuteBaseProcess() {
     {
-        //LOG_DURATION("Stops"s);
+        METRICS_SCOPE(metrics::Stage::ADD_STOPS);
         //  
         for (const json::Node* node : reader_.StopRequests()) {
             detail_base::RequestBaseStopProcess(handler_, node);
@@ -476,7 +1340,7 @@ void RequestHandlerProcess::ExecuteBaseProcess() {
     }
 
     {
-        //LOG_DURATION("Distances"s);
+        METRICS_SCOPE(metrics::Stage::ADD_DISTANCES);
         //     
         for (const auto& [name_from, distances] : reader_.RoadDistances()) {
             for (const auto& [name_to, distance] : *distances) {
@@ -486,13 +1350,13 @@ void RequestHandlerProcess::ExecuteBaseProcess() {
     }
 
     {
-        //LOG_DURATION("Buses"s);
+        METRICS_SCOPE(metrics::Stage::BUILD_BUSES);
         //     
         catalogue_.SetBusRouteCommonSettings(detail_base::CreateRouteSettings(reader_.RoutingSettings()));
 
         //   
         for (const json::Node* node : reader_.BusRequests()) {
-            bus_catalogue::BusHelper helper = detail_base::RequestBaseBusProcess(node);
+            bus_catalogue::BusHelper helper = detail_base::RequestBaseBusProcess(node, catalogue_.GetBuses().GetRouteSettings());
             handler_.AddBus(std::move(helper));
         }
     }
@@ -506,7 +1370,7 @@ void RequestHandlerProcess::ExecuteBaseProcess() {
     }
 }
 
-void RequestHandlerProcess::ExecuteStatProcess() {
+void RequestHandlerProcess::ExecuteStatProcess(const RequestHandler& handler) {
     json::Builder builder;
 
     {
@@ -514,16 +1378,138 @@ void RequestHandlerProcess::ExecuteStatProcess() {
         //  
         builder.StartArray();
         for (const json::Node* node : reader_.StatRequests()) {
-            detail_stat::RequestStatProcess(builder, handler_, node);
+            detail_stat::RequestStatProcess(builder, handler, node);
         }
         builder.EndArray();
     }
 
     {
-        //LOG_DURATION("Print result"s);
+        METRICS_SCOPE(metrics::Stage::PRINT_RESPONSE);
         //  
         json::Print(json::Document(builder.Build()), output_);
     }
 }
 
+// ----------------------------------------------------------------------------
+
+void RequestStreamProcess::Execute() {
+    using namespace std::literals;
+
+    bool is_settings = true;
+    for (std::string line; std::getline(input_, line);) {
+        if (line.find_first_not_of(" \t\r"sv) == std::string::npos) {
+            continue;
+        }
+
+        //        :      error_message
+        std::optional<int> request_id;
+        try {
+            std::istringstream line_input(line);
+            const json::Document doc = json::Load(line_input);
+            request_id = GetRequestId(doc.GetRoot());
+
+            if (is_settings) {
+                is_settings = false;
+                ExecuteSettings(doc.GetRoot());
+            }
+            else {
+                ExecuteRequest(doc.GetRoot());
+            }
+        }
+        catch (const std::exception& e) {
+            PrintError(request_id, e.what());
+        }
+    }
+
+    //       
+    snapshots_.WaitReload();
+}
+
+std::optional<int> RequestStreamProcess::GetRequestId(const json::Node& node) {
+    using namespace std::literals;
+
+    if (!node.IsMap()) {
+        return std::nullopt;
+    }
+    const json::Dict& request = node.AsMap();
+    const auto it = request.find("id"s);
+    if (it == request.end() || !it->second.IsInt()) {
+        return std::nullopt;
+    }
+    return it->second.AsInt();
+}
+
+void RequestStreamProcess::PrintError(std::optional<int> request_id, const std::string& message) {
+    using namespace std::literals;
+
+    json::Builder builder;
+    builder.StartDict().Key("request_id"s);
+    if (request_id) {
+        builder.Value(*request_id);
+    }
+    else {
+        builder.Value(nullptr);
+    }
+    builder.Key("error_message"s).Value(message).EndDict();
+
+    PrintLine(builder.Build());
+}
+
+void RequestStreamProcess::PrintLine(json::Node node) {
+    std::lock_guard guard(output_mutex_);
+    json::PrintCompact(json::Document(std::move(node)), output_);
+    output_ << '\n';
+    output_.flush();
+}
+
+void RequestStreamProcess::ExecuteSettings(const json::Node& node) {
+    using namespace std::literals;
+
+    const json::Dict& settings = node.AsMap().at("serialization_settings"s).AsMap();
+    snapshots_.Reload(settings.at("file"s).AsString());
+}
+
+void RequestStreamProcess::ExecuteRequest(const json::Node& node) {
+    using namespace std::literals;
+
+    const json::Dict& request = node.AsMap();
+    if (request.at("type"s).AsString() == "ReloadBase"sv) {
+        const std::optional<int> request_id = GetRequestId(node);
+        snapshots_.ReloadAsync(request.at("file"s).AsString(), [this, request_id](std::exception_ptr error) {
+            if (!error) {
+                return;
+            }
+            try {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception& e) {
+                PrintError(request_id, e.what());
+            }
+        });
+
+        //   ,    
+        json::Builder builder;
+        builder.StartDict().Key("request_id"s);
+        if (request_id) {
+            builder.Value(*request_id);
+        }
+        else {
+            builder.Value(nullptr);
+        }
+        PrintLine(builder.EndDict().Build());
+        return;
+    }
+
+    //         
+    const auto snapshot = snapshots_.Acquire();
+    if (!snapshot) {
+        throw std::runtime_error("base is not loaded"s);
+    }
+
+    json::Builder builder;
+    detail_stat::RequestStatProcess(builder, snapshot->GetHandler(), &node);
+
+    PrintLine(builder.Build());
+}
+
 } // namespace request_handler
@@ -5,11 +5,16 @@
 #include "json_reader.h"
 #include "geo.h"
 #include "map_renderer.h"
+#include "memory_usage.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
+#include <exception>
+#include <functional>
+#include <future>
 #include <istream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <set>
@@ -22,12 +27,28 @@ namespace request_handler {
 enum class ProgrammType {
     MAKE_BASE,
     PROCESS_REQUESTS,
+    PROCESS_REQUESTS_STREAM,
     OLD_TESTS,
     UNKNOWN
 };
 
 ProgrammType ParseProgrammType(int argc, const char** argv);
 
+// ---------- RouterSource ----------------------------------------------------
+
+//    ,   .      ,
+//    . ,     (nullptr),   
+class RouterSource {
+public:
+    virtual ~RouterSource() = default;
+
+    //     
+    virtual std::unique_ptr<transport_graph::TransportGraph> LoadGraph(const transport_catalogue::TransportCatalogue& catalogue) = 0;
+
+    //     ,     
+    virtual std::unique_ptr<transport_graph::TransportRouter> LoadRouter(const transport_graph::TransportGraph& graph) = 0;
+};
+
 // ---------- RequestHandler --------------------------------------------------
 
 class RequestHandler {
@@ -35,6 +56,9 @@ private:
     using RouteData = transport_graph::TransportRouter::TransportRouterData;
 
 public:
+    //        , nullopt -  
+    using RouteTimes = std::vector<std::optional<transport_graph::TransportTime>>;
+
     RequestHandler(transport_catalogue::TransportCatalogue& catalogue);
 
     //    
@@ -42,6 +66,10 @@ public:
 
     void AddStop(size_t id, std::string&& name, Coordinates&& coord);
 
+    void AddStop(transport_catalogue::stop_catalogue::Stop&& stop) {
+        catalogue_.AddStop(std::move(stop));
+    }
+
     void AddStop(size_t id, transport_catalogue::stop_catalogue::Stop&& stop) {
         catalogue_.AddStop(id, std::move(stop));
     }
@@ -49,6 +77,11 @@ public:
     //       
     void AddDistance(std::string_view name_from, std::string_view name_to, double distance);
 
+    //        ,     
+    void AddEncodedDistances(size_t stop_id, std::string&& encoded) {
+        catalogue_.AddEncodedDistances(stop_id, std::move(encoded));
+    }
+
     //    
     void AddBus(transport_catalogue::bus_catalogue::BusHelper&& bus_helper);
 
@@ -60,8 +93,14 @@ public:
         catalogue_.AddBus(id, std::move(bus));
     }
 
-    //         svg 
-    void RenderMap(map_renderer::MapRendererSettings&& settings);
+    //     .    ,   
+    void SetMapRenderSettings(map_renderer::MapRendererSettings&& settings);
+
+    //        (,   )
+    void SetMap(std::string&& map) const;
+
+    //        (,   )
+    void SetPolylineLod(map_renderer::PolylineLod&& polyline_lod) const;
 
     //    
     bool IsRouteValid(
@@ -96,6 +135,11 @@ public:
         router_ = std::make_unique<transport_graph::TransportRouter>(std::move(router));
     }
 
+    //      ,      
+    void SetRouterSource(std::unique_ptr<RouterSource>&& source) {
+        router_source_ = std::move(source);
+    }
+
     //    ,    
     const std::set<std::string_view>& GetStopBuses(std::string_view name) const {
         return catalogue_.GetBusesForStop(name);
@@ -106,10 +150,23 @@ public:
         return catalogue_.GetBuses().At(name);
     }
 
-    //          svg 
-    const std::optional<std::string>& GetMap() const {
-        return map_renderer_value_;
-    }
+    //      svg ,     
+    const std::optional<std::string>& GetMap() const;
+
+    //   svg-  ,     .
+    //     ,  nullopt
+    std::optional<std::string> GetMapTile(
+        const map_renderer::TileRequest& request,
+        map_renderer::MapFormat format = map_renderer::MapFormat::SVG) const;
+
+    //       PNG,     
+    const std::optional<std::string>& GetMapPng() const;
+
+    //     ,     
+    const map_renderer::PolylineLod& GetPolylineLod() const;
+
+    //     :      
+    uint64_t GetMapCacheKey() const;
 
     //      
     const std::optional<map_renderer::MapRendererSettings>& GetMapRenderSettings() const {
@@ -119,7 +176,46 @@ public:
     //       from   to
     std::optional<RouteData> GetRoute(std::string_view from, std::string_view to) const;
 
-    //   
+    //      from   to  scratch     ,
+    // nullopt -     .   scratch    
+    std::optional<transport_graph::TransportTime> FindRoute(
+        std::string_view from, std::string_view to, transport_graph::RouteScratch& scratch) const;
+
+    //   visitor  ,  FindRoute,  
+    template <typename Visitor>
+    void VisitRouteItems(const transport_graph::RouteScratch& scratch, Visitor&& visitor) const {
+        router_->VisitRouteItems(scratch, std::forward<Visitor>(visitor));
+    }
+
+    //    count    from   to   
+    // ,      GetRoute.   ,   
+    std::vector<RouteData> GetAlternativeRoutes(std::string_view from, std::string_view to, size_t count) const;
+
+    //      from   to,     
+    //   ,   max_transfers ,    .
+    //   ,   
+    std::vector<RouteData> GetParetoRoutes(std::string_view from, std::string_view to, uint32_t max_transfers) const;
+
+    //         from    to.
+    //   ,    from   .
+    //       nullopt
+    std::vector<RouteTimes> GetRouteTimes(
+        const std::vector<std::string_view>& from,
+        const std::vector<std::string_view>& to) const;
+
+    //      from ,      
+    //   max_time,       .   
+    //  .     nullopt
+    std::vector<std::optional<std::vector<map_renderer::IsochroneStop>>> GetIsochrones(
+        const std::vector<std::string_view>& from, double max_time) const;
+
+    //   svg-    .
+    //     ,  nullopt
+    std::optional<std::string> GetIsochroneMap(
+        const std::vector<map_renderer::IsochroneStop>& stops, double max_time) const;
+
+    //   :        .
+    //   ,      
     void InitRouter() const;
 
     //     
@@ -151,22 +247,121 @@ public:
         return *bus_optional;
     }
 
-    //     
+    //     ,  , ,    
+    memory_usage::Report GetMemoryReport() const;
+
+    //   ,    
+    const transport_catalogue::TransportCatalogue& GetCatalogue() const {
+        return catalogue_;
+    }
+
+    //      (nullptr,    )
     const transport_graph::TransportGraph* GetGraph() const {
         return graph_.get();
     }
 
-    //     
+    //      (nullptr,    )
     const transport_graph::TransportRouter* GetRouter() const {
         return router_.get();
     }
 
 private:
+    //    ,     .
+    //   map_mutex_
+    const map_renderer::MapRenderer& GetMapRenderer() const;
+
     transport_catalogue::TransportCatalogue& catalogue_;
-    std::optional<std::string> map_renderer_value_;
+    mutable std::mutex map_mutex_;
+    mutable std::optional<std::string> map_renderer_value_;
+    mutable std::optional<std::string> map_png_value_;
+    mutable std::unique_ptr<map_renderer::MapRenderer> map_renderer_;
+    mutable map_renderer::PolylineLod polyline_lod_;
+    mutable map_renderer::TileCache tile_cache_;
     std::optional<map_renderer::MapRendererSettings> map_render_settings_;
     mutable std::unique_ptr<transport_graph::TransportGraph> graph_;
     mutable std::unique_ptr<transport_graph::TransportRouter> router_;
+    mutable std::unique_ptr<RouterSource> router_source_;
+    mutable std::once_flag router_flag_;
+
+    //  ,   
+    static constexpr size_t TILE_CACHE_CAPACITY = 1024;
+};
+
+// ---------- BaseSnapshot ----------------------------------------------------
+
+//   :    ,   .
+//     ,      
+class BaseSnapshot {
+public:
+    BaseSnapshot();
+
+    BaseSnapshot(const BaseSnapshot&) = delete;
+    BaseSnapshot& operator= (const BaseSnapshot&) = delete;
+
+    //     .        
+    static std::shared_ptr<const BaseSnapshot> Load(const std::string& file_name);
+
+    //     
+    const RequestHandler& GetHandler() const {
+        return handler_;
+    }
+
+private:
+    //   :     
+    transport_catalogue::TransportCatalogue catalogue_;
+    RequestHandler handler_;
+};
+
+// ---------- BaseSnapshotHolder ----------------------------------------------
+
+//       RCU:   
+// shared_ptr  ,       .
+//   ,     
+class BaseSnapshotHolder {
+public:
+    BaseSnapshotHolder() = default;
+
+    ~BaseSnapshotHolder();
+
+    //     (  nullptr,    )
+    std::shared_ptr<const BaseSnapshot> Acquire() const {
+        return std::atomic_load(&snapshot_);
+    }
+
+    //     
+    void Publish(std::shared_ptr<const BaseSnapshot> snapshot) {
+        std::atomic_store(&snapshot_, std::move(snapshot));
+    }
+
+    //         
+    void Reload(const std::string& file_name);
+
+    //    : nullptr  ,   
+    using ReloadCallback = std::function<void(std::exception_ptr)>;
+
+    //         ,    
+    //   on_finish   . ,   , 
+    //   .   :    ,    
+    //   ,     ,  
+    void ReloadAsync(std::string file_name, ReloadCallback on_finish);
+
+    //     
+    void WaitReload();
+
+private:
+    struct PendingReload {
+        std::string file_name;
+        ReloadCallback on_finish;
+    };
+
+    //      ,   
+    void RunReloads(PendingReload reload);
+
+    std::shared_ptr<const BaseSnapshot> snapshot_;
+    std::mutex reload_mutex_;
+    std::optional<PendingReload> pending_reload_;
+    bool is_reloading_ = false;
+    std::future<void> reload_;
 };
 
 // ----------------------------------------------------------------------------
@@ -179,7 +374,7 @@ void RequestBaseStopProcess(
     const json::Node* node);
 
 //       
-transport_catalogue::bus_catalogue::BusHelper RequestBaseBusProcess(const json::Node* node);
+transport_catalogue::bus_catalogue::BusHelper RequestBaseBusProcess(const json::Node* node, const transport_catalogue::RouteSettings& common_settings);
 
 //   json   
 svg::Color ParseColor(const json::Node* node);
@@ -219,6 +414,58 @@ void RequestMapProcess(
     const RequestHandler& request_handler,
     const json::Dict& request);
 
+//       :  z/x/y   bbox
+void RequestMapTileProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request);
+
+//           
+void RequestRouteOneToManyProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request);
+
+//           
+void RequestRouteMatrixProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request);
+
+//        
+static constexpr int DEFAULT_ALTERNATIVE_ROUTES = 3;
+static constexpr int MAX_ALTERNATIVE_ROUTES = 10;
+
+//        
+void RequestAlternativeRoutesProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request);
+
+//      ParetoRoutes  Route   
+static constexpr int MAX_TRANSFERS = 16;
+
+//    ,      
+void RequestParetoRoutesProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request);
+
+//    ,    
+void RequestIsochroneProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request);
+
+//         
+void RequestStatsProcess(
+    json::Builder& builder,
+    const RequestHandler& request_handler,
+    const json::Dict& request);
+
+//        ,    builder
+void PrintMemoryReport(json::Builder& builder, const memory_usage::Report& report);
+
 //    
 void RequestStatProcess(
     json::Builder& builder,
@@ -244,16 +491,56 @@ public:
 
     void ExecuteProcessRequests();
 
+    //    JSON   ,   
+    void PrintMemoryReport(std::ostream& out) const;
+
 private:
     void ExecuteBaseProcess();
-    void ExecuteStatProcess();
+    void ExecuteStatProcess(const RequestHandler& handler);
 
 private:
     std::istream& input_;
     std::ostream& output_;
     const json::Reader reader_;
-    RequestHandler handler_;
     transport_catalogue::TransportCatalogue catalogue_;
+    RequestHandler handler_;
+    BaseSnapshotHolder snapshots_;
+};
+
+// ----------------------------------------------------------------------------
+
+//      JSON Lines:    - 
+// JSON-.    serialization_settings,   -
+//  stat-,           .
+//  {"id": N, "type": "ReloadBase", "file": "..."}    {"request_id": N}
+//      ,   .   
+//    error_message    request_id
+class RequestStreamProcess {
+public:
+    RequestStreamProcess(std::istream& input, std::ostream& output)
+        : input_(input)
+        , output_(output) {
+    }
+
+    void Execute();
+
+private:
+    void ExecuteSettings(const json::Node& node);
+    void ExecuteRequest(const json::Node& node);
+
+    //   id ,     
+    static std::optional<int> GetRequestId(const json::Node& node);
+    //     error_message  ,    
+    void PrintError(std::optional<int> request_id, const std::string& message);
+    //     .      ,   
+    void PrintLine(json::Node node);
+
+private:
+    std::istream& input_;
+    std::ostream& output_;
+    //   :    ,   
+    std::mutex output_mutex_;
+    BaseSnapshotHolder snapshots_;
 };
 
 } // namespace request_handler
@@ -5,7 +5,10 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <execution>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -56,16 +59,40 @@ namespace graph {
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        // Метод записывает рёбра кратчайшего пути в reversed_edges от последнего к первому и возвращает
+        // вес пути. Память reversed_edges переиспользуется, поэтому повторные запросы не выделяют память
+        std::optional<Weight> BuildReversedRoute(VertexId from, VertexId to, std::vector<EdgeId>& reversed_edges) const;
+
     private:
         friend class RouterDataGetter<Weight>;
         friend class RouterCreator<Weight>;
 
     public:
+        // Пути между вершинами нет
+        static constexpr uint32_t NO_ROUTE = std::numeric_limits<uint32_t>::max();
+        // Путь есть, но пустой: из вершины в неё же
+        static constexpr uint32_t NO_EDGE = NO_ROUTE - 1;
+
+        // Ячейка таблицы кратчайших путей: вес пути и его последнее ребро.
+        // Вес хранится приближённо, точный вес маршрута считается по его рёбрам
         struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
+            float weight = std::numeric_limits<float>::infinity();
+            uint32_t prev_edge = NO_ROUTE;
+        };
+
+        // Таблица vertex_count x vertex_count одним массивом по строкам
+        struct RoutesInternalData {
+            size_t vertex_count = 0;
+            std::vector<RouteInternalData> cells;
+
+            RouteInternalData& At(VertexId from, VertexId to) {
+                return cells[from * vertex_count + to];
+            }
+
+            const RouteInternalData& At(VertexId from, VertexId to) const {
+                return cells[from * vertex_count + to];
+            }
         };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
     private:
         Router(const Graph& graph, RoutesInternalData&& routes_internal_data)
@@ -73,45 +100,161 @@ namespace graph {
             , routes_internal_data_(std::move(routes_internal_data)) {
         }
 
-        void InitializeRoutesInternalData(const Graph& graph) {
+        // Веса при построении считаются в Weight, чтобы выбор путей не зависел от точности хранения.
+        // Отсутствие пути при построении - бесконечный вес, поэтому при релаксации проверки не нужны
+        void InitializeRoutesInternalData(const Graph& graph, std::vector<Weight>& weights, std::vector<uint32_t>& prev_edges) {
             const size_t vertex_count = graph.GetVertexCount();
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+                weights[vertex * vertex_count + vertex] = ZERO_WEIGHT;
+                prev_edges[vertex * vertex_count + vertex] = NO_EDGE;
                 for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                     const auto& edge = graph.GetEdge(edge_id);
                     if (edge.weight < ZERO_WEIGHT) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                    const size_t index = vertex * vertex_count + edge.to;
+                    if (prev_edges[index] == NO_ROUTE || weights[index] > edge.weight) {
+                        weights[index] = edge.weight;
+                        prev_edges[index] = static_cast<uint32_t>(edge_id);
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+        /*
+        * Столбец и строка промежуточных вершин блока в том виде, какими они были перед релаксацией
+        * через соответствующую вершину. Через них каждая ячейка релаксируется теми же значениями,
+        * что и в последовательном алгоритме, поэтому пути и выбор среди равных по весу не меняются
+        */
+        struct ThroughPanels {
+            ThroughPanels(size_t vertex_count)
+                : columns(vertex_count * TILE_SIZE)
+                , rows(TILE_SIZE * vertex_count)
+                , row_prev_edges(TILE_SIZE * vertex_count) {
+            }
+
+            // columns[from * TILE_SIZE + through] - вес пути из from в промежуточную вершину
+            std::vector<Weight> columns;
+            // rows[through * vertex_count + to] - вес и последнее ребро пути из промежуточной вершины в to
+            std::vector<Weight> rows;
+            std::vector<uint32_t> row_prev_edges;
+        };
+
+        // Запоминает вес путей из вершин [from_begin, from_end) в вершину vertex_through
+        static void SaveThroughColumn(size_t vertex_count, const std::vector<Weight>& weights, ThroughPanels& panels,
+            size_t from_begin, size_t from_end, size_t through_begin, size_t vertex_through) {
+            for (size_t vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+                panels.columns[vertex_from * TILE_SIZE + vertex_through - through_begin] =
+                    weights[vertex_from * vertex_count + vertex_through];
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
-                    }
+        // Запоминает пути из вершины vertex_through в вершины [to_begin, to_end)
+        static void SaveThroughRow(size_t vertex_count, const std::vector<Weight>& weights,
+            const std::vector<uint32_t>& prev_edges, ThroughPanels& panels,
+            size_t to_begin, size_t to_end, size_t through_begin, size_t vertex_through) {
+            const size_t row = (vertex_through - through_begin) * vertex_count;
+            const size_t source_row = vertex_through * vertex_count;
+            std::copy(weights.begin() + source_row + to_begin, weights.begin() + source_row + to_end,
+                panels.rows.begin() + row + to_begin);
+            std::copy(prev_edges.begin() + source_row + to_begin, prev_edges.begin() + source_row + to_end,
+                panels.row_prev_edges.begin() + row + to_begin);
+        }
+
+        // Релаксирует пути из вершин [from_begin, from_end) в вершины [to_begin, to_end) через vertex_through.
+        // Путь через vertex_through в неё же или из неё не короче прямого, поэтому пустые
+        // пути NO_EDGE никогда не становятся последним ребром
+        static void RelaxThroughVertex(size_t vertex_count, std::vector<Weight>& weights, std::vector<uint32_t>& prev_edges,
+            const ThroughPanels& panels, size_t from_begin, size_t from_end, size_t to_begin, size_t to_end,
+            size_t through_begin, size_t vertex_through) {
+            const Weight* weights_through = panels.rows.data() + (vertex_through - through_begin) * vertex_count;
+            const uint32_t* prev_edges_through = panels.row_prev_edges.data() + (vertex_through - through_begin) * vertex_count;
+
+            for (size_t vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+                const Weight weight_from = panels.columns[vertex_from * TILE_SIZE + vertex_through - through_begin];
+                if (weight_from == INFINITE_WEIGHT) {
+                    continue;
+                }
+                Weight* weights_from = weights.data() + vertex_from * vertex_count;
+                uint32_t* prev_edges_from = prev_edges.data() + vertex_from * vertex_count;
+
+                for (size_t vertex_to = to_begin; vertex_to < to_end; ++vertex_to) {
+                    const Weight candidate_weight = weight_from + weights_through[vertex_to];
+                    const bool is_shorter = candidate_weight < weights_from[vertex_to];
+                    weights_from[vertex_to] = is_shorter ? candidate_weight : weights_from[vertex_to];
+                    prev_edges_from[vertex_to] = is_shorter ? prev_edges_through[vertex_to] : prev_edges_from[vertex_to];
                 }
             }
         }
 
+        /*
+        * Алгоритм Флойда-Уоршелла по блокам TILE_SIZE x TILE_SIZE. Для каждого блока промежуточных вершин
+        * сначала релаксируется диагональный блок, затем блоки его строки и столбца, затем все остальные.
+        * Блоки одной фазы не пересекаются по записи и обрабатываются параллельно
+        */
+        static void RelaxRoutesInternalData(size_t vertex_count, std::vector<Weight>& weights, std::vector<uint32_t>& prev_edges) {
+            const size_t tile_count = (vertex_count + TILE_SIZE - 1) / TILE_SIZE;
+            const auto tile_begin = [](size_t tile) {
+                return tile * TILE_SIZE;
+            };
+            const auto tile_end = [vertex_count](size_t tile) {
+                return std::min(vertex_count, (tile + 1) * TILE_SIZE);
+            };
+
+            std::vector<size_t> tiles(tile_count);
+            std::iota(tiles.begin(), tiles.end(), 0);
+            ThroughPanels panels(vertex_count);
+
+            for (size_t through = 0; through < tile_count; ++through) {
+                const size_t through_begin = tile_begin(through);
+                const size_t through_end = tile_end(through);
+
+                for (size_t vertex_through = through_begin; vertex_through < through_end; ++vertex_through) {
+                    SaveThroughColumn(vertex_count, weights, panels, through_begin, through_end, through_begin, vertex_through);
+                    SaveThroughRow(vertex_count, weights, prev_edges, panels, through_begin, through_end, through_begin, vertex_through);
+                    RelaxThroughVertex(vertex_count, weights, prev_edges, panels,
+                        through_begin, through_end, through_begin, through_end, through_begin, vertex_through);
+                }
+
+                std::for_each(std::execution::par, tiles.begin(), tiles.end(),
+                    [&](size_t tile) {
+                        if (tile == through) {
+                            return;
+                        }
+                        const size_t begin = tile_begin(tile);
+                        const size_t end = tile_end(tile);
+                        for (size_t vertex_through = through_begin; vertex_through < through_end; ++vertex_through) {
+                            SaveThroughRow(vertex_count, weights, prev_edges, panels, begin, end, through_begin, vertex_through);
+                            RelaxThroughVertex(vertex_count, weights, prev_edges, panels,
+                                through_begin, through_end, begin, end, through_begin, vertex_through);
+
+                            SaveThroughColumn(vertex_count, weights, panels, begin, end, through_begin, vertex_through);
+                            RelaxThroughVertex(vertex_count, weights, prev_edges, panels,
+                                begin, end, through_begin, through_end, through_begin, vertex_through);
+                        }
+                    });
+
+                std::for_each(std::execution::par, tiles.begin(), tiles.end(),
+                    [&](size_t from) {
+                        if (from == through) {
+                            return;
+                        }
+                        for (size_t to = 0; to < tile_count; ++to) {
+                            if (to == through) {
+                                continue;
+                            }
+                            for (size_t vertex_through = through_begin; vertex_through < through_end; ++vertex_through) {
+                                RelaxThroughVertex(vertex_count, weights, prev_edges, panels,
+                                    tile_begin(from), tile_end(from), tile_begin(to), tile_end(to), through_begin, vertex_through);
+                            }
+                        }
+                    });
+            }
+        }
+
+        // Блок из TILE_SIZE x TILE_SIZE весов и рёбер помещается в кэш L2
+        static constexpr size_t TILE_SIZE = 64;
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
         static constexpr Weight ZERO_WEIGHT{};
         const Graph& graph_;
         RoutesInternalData routes_internal_data_;
@@ -122,35 +265,62 @@ namespace graph {
     template <typename Weight>
     Router<Weight>::Router(const Graph& graph)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , routes_internal_data_{ graph.GetVertexCount(),
+            std::vector<RouteInternalData>(graph.GetVertexCount() * graph.GetVertexCount()) }
     {
-        InitializeRoutesInternalData(graph);
-
         const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        std::vector<Weight> weights(vertex_count * vertex_count, INFINITE_WEIGHT);
+        std::vector<uint32_t> prev_edges(vertex_count * vertex_count, NO_ROUTE);
+
+        InitializeRoutesInternalData(graph, weights, prev_edges);
+        RelaxRoutesInternalData(vertex_count, weights, prev_edges);
+
+        for (size_t i = 0; i < weights.size(); ++i) {
+            auto& route_internal_data = routes_internal_data_.cells[i];
+            route_internal_data.prev_edge = prev_edges[i];
+            if (prev_edges[i] != NO_ROUTE) {
+                route_internal_data.weight = static_cast<float>(weights[i]);
+            }
         }
     }
 
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        std::vector<EdgeId> reversed_edges;
+        const auto weight = BuildReversedRoute(from, to, reversed_edges);
+        if (!weight) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
-        std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        return RouteInfo{ *weight, std::vector<EdgeId>(reversed_edges.rbegin(), reversed_edges.rend()) };
+    }
+
+    template <typename Weight>
+    std::optional<Weight> Router<Weight>::BuildReversedRoute(VertexId from, VertexId to,
+        std::vector<EdgeId>& reversed_edges) const {
+        if (from >= routes_internal_data_.vertex_count || to >= routes_internal_data_.vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        reversed_edges.clear();
+
+        const auto& route_internal_data = routes_internal_data_.At(from, to);
+        if (route_internal_data.prev_edge == NO_ROUTE) {
+            return std::nullopt;
+        }
+        for (uint32_t edge_id = route_internal_data.prev_edge;
+            edge_id != NO_EDGE;
+            edge_id = routes_internal_data_.At(from, graph_.GetEdge(edge_id).from).prev_edge)
         {
-            edges.push_back(*edge_id);
+            reversed_edges.push_back(edge_id);
+        }
+
+        // вес суммируется от первого ребра к последнему, как при обходе маршрута
+        Weight weight = ZERO_WEIGHT;
+        for (auto it = reversed_edges.rbegin(); it != reversed_edges.rend(); ++it) {
+            weight += graph_.GetEdge(*it).weight;
         }
-        std::reverse(edges.begin(), edges.end());
 
-        return RouteInfo{ weight, std::move(edges) };
+        return weight;
     }
 
 }  // namespace graph
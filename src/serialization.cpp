@@ -1,9 +1,22 @@
 #include "serialization.h"
 
+#include <google/protobuf/arena.h>
+
+#include <algorithm>
+#include <exception>
+#include <execution>
 #include <iostream>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
+#include "base_container.h"
 #include "map_renderer.h"
+#include "metrics.h"
 #include "svg.h"
 
 namespace transport_serialization {
@@ -12,28 +25,23 @@ namespace transport_serialization {
 
 namespace detail_serialization {
 
-transport_proto::Coordinates CreateProtoCoord(const Coordinates& coord) {
-    transport_proto::Coordinates proto_coord;
-    proto_coord.set_lat(coord.lat);
-    proto_coord.set_lng(coord.lng);
-    return proto_coord;
-}
-
-transport_proto::Stop CreateProtoStop(const transport_catalogue::stop_catalogue::Stop* stop, const request_handler::RequestHandler& rh) {
-    transport_proto::Stop proto_stop;
+// Сообщения частей базы заполняются на месте, без промежуточных копий
 
+void FillProtoStop(transport_proto::Stop& proto_stop, const transport_catalogue::stop_catalogue::Stop* stop, const request_handler::RequestHandler& rh, std::string&& road_distances) {
     proto_stop.set_id(rh.GetId(stop));
     proto_stop.set_name(stop->name);
-    *proto_stop.mutable_coord() = CreateProtoCoord(stop->coord);
-
-    return proto_stop;
+    proto_stop.mutable_coord()->set_lat(stop->coord.lat);
+    proto_stop.mutable_coord()->set_lng(stop->coord.lng);
+    if (stop->bus_wait_time) {
+        proto_stop.set_bus_wait_time(*stop->bus_wait_time);
+    }
+    proto_stop.set_road_distances(std::move(road_distances));
 }
 
-transport_proto::Bus CreateProtoBus(const transport_catalogue::bus_catalogue::Bus* bus, const request_handler::RequestHandler& rh) {
-    transport_proto::Bus proto_bus;
-
+void FillProtoBus(transport_proto::Bus& proto_bus, const transport_catalogue::bus_catalogue::Bus* bus, const request_handler::RequestHandler& rh) {
     proto_bus.set_id(rh.GetId(bus));
     proto_bus.set_name(bus->name);
+    proto_bus.mutable_route()->Reserve(static_cast<int>(bus->route.size()));
     for (const auto* stop : bus->route) {
         proto_bus.add_route(rh.GetId(stop));
     }
@@ -42,8 +50,7 @@ transport_proto::Bus CreateProtoBus(const transport_catalogue::bus_catalogue::Bu
     proto_bus.set_route_true_length(bus->route_true_length);
     proto_bus.set_stops_on_route(bus->stops_on_route);
     proto_bus.set_unique_stops(bus->unique_stops);
-
-    return proto_bus;
+    proto_bus.set_bus_velocity(bus->route_settings.bus_velocity);
 }
 
 transport_proto::Point CreateProtoPoint(const svg::Point& point) {
@@ -81,10 +88,25 @@ transport_proto::MapRenderSettings CreateProtoMapRenderSettings(const map_render
     for (const svg::Color& color : setting.color_palette) {
         *proto_settings.add_color_palette() = CreateProtoColor(color);
     }
+    proto_settings.set_simplify_tolerance(setting.simplify_tolerance);
 
     return proto_settings;
 }
 
+transport_proto::PolylineLod CreateProtoPolylineLod(const map_renderer::PolylineLod& polyline_lod, uint64_t key) {
+    transport_proto::PolylineLod proto_lod;
+
+    proto_lod.set_key(key);
+    for (const auto& level : polyline_lod) {
+        transport_proto::LodLevel& proto_level = *proto_lod.add_level();
+        for (const auto& polyline : level) {
+            proto_level.add_polyline()->mutable_vertex()->Add(polyline.begin(), polyline.end());
+        }
+    }
+
+    return proto_lod;
+}
+
 transport_proto::RouteSettings CreateProtoRouteSetting(const transport_catalogue::RouteSettings& settings) {
     transport_proto::RouteSettings proto_settings;
 
@@ -94,115 +116,233 @@ transport_proto::RouteSettings CreateProtoRouteSetting(const transport_catalogue
     return proto_settings;
 }
 
-transport_proto::Edge CreateProtoEdge(const graph::Edge<double>& edge) {
-    transport_proto::Edge proto_edge;
-
+void FillProtoEdge(transport_proto::Edge& proto_edge, const graph::Edge<double>& edge) {
     proto_edge.set_from(edge.from);
     proto_edge.set_to(edge.to);
     proto_edge.set_weight(edge.weight);
-
-    return proto_edge;
 }
 
-transport_proto::IncidenceList CreateProtoIncidenceList(const graph::DirectedWeightedGraph<transport_graph::TransportTime>::IncidenceList& incidence_list) {
-    transport_proto::IncidenceList proto_incidence_list;
-
-    for (const auto& edge_id : incidence_list) {
-        proto_incidence_list.add_id(edge_id);
-    }
-
-    return proto_incidence_list;
-}
-
-transport_proto::TransportGraphData CreateProtoTransportGraphData(const transport_graph::TransportGraphData& data, const request_handler::RequestHandler& rh) {
-    transport_proto::TransportGraphData proto_data;
-
-    proto_data.set_stop_to_id(rh.GetId(data.to));
-    proto_data.set_stop_from_id(rh.GetId(data.from));
-    if (data.bus) {
-        proto_data.set_bus_id(rh.GetId(data.bus));
+void FillProtoTransportGraphData(transport_proto::TransportGraphData& proto_data, const transport_graph::TransportGraphData& data) {
+    proto_data.set_stop_to_id(data.to);
+    proto_data.set_stop_from_id(data.from);
+    if (data.bus != transport_graph::TransportGraphData::NO_BUS) {
+        proto_data.set_bus_id(data.bus);
         proto_data.set_is_bus(true);
     } else {
         proto_data.set_is_bus(false);
     }
     proto_data.set_stop_count(data.stop_count);
-    proto_data.set_time(data.time);
+}
 
-    return proto_data;
+// ---------- Части базы ------------------------------------------------------
+
+// Примерное количество элементов в одной части: части должны быть достаточно крупными,
+// чтобы их заголовки и запуск задач ничего не стоили, и достаточно мелкими для параллельной работы
+constexpr size_t STOPS_PER_SHARD = 2048;
+constexpr size_t BUSES_PER_SHARD = 512;
+constexpr size_t EDGES_PER_SHARD = 65536;
+constexpr size_t VERTICES_PER_SHARD = 16384;
+constexpr size_t ROUTER_CELLS_PER_SHARD = 1 << 20;
+// Частей в одной пачке параллельного кодирования на один поток
+constexpr size_t SHARDS_PER_THREAD = 2;
+
+// Часть базы: её вид и номера элементов [begin, end), которые в неё попадают
+struct ShardRange {
+    base_container::ShardKind kind;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+void AddShardRanges(std::vector<ShardRange>& ranges, base_container::ShardKind kind, size_t count, size_t per_shard) {
+    for (size_t begin = 0; begin < count; begin += per_shard) {
+        ranges.push_back({ kind, begin, std::min(count, begin + per_shard) });
+    }
 }
 
-transport_proto::VertexIdLoop CreateProtoVertexIdLoop(const transport_graph::VertexIdLoop& vertex_id_loop) {
-    transport_proto::VertexIdLoop proto_vertex_id_loop;
+// Данные, из которых параллельно строятся части базы
+class ShardsBuilder {
+public:
+    ShardsBuilder(const request_handler::RequestHandler& rh, const SerializationSettings& settings)
+        : rh_(rh)
+        , settings_(settings)
+        , stops_(rh.GetStops())
+        , buses_(rh.GetBuses())
+        , road_distances_(rh.GetCatalogue().GetStops().EncodeDistances()) {
+    }
 
-    proto_vertex_id_loop.set_id(vertex_id_loop.id);
-    proto_vertex_id_loop.set_transfer_id(vertex_id_loop.transfer_id);
+    std::vector<ShardRange> GetRanges() const {
+        using base_container::ShardKind;
 
-    return proto_vertex_id_loop;
-}
+        std::vector<ShardRange> ranges{ { ShardKind::HEADER, 0, 0 } };
+        AddShardRanges(ranges, ShardKind::STOPS, stops_.size(), STOPS_PER_SHARD);
+        AddShardRanges(ranges, ShardKind::BUSES, buses_.size(), BUSES_PER_SHARD);
 
-transport_proto::Graph CreateProtoGraph(const transport_graph::TransportGraph& graph, const request_handler::RequestHandler& rh) {
-    transport_proto::Graph proto_graph;
+        if (const auto* graph = rh_.GetGraph()) {
+            AddShardRanges(ranges, ShardKind::GRAPH_EDGES, graph->GetEdgesData().size(), EDGES_PER_SHARD);
+            AddShardRanges(ranges, ShardKind::GRAPH_INCIDENCE, graph->GetGraph().GetVertexCount(), VERTICES_PER_SHARD);
+        }
 
-    graph::GraphSerialization<transport_graph::TransportTime> gs;
+        if (rh_.GetRouter()) {
+            const size_t vertex_count = GetRoutesInternalData().vertex_count;
+            AddShardRanges(ranges, ShardKind::ROUTER_ROWS, vertex_count,
+                std::max<size_t>(1, ROUTER_CELLS_PER_SHARD / std::max<size_t>(1, vertex_count)));
+        }
 
-    for (const auto& edge : gs.GetEdges(graph.GetGraph())) {
-        *proto_graph.add_edge() = CreateProtoEdge(edge);
+        return ranges;
+    }
+
+    // Метод строит часть базы и кодирует её в out, buffer нужен для сжатия. Каждая часть строится на своей арене,
+    // поэтому части можно строить и сжимать параллельно, а память сообщения освобождается одним блоком
+    void Build(const ShardRange& range, std::string& out, std::string& buffer) {
+        using base_container::ShardKind;
+
+        google::protobuf::Arena arena;
+        const base_container::Codec codec = settings_.codec;
+        switch (range.kind) {
+        case ShardKind::HEADER:
+            return base_container::EncodeShard(range.kind, codec, BuildHeader(arena), out, buffer);
+        case ShardKind::STOPS:
+            return base_container::EncodeShard(range.kind, codec, BuildStops(arena, range), out, buffer);
+        case ShardKind::BUSES:
+            return base_container::EncodeShard(range.kind, codec, BuildBuses(arena, range), out, buffer);
+        case ShardKind::GRAPH_EDGES:
+            return base_container::EncodeShard(range.kind, codec, BuildGraphEdges(arena, range), out, buffer);
+        case ShardKind::GRAPH_INCIDENCE:
+            return base_container::EncodeShard(range.kind, codec, BuildGraphIncidence(arena, range), out, buffer);
+        case ShardKind::ROUTER_ROWS:
+            return base_container::EncodeShard(range.kind, codec, BuildRouterRows(arena, range), out, buffer);
+        }
+        throw std::logic_error("Unknown shard kind");
     }
 
-    for (const auto& incidence_list : gs.GetIncidenceList(graph.GetGraph())) {
-        *proto_graph.add_incidence_list() = CreateProtoIncidenceList(incidence_list);
+private:
+    const graph::Router<transport_graph::TransportTime>::RoutesInternalData& GetRoutesInternalData() const {
+        const auto& router = transport_graph::TransportRouterGetter::GetRouter(*rh_.GetRouter());
+        return graph::RouterDataGetter<transport_graph::TransportTime>::GetInternalData(router);
     }
 
-    for (const auto& [edge_id, graph_data] : graph.GetEdgeIdToGraphData()) {
-        (*proto_graph.mutable_edge_id_to_graph_data())[static_cast<uint32_t>(edge_id)] = CreateProtoTransportGraphData(graph_data, rh);
-    }
+    const transport_proto::TransportCatalogue& BuildHeader(google::protobuf::Arena& arena) const {
+        auto* tc = google::protobuf::Arena::CreateMessage<transport_proto::TransportCatalogue>(&arena);
+
+        const auto& map_render_settings = rh_.GetMapRenderSettings();
+        if (map_render_settings) {
+            *tc->mutable_map_render_setting() = CreateProtoMapRenderSettings(map_render_settings.value());
+
+            if (settings_.cache_map) {
+                tc->mutable_rendered_map()->set_key(rh_.GetMapCacheKey());
+                tc->mutable_rendered_map()->set_svg(*rh_.GetMap());
+            }
+
+            // Упрощённые линии строятся один раз при создании базы
+            if (map_render_settings->simplify_tolerance > 0.0) {
+                *tc->mutable_polyline_lod() = CreateProtoPolylineLod(rh_.GetPolylineLod(), rh_.GetMapCacheKey());
+            }
+        }
+
+        *tc->mutable_route_settings() = CreateProtoRouteSetting(rh_.GetRouteSettings());
+
+        if (const auto* graph = rh_.GetGraph()) {
+            transport_proto::Graph& proto_graph = *tc->mutable_graph();
+            proto_graph.set_edge_count(static_cast<uint32_t>(graph->GetEdgesData().size()));
+            proto_graph.set_vertex_count(static_cast<uint32_t>(graph->GetGraph().GetVertexCount()));
+
+            proto_graph.mutable_stop_to_vertex_id()->Reserve(static_cast<int>(graph->GetStopToVertexId().size()));
+            for (const auto& vertex_id_loop : graph->GetStopToVertexId()) {
+                transport_proto::VertexIdLoop& proto_vertex_id_loop = *proto_graph.add_stop_to_vertex_id();
+                proto_vertex_id_loop.set_id(vertex_id_loop.id);
+                proto_vertex_id_loop.set_transfer_id(vertex_id_loop.transfer_id);
+            }
+        }
 
-    for (const auto& [stop_ptr, vertex_id_loop] : graph.GetStopToVertexId()) {
-        (*proto_graph.mutable_stop_to_vertex_id())[rh.GetId(stop_ptr)] = CreateProtoVertexIdLoop(vertex_id_loop);
+        if (rh_.GetRouter()) {
+            tc->mutable_router()->set_vertex_count(static_cast<uint32_t>(GetRoutesInternalData().vertex_count));
+        }
+
+        return *tc;
     }
 
-    return proto_graph;
-}
+    const transport_proto::StopsShard& BuildStops(google::protobuf::Arena& arena, const ShardRange& range) {
+        auto* shard = google::protobuf::Arena::CreateMessage<transport_proto::StopsShard>(&arena);
 
-transport_proto::RouteInternalData CreateProtoRouteInternalData(size_t pos, const graph::Router<transport_graph::TransportTime>::RouteInternalData& data) {
-    transport_proto::RouteInternalData proto_route_internal_data;
+        shard->mutable_stop()->Reserve(static_cast<int>(range.end - range.begin));
+        for (size_t i = range.begin; i < range.end; ++i) {
+            const size_t id = rh_.GetId(stops_[i]);
+            // части не пересекаются, поэтому закодированные расстояния забираются без блокировок
+            FillProtoStop(*shard->add_stop(), stops_[i], rh_,
+                id < road_distances_.size() ? std::move(road_distances_[id]) : std::string{});
+        }
 
-    proto_route_internal_data.set_pos(pos);
-    proto_route_internal_data.set_weight(data.weight);
-    if (data.prev_edge) {
-        proto_route_internal_data.set_is_prev_edge(true);
-        proto_route_internal_data.set_prev_edge_id(*data.prev_edge);
+        return *shard;
     }
-    else {
-        proto_route_internal_data.set_is_prev_edge(false);
+
+    const transport_proto::BusesShard& BuildBuses(google::protobuf::Arena& arena, const ShardRange& range) const {
+        auto* shard = google::protobuf::Arena::CreateMessage<transport_proto::BusesShard>(&arena);
+
+        shard->mutable_bus()->Reserve(static_cast<int>(range.end - range.begin));
+        for (size_t i = range.begin; i < range.end; ++i) {
+            FillProtoBus(*shard->add_bus(), buses_[i], rh_);
+        }
+
+        return *shard;
     }
 
-    return proto_route_internal_data;
-}
+    const transport_proto::GraphEdgesShard& BuildGraphEdges(google::protobuf::Arena& arena, const ShardRange& range) const {
+        auto* shard = google::protobuf::Arena::CreateMessage<transport_proto::GraphEdgesShard>(&arena);
 
-transport_proto::Router CreateProtoRouter(const transport_graph::TransportRouter& transport_router) {
-    transport_proto::Router proto_router;
+        const graph::GraphSerialization<transport_graph::TransportTime> gs;
+        const auto& edges = gs.GetEdges(rh_.GetGraph()->GetGraph());
+        const auto& edges_data = rh_.GetGraph()->GetEdgesData();
 
-    const auto& router = transport_graph::TransportRouterGetter::GetRouter(transport_router);
+        shard->set_first_edge(static_cast<uint32_t>(range.begin));
+        shard->mutable_edge()->Reserve(static_cast<int>(range.end - range.begin));
+        shard->mutable_edge_data()->Reserve(static_cast<int>(range.end - range.begin));
+        for (size_t i = range.begin; i < range.end; ++i) {
+            FillProtoEdge(*shard->add_edge(), edges[i]);
+            FillProtoTransportGraphData(*shard->add_edge_data(), edges_data[i]);
+        }
 
-    transport_proto::RoutesInternalData routes_internal_data;
-    for (const auto& vector_with_internal_data : graph::RouterDataGetter<transport_graph::TransportTime>::GetInternalData(router)) {
-        transport_proto::RouteInternalDataVector data_vector;
-        data_vector.set_size(vector_with_internal_data.size());
-        size_t pos = 0;
-        for (const auto& internal_data : vector_with_internal_data) {
-            if (internal_data) {
-                *data_vector.add_route_internal_data() = CreateProtoRouteInternalData(pos, *internal_data);
-            }
-            pos++;
+        return *shard;
+    }
+
+    const transport_proto::GraphIncidenceShard& BuildGraphIncidence(google::protobuf::Arena& arena, const ShardRange& range) const {
+        auto* shard = google::protobuf::Arena::CreateMessage<transport_proto::GraphIncidenceShard>(&arena);
+
+        const graph::GraphSerialization<transport_graph::TransportTime> gs;
+        const auto& incidence_lists = gs.GetIncidenceList(rh_.GetGraph()->GetGraph());
+
+        shard->set_first_vertex(static_cast<uint32_t>(range.begin));
+        shard->mutable_incidence_list()->Reserve(static_cast<int>(range.end - range.begin));
+        for (size_t i = range.begin; i < range.end; ++i) {
+            shard->add_incidence_list()->mutable_id()->Add(incidence_lists[i].begin(), incidence_lists[i].end());
         }
-        *routes_internal_data.add_routes_internal_data_vector() = std::move(data_vector);
+
+        return *shard;
     }
 
-    *proto_router.mutable_routes_internal_data() = std::move(routes_internal_data);
+    const transport_proto::RouterRowsShard& BuildRouterRows(google::protobuf::Arena& arena, const ShardRange& range) const {
+        auto* shard = google::protobuf::Arena::CreateMessage<transport_proto::RouterRowsShard>(&arena);
 
-    return proto_router;
-}
+        const auto& routes_internal_data = GetRoutesInternalData();
+        const size_t begin = range.begin * routes_internal_data.vertex_count;
+        const size_t end = range.end * routes_internal_data.vertex_count;
+
+        shard->set_first_row(static_cast<uint32_t>(range.begin));
+        shard->mutable_weight()->Reserve(static_cast<int>(end - begin));
+        shard->mutable_prev_edge()->Reserve(static_cast<int>(end - begin));
+        for (size_t i = begin; i < end; ++i) {
+            shard->add_weight(routes_internal_data.cells[i].weight);
+            shard->add_prev_edge(routes_internal_data.cells[i].prev_edge);
+        }
+
+        return *shard;
+    }
+
+    const request_handler::RequestHandler& rh_;
+    const SerializationSettings& settings_;
+    const std::vector<const transport_catalogue::stop_catalogue::Stop*> stops_;
+    const std::vector<const transport_catalogue::bus_catalogue::Bus*> buses_;
+    std::vector<std::string> road_distances_;
+};
 
 } // namespace detail_serialization
 
@@ -224,6 +364,9 @@ transport_catalogue::stop_catalogue::Stop CreateStop(const transport_proto::Stop
 
     stop.name = proto_stop.name();
     stop.coord = CreateCoord(proto_stop.coord());
+    if (proto_stop.has_bus_wait_time()) {
+        stop.bus_wait_time = static_cast<int>(proto_stop.bus_wait_time());
+    }
 
     return stop;
 }
@@ -241,6 +384,11 @@ transport_catalogue::bus_catalogue::Bus CreateBus(const transport_proto::Bus& pr
     bus.route_true_length = proto_bus.route_true_length();
     bus.stops_on_route = proto_bus.stops_on_route();
     bus.unique_stops = proto_bus.unique_stops();
+    // в базах без скорости маршрута действует общая скорость
+    bus.route_settings = rh.GetRouteSettings();
+    if (proto_bus.bus_velocity() > 0.0) {
+        bus.route_settings.bus_velocity = proto_bus.bus_velocity();
+    }
 
     return bus;
 }
@@ -288,10 +436,25 @@ map_renderer::MapRendererSettings CreateMapRenderSettings(const transport_proto:
     for (int i = 0; i < proto_settings.color_palette_size(); ++i) {
         settings.color_palette.push_back(CreateColor(proto_settings.color_palette(i)));
     }
+    settings.simplify_tolerance = proto_settings.simplify_tolerance();
 
     return settings;
 }
 
+map_renderer::PolylineLod CreatePolylineLod(const transport_proto::PolylineLod& proto_lod) {
+    map_renderer::PolylineLod polyline_lod(proto_lod.level_size());
+
+    for (int i = 0; i < proto_lod.level_size(); ++i) {
+        const transport_proto::LodLevel& proto_level = proto_lod.level(i);
+        polyline_lod[i].reserve(proto_level.polyline_size());
+        for (const transport_proto::LodPolyline& polyline : proto_level.polyline()) {
+            polyline_lod[i].emplace_back(polyline.vertex().begin(), polyline.vertex().end());
+        }
+    }
+
+    return polyline_lod;
+}
+
 transport_catalogue::RouteSettings CreateRouteSettings(const transport_proto::RouteSettings& proto_settings) {
     transport_catalogue::RouteSettings settings;
 
@@ -321,20 +484,13 @@ graph::DirectedWeightedGraph<transport_graph::TransportTime>::IncidenceList Crea
     return list;
 }
 
-transport_graph::TransportGraphData CreateTransportGraphData(
-    const transport_proto::TransportGraphData& proto_data, request_handler::RequestHandler& rh) {
+transport_graph::TransportGraphData CreateTransportGraphData(const transport_proto::TransportGraphData& proto_data) {
     transport_graph::TransportGraphData data{};
 
-    data.from = rh.GetStopById(proto_data.stop_from_id());
-    data.to = rh.GetStopById(proto_data.stop_to_id());
-    if (proto_data.is_bus()) {
-        data.bus = rh.GetBusById(proto_data.bus_id());
-    }
-    else {
-        data.bus = nullptr;
-    }
+    data.from = proto_data.stop_from_id();
+    data.to = proto_data.stop_to_id();
+    data.bus = proto_data.is_bus() ? proto_data.bus_id() : transport_graph::TransportGraphData::NO_BUS;
     data.stop_count = proto_data.stop_count();
-    data.time = proto_data.time();
 
     return data;
 }
@@ -348,140 +504,519 @@ transport_graph::VertexIdLoop CreateVertexIdLoop(const transport_proto::VertexId
     return vertex_id_loop;
 }
 
-transport_graph::TransportGraph CreateGraph(const transport_proto::Graph& proto_graph, request_handler::RequestHandler& rh) {
-    using namespace transport_graph;
+// Части графа, из которых он собирается
+struct GraphParts {
+    std::vector<graph::Edge<transport_graph::TransportTime>> edges;
+    std::vector<graph::DirectedWeightedGraph<transport_graph::TransportTime>::IncidenceList> incidence_lists;
+    std::vector<transport_graph::TransportGraphData> edges_data;
+    std::vector<transport_graph::VertexIdLoop> stop_to_vertex_id;
+};
+
+using RoutesInternalData = graph::Router<transport_graph::TransportTime>::RoutesInternalData;
+
+transport_graph::TransportGraph BuildGraph(GraphParts&& parts, const transport_catalogue::TransportCatalogue& catalogue) {
+    transport_graph::TransportGraphDeserialization deserializer;
+
+    deserializer.CreateGraph(std::move(parts.edges), std::move(parts.incidence_lists));
+    deserializer.SetEdgesData(std::move(parts.edges_data));
+    deserializer.SetStopToVertexId(std::move(parts.stop_to_vertex_id));
+    deserializer.SetCatalogue(catalogue);
+
+    return deserializer.Build();
+}
+
+transport_graph::TransportRouter BuildRouter(const transport_graph::TransportGraph* ptr_graph, RoutesInternalData&& routes_internal_data) {
+    return transport_graph::TransportRouterCreator::Build(
+        *ptr_graph,
+        graph::RouterCreator<transport_graph::TransportTime>::Build(
+            ptr_graph->GetGraph(),
+            std::move(routes_internal_data)
+        )
+    );
+}
+
+std::vector<transport_graph::VertexIdLoop> CreateStopToVertexId(const transport_proto::Graph& proto_graph) {
+    std::vector<transport_graph::VertexIdLoop> stop_to_vertex_id;
+
+    stop_to_vertex_id.reserve(proto_graph.stop_to_vertex_id_size());
+    for (int i = 0; i < proto_graph.stop_to_vertex_id_size(); ++i) {
+        stop_to_vertex_id.push_back(CreateVertexIdLoop(proto_graph.stop_to_vertex_id(i)));
+    }
+
+    return stop_to_vertex_id;
+}
 
-    std::vector<graph::Edge<TransportTime>> edges;
-    std::vector<graph::DirectedWeightedGraph<TransportTime>::IncidenceList> incidence_lists;
-    std::unordered_map<graph::EdgeId, TransportGraphData> edge_id_to_graph_data;
-    std::unordered_map<const stop_catalogue::Stop*, VertexIdLoop> stop_to_vertex_id;
+transport_graph::TransportGraph CreateGraph(const transport_proto::Graph& proto_graph, const transport_catalogue::TransportCatalogue& catalogue) {
+    GraphParts parts;
 
+    parts.edges.reserve(proto_graph.edge_size());
     for (int i = 0; i < proto_graph.edge_size(); ++i) {
-        edges.push_back(CreateEdge(proto_graph.edge(i)));
+        parts.edges.push_back(CreateEdge(proto_graph.edge(i)));
     }
 
+    parts.incidence_lists.reserve(proto_graph.incidence_list_size());
     for (int i = 0; i < proto_graph.incidence_list_size(); ++i) {
-        incidence_lists.push_back(CreateIncidenceList(proto_graph.incidence_list(i)));
+        parts.incidence_lists.push_back(CreateIncidenceList(proto_graph.incidence_list(i)));
     }
 
-    for (const auto& [proto_edge_id, proto_transport_graph_data] : proto_graph.edge_id_to_graph_data()) {
-        edge_id_to_graph_data.emplace(proto_edge_id, CreateTransportGraphData(proto_transport_graph_data, rh));
+    parts.edges_data.reserve(proto_graph.edge_data_size());
+    for (int i = 0; i < proto_graph.edge_data_size(); ++i) {
+        parts.edges_data.push_back(CreateTransportGraphData(proto_graph.edge_data(i)));
     }
 
-    for (const auto& [proto_stop_id, proto_vertex_id_loop] : proto_graph.stop_to_vertex_id()) {
-        stop_to_vertex_id.emplace(rh.GetStopById(proto_stop_id), CreateVertexIdLoop(proto_vertex_id_loop));
+    parts.stop_to_vertex_id = CreateStopToVertexId(proto_graph);
+
+    return BuildGraph(std::move(parts), catalogue);
+}
+
+transport_graph::TransportRouter CreateRouter(const transport_graph::TransportGraph* ptr_graph, const transport_proto::Router& proto_router) {
+    RoutesInternalData routes_internal_data;
+    routes_internal_data.vertex_count = proto_router.vertex_count();
+
+    const size_t cell_count = routes_internal_data.vertex_count * routes_internal_data.vertex_count;
+    if (static_cast<size_t>(proto_router.weight_size()) != cell_count
+        || static_cast<size_t>(proto_router.prev_edge_size()) != cell_count) {
+        throw std::runtime_error("Router table in the base is damaged");
     }
 
-    TransportGraphDeserialization deserializer;
+    routes_internal_data.cells.resize(cell_count);
+    for (size_t i = 0; i < cell_count; ++i) {
+        routes_internal_data.cells[i] = { proto_router.weight(static_cast<int>(i)), proto_router.prev_edge(static_cast<int>(i)) };
+    }
 
-    deserializer.CreateGraph(std::move(edges), std::move(incidence_lists));
-    deserializer.SetEdgeIdToGraphData(std::move(edge_id_to_graph_data));
-    deserializer.SetStopToVertexId(std::move(stop_to_vertex_id));
+    return BuildRouter(ptr_graph, std::move(routes_internal_data));
+}
 
-    return deserializer.Build();
+void LoadStop(request_handler::RequestHandler& rh, const transport_proto::Stop& proto_stop) {
+    rh.AddStop(proto_stop.id(), CreateStop(proto_stop));
+    if (!proto_stop.road_distances().empty()) {
+        rh.AddEncodedDistances(proto_stop.id(), std::string(proto_stop.road_distances()));
+    }
 }
 
-graph::Router<transport_graph::TransportTime>::RouteInternalData CreateRouteInternalData(const transport_proto::RouteInternalData& proto_data) {
-    graph::Router<transport_graph::TransportTime>::RouteInternalData data;
+void LoadMapRenderSettings(request_handler::RequestHandler& rh, transport_proto::TransportCatalogue& tc) {
+    if (!tc.has_map_render_setting()) {
+        return;
+    }
+
+    rh.SetMapRenderSettings(CreateMapRenderSettings(tc.map_render_setting()));
 
-    data.weight = proto_data.weight();
-    if (proto_data.is_prev_edge()) {
-        data.prev_edge = proto_data.prev_edge_id();
+    // Карта из базы годится, только если она отрисована с теми же настройками для того же каталога
+    if (tc.has_rendered_map() && tc.rendered_map().key() == rh.GetMapCacheKey()) {
+        rh.SetMap(std::move(*tc.mutable_rendered_map()->mutable_svg()));
     }
 
-    return data;
+    if (tc.has_polyline_lod() && tc.polyline_lod().key() == rh.GetMapCacheKey()) {
+        rh.SetPolylineLod(CreatePolylineLod(tc.polyline_lod()));
+    }
 }
 
-transport_graph::TransportRouter CreateRouter(const transport_graph::TransportGraph* ptr_graph, const transport_proto::Router& proto_router) {
-    using namespace graph;
-    using namespace transport_graph;
+// Функция отвергает базу из одного сообщения, записанную до того, как данные рёбер графа
+// и размер таблицы маршрутизатора переехали в новые поля: такую базу нужно пересоздать
+void CheckSingleMessageFormat(const transport_proto::TransportCatalogue& tc) {
+    const bool old_graph = tc.has_graph()
+        && tc.graph().edge_size() != tc.graph().edge_data_size();
+    const bool old_router = tc.has_router()
+        && tc.router().vertex_count() == 0 && tc.has_graph() && tc.graph().incidence_list_size() != 0;
+    if (old_graph || old_router) {
+        throw std::runtime_error("Base file format is too old, rebuild the base with make_base");
+    }
+}
 
-    Router<TransportTime>::RoutesInternalData routes_internal_data;
+// Загрузка базы прежнего формата: одно сообщение TransportCatalogue
+void DeserializeSingleMessage(request_handler::RequestHandler& rh, std::string_view data) {
+    transport_proto::TransportCatalogue tc;
+    tc.ParseFromArray(data.data(), static_cast<int>(data.size()));
+    CheckSingleMessageFormat(tc);
 
-    for (int i = 0; i < proto_router.routes_internal_data().routes_internal_data_vector_size(); ++i) {
-        const auto& proto_data_vector = proto_router.routes_internal_data().routes_internal_data_vector(i);
+    // Общие настройки маршрутов нужны до загрузки автобусов
+    rh.SetRouteSettings(CreateRouteSettings(tc.route_settings()));
 
-        std::vector<std::optional<Router<TransportTime>::RouteInternalData>> routes_internal_data_vector(proto_data_vector.size());
+    for (const transport_proto::Stop& stop : tc.stop()) {
+        LoadStop(rh, stop);
+    }
 
-        for (int j = 0; j < proto_data_vector.route_internal_data_size(); ++j) {
-            const auto& proto_internal_data = proto_data_vector.route_internal_data(j);
+    for (const transport_proto::Bus& bus : tc.bus()) {
+        rh.AddBus(bus.id(), CreateBus(bus, rh));
+    }
 
-            routes_internal_data_vector.at(proto_internal_data.pos()) = CreateRouteInternalData(proto_internal_data);
-        }
+    LoadMapRenderSettings(rh, tc);
 
-        routes_internal_data.emplace_back(std::move(routes_internal_data_vector));
+    if (tc.has_graph()) {
+        rh.SetGraph(CreateGraph(tc.graph(), rh.GetCatalogue()));
     }
 
-    return transport_graph::TransportRouterCreator::Build(
-        *ptr_graph,
-        graph::RouterCreator<transport_graph::TransportTime>::Build(
-            ptr_graph->GetGraph(),
-            std::move(routes_internal_data)
-        )
-    );
+    if (tc.has_router()) {
+        rh.SetRouter(CreateRouter(rh.GetGraph(), tc.router()));
+    }
 }
 
-} // namespace detail_deserialization
+template <typename Message>
+Message* ParseShardMessage(google::protobuf::Arena& arena, const base_container::Shard& shard) {
+    // разобранное сообщение не ссылается на исходные байты, поэтому буфер раскодирования локальный
+    std::string buffer;
+    const std::string_view data = base_container::Unpack(shard, buffer);
 
-// ----------------------------------------------------------------------------
+    auto* message = google::protobuf::Arena::CreateMessage<Message>(&arena);
+    if (!message->ParseFromArray(data.data(), static_cast<int>(data.size()))) {
+        throw std::runtime_error("Base file shard is damaged");
+    }
+    return message;
+}
 
-void Serialize(std::ofstream& out, const request_handler::RequestHandler& rh) {
-    using namespace detail_serialization;
+void CheckShardRange(size_t first, size_t count, size_t size) {
+    if (first > size || count > size - first) {
+        throw std::runtime_error("Base file shard is out of range");
+    }
+}
 
-    transport_proto::TransportCatalogue tc;
+// Функция читает части из заданных мест файла. Части ссылаются на строки buffers
+std::vector<base_container::Shard> ReadShards(std::istream& in, const std::vector<base_container::ShardLocation>& locations, std::vector<std::string>& buffers) {
+    buffers.resize(locations.size());
+
+    std::vector<base_container::Shard> shards;
+    shards.reserve(locations.size());
+    for (size_t i = 0; i < locations.size(); ++i) {
+        shards.push_back(base_container::ReadShard(in, locations[i], buffers[i]));
+    }
+    return shards;
+}
 
-    for (const transport_catalogue::stop_catalogue::Stop* stop : rh.GetStops()) {
-        *tc.add_stop() = CreateProtoStop(stop, rh);
+// Функция параллельно вызывает function(index, shard) для каждой части. Исключение не должно
+// покидать параллельный алгоритм, поэтому ошибки собираются и первая из них бросается после
+template <typename Function>
+void ForEachShardParallel(const std::vector<base_container::Shard>& shards, Function function) {
+    std::vector<std::exception_ptr> errors(shards.size());
+
+    std::vector<size_t> indexes(shards.size());
+    std::iota(indexes.begin(), indexes.end(), size_t{ 0 });
+
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        try {
+            function(index, shards[index]);
+        }
+        catch (...) {
+            errors[index] = std::current_exception();
+        }
+    });
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
+}
 
-    for (const transport_catalogue::bus_catalogue::Bus* bus : rh.GetBuses()) {
-        *tc.add_bus() = CreateProtoBus(bus, rh);
+void LoadGraphEdges(GraphParts& parts, const transport_proto::GraphEdgesShard& shard) {
+    if (shard.edge_size() != shard.edge_data_size()) {
+        throw std::runtime_error("Base file shard is damaged");
     }
+    CheckShardRange(shard.first_edge(), shard.edge_size(), parts.edges.size());
 
-    const auto& map_render_settings = rh.GetMapRenderSettings();
-    if (map_render_settings) {
-        *tc.mutable_map_render_setting() = CreateProtoMapRenderSettings(map_render_settings.value());
+    for (int i = 0; i < shard.edge_size(); ++i) {
+        parts.edges[shard.first_edge() + i] = CreateEdge(shard.edge(i));
+        parts.edges_data[shard.first_edge() + i] = CreateTransportGraphData(shard.edge_data(i));
     }
+}
 
-    *tc.mutable_route_settings() = CreateProtoRouteSetting(rh.GetRouteSettings());
+void LoadGraphIncidence(GraphParts& parts, const transport_proto::GraphIncidenceShard& shard) {
+    CheckShardRange(shard.first_vertex(), shard.incidence_list_size(), parts.incidence_lists.size());
 
-    if (rh.GetGraph()) {
-        *tc.mutable_graph() = CreateProtoGraph(*rh.GetGraph(), rh);
+    for (int i = 0; i < shard.incidence_list_size(); ++i) {
+        const auto& ids = shard.incidence_list(i).id();
+        parts.incidence_lists[shard.first_vertex() + i].assign(ids.begin(), ids.end());
     }
+}
 
-    if (rh.GetRouter()) {
-        *tc.mutable_router() = CreateProtoRouter(*rh.GetRouter());
+void LoadRouterRows(RoutesInternalData& data, const transport_proto::RouterRowsShard& shard) {
+    const size_t vertex_count = data.vertex_count;
+    if (shard.weight_size() != shard.prev_edge_size() || vertex_count == 0
+        || shard.weight_size() % vertex_count != 0) {
+        throw std::runtime_error("Router table in the base is damaged");
     }
+    const size_t first_cell = static_cast<size_t>(shard.first_row()) * vertex_count;
+    CheckShardRange(first_cell, shard.weight_size(), data.cells.size());
 
-    tc.SerializeToOstream(&out);
+    auto cell = data.cells.begin() + first_cell;
+    for (int i = 0; i < shard.weight_size(); ++i, ++cell) {
+        *cell = { shard.weight(i), shard.prev_edge(i) };
+    }
 }
 
-void Deserialize(request_handler::RequestHandler& rh, std::ifstream& in) {
-    using namespace detail_deserialization;
+// Функция возвращает хеш содержимого заголовка базы, по нему вместе с оглавлением
+// проверяется, что файл не перезаписан после загрузки каталога
+uint64_t HashHeader(const base_container::Shard& header) {
+    return transport_catalogue::detail::Fnv1aHasher().Add(header.data).Get();
+}
 
-    transport_proto::TransportCatalogue tc;
-    tc.ParseFromIstream(&in);
+/*
+* Граф и таблица маршрутизатора из базы частей. При загрузке каталога запоминаются только
+* положения их частей, а сами части читаются и разбираются при первом запросе маршрута,
+* поэтому пакет из запросов Stop и Bus не читает таблицу с диска и не держит её в памяти.
+* Источник владеет открытым файлом базы: замена файла переименованием (так пишет make_base)
+* загруженной базе не мешает. Перезапись файла на месте обнаруживается по оглавлению
+* и заголовку, и вместо разбора чужих данных бросается std::runtime_error.
+* Части разбираются параллельно, каждая на своей арене, и копируются сразу на свои места
+* в заранее выделенные массивы
+*/
+class RouterShardsSource : public request_handler::RouterSource {
+public:
+    RouterShardsSource(std::ifstream&& in, std::vector<base_container::ShardLocation> index, uint64_t header_hash,
+        const transport_proto::TransportCatalogue& tc)
+        : in_(std::move(in))
+        , index_(std::move(index))
+        , header_hash_(header_hash)
+        , edge_count_(tc.graph().edge_count())
+        , vertex_count_(tc.graph().vertex_count())
+        , stop_to_vertex_id_(CreateStopToVertexId(tc.graph()))
+        , has_router_(tc.has_router())
+        , router_vertex_count_(tc.router().vertex_count()) {
+    }
+
+    std::unique_ptr<transport_graph::TransportGraph> LoadGraph(const transport_catalogue::TransportCatalogue& catalogue) override {
+        using base_container::ShardKind;
+
+        CheckUnchanged();
+        std::vector<std::string> buffers;
+        const auto shards = ReadShards(in_, SelectLocations({ ShardKind::GRAPH_EDGES, ShardKind::GRAPH_INCIDENCE }), buffers);
+
+        GraphParts parts;
+        parts.edges.resize(edge_count_);
+        parts.edges_data.resize(edge_count_);
+        parts.incidence_lists.resize(vertex_count_);
+        parts.stop_to_vertex_id = std::move(stop_to_vertex_id_);
+
+        ForEachShardParallel(shards, [&parts](size_t, const base_container::Shard& shard) {
+            google::protobuf::Arena arena;
+            if (shard.kind == ShardKind::GRAPH_EDGES) {
+                LoadGraphEdges(parts, *ParseShardMessage<transport_proto::GraphEdgesShard>(arena, shard));
+            }
+            else {
+                LoadGraphIncidence(parts, *ParseShardMessage<transport_proto::GraphIncidenceShard>(arena, shard));
+            }
+        });
 
-    for (int i = 0; i < tc.stop_size(); ++i) {
-        const transport_proto::Stop& stop = tc.stop(i);
-        rh.AddStop(stop.id(), CreateStop(stop));
+        return std::make_unique<transport_graph::TransportGraph>(BuildGraph(std::move(parts), catalogue));
     }
 
-    for (int i = 0; i < tc.bus_size(); ++i) {
-        const transport_proto::Bus& bus = tc.bus(i);
-        rh.AddBus(bus.id(), CreateBus(bus, rh));
+    std::unique_ptr<transport_graph::TransportRouter> LoadRouter(const transport_graph::TransportGraph& graph) override {
+        if (!has_router_) {
+            return nullptr;
+        }
+
+        CheckUnchanged();
+        RoutesInternalData data;
+        data.vertex_count = router_vertex_count_;
+        data.cells.resize(data.vertex_count * data.vertex_count);
+
+        // строки таблицы читаются пачками, чтобы в памяти не было одновременно всех сырых частей
+        const auto locations = SelectLocations({ base_container::ShardKind::ROUTER_ROWS });
+        const size_t batch_size = std::max<size_t>(1, std::thread::hardware_concurrency()) * detail_serialization::SHARDS_PER_THREAD;
+        std::vector<std::string> buffers;
+        for (size_t begin = 0; begin < locations.size(); begin += batch_size) {
+            const std::vector<base_container::ShardLocation> batch(locations.begin() + begin,
+                locations.begin() + std::min(locations.size(), begin + batch_size));
+            ForEachShardParallel(ReadShards(in_, batch, buffers), [&data](size_t, const base_container::Shard& shard) {
+                google::protobuf::Arena arena;
+                LoadRouterRows(data, *ParseShardMessage<transport_proto::RouterRowsShard>(arena, shard));
+            });
+        }
+
+        return std::make_unique<transport_graph::TransportRouter>(BuildRouter(&graph, std::move(data)));
     }
 
-    rh.RenderMap(CreateMapRenderSettings(tc.map_render_setting()));
+private:
+    void CheckUnchanged() {
+        const auto same_location = [](const base_container::ShardLocation& lhs, const base_container::ShardLocation& rhs) {
+            return lhs.kind == rhs.kind && lhs.codec == rhs.codec && lhs.offset == rhs.offset && lhs.size == rhs.size;
+        };
 
-    rh.SetRouteSettings(CreateRouteSettings(tc.route_settings()));
+        bool unchanged = false;
+        try {
+            const std::vector<base_container::ShardLocation> index = base_container::ReadIndex(in_);
+            std::string header_buffer;
+            unchanged = std::equal(index.begin(), index.end(), index_.begin(), index_.end(), same_location)
+                && HashHeader(base_container::ReadShard(in_, index.front(), header_buffer)) == header_hash_;
+        }
+        catch (const std::runtime_error&) {
+            // на месте базы оказались данные, которые не читаются как база
+        }
+        if (!unchanged) {
+            throw std::runtime_error("Base file was overwritten after loading, reload the base");
+        }
+    }
 
-    if (tc.has_graph()) {
-        rh.SetGraph(CreateGraph(tc.graph(), rh));
+    std::vector<base_container::ShardLocation> SelectLocations(std::initializer_list<base_container::ShardKind> kinds) const {
+        std::vector<base_container::ShardLocation> selected;
+        std::copy_if(index_.begin(), index_.end(), std::back_inserter(selected),
+            [kinds](const base_container::ShardLocation& location) {
+                return std::find(kinds.begin(), kinds.end(), location.kind) != kinds.end();
+            });
+        return selected;
+    }
+
+    std::ifstream in_;
+    const std::vector<base_container::ShardLocation> index_;
+    const uint64_t header_hash_;
+    const size_t edge_count_;
+    const size_t vertex_count_;
+    std::vector<transport_graph::VertexIdLoop> stop_to_vertex_id_;
+    const bool has_router_;
+    const size_t router_vertex_count_;
+};
+
+/*
+* Загрузка базы из частей. Сначала читается оглавление, затем заголовок: в нём общие настройки
+* и размеры графа и таблицы маршрутизатора. Части остановок и маршрутов разбираются параллельно,
+* каждая на своей арене, и добавляются в каталог последовательно в порядке записи.
+* Граф и роутер передаются обработчику источником RouterShardsSource вместе с файлом
+*/
+class ShardsLoader {
+public:
+    ShardsLoader(request_handler::RequestHandler& rh, std::ifstream& in)
+        : rh_(rh)
+        , in_(in)
+        , locations_(base_container::ReadIndex(in_)) {
+        if (locations_.empty() || locations_.front().kind != base_container::ShardKind::HEADER) {
+            throw std::runtime_error("Base file has no header shard");
+        }
     }
 
-    if (tc.has_router()) {
-        rh.SetRouter(CreateRouter(rh.GetGraph(), tc.router()));
+    void Load() {
+        using base_container::ShardKind;
+
+        google::protobuf::Arena header_arena;
+        std::string header_buffer;
+        const base_container::Shard header = base_container::ReadShard(in_, locations_.front(), header_buffer);
+        transport_proto::TransportCatalogue& tc = *ParseShardMessage<transport_proto::TransportCatalogue>(header_arena, header);
+
+        // Общие настройки маршрутов нужны до загрузки автобусов
+        rh_.SetRouteSettings(CreateRouteSettings(tc.route_settings()));
+
+        // части графа и роутера выбирает RouterShardsSource, неизвестные этой версии программы пропускаются
+        std::vector<base_container::ShardLocation> catalogue_locations;
+        for (const base_container::ShardLocation& location : locations_) {
+            if (location.kind == ShardKind::STOPS || location.kind == ShardKind::BUSES) {
+                catalogue_locations.push_back(location);
+            }
+        }
+
+        LoadCatalogue(catalogue_locations);
+        LoadMapRenderSettings(rh_, tc);
+
+        if (tc.has_graph()) {
+            rh_.SetRouterSource(std::make_unique<RouterShardsSource>(std::move(in_), locations_, HashHeader(header), tc));
+        }
+    }
+
+private:
+    // Разобранные части остановок и маршрутов ждут последовательного добавления в каталог
+    struct ParsedShard {
+        std::unique_ptr<google::protobuf::Arena> arena;
+        const transport_proto::StopsShard* stops = nullptr;
+        const transport_proto::BusesShard* buses = nullptr;
+    };
+
+    void LoadCatalogue(const std::vector<base_container::ShardLocation>& locations) {
+        std::vector<std::string> buffers;
+        const auto shards = ReadShards(in_, locations, buffers);
+
+        std::vector<ParsedShard> parsed(shards.size());
+        ForEachShardParallel(shards, [&parsed](size_t index, const base_container::Shard& shard) {
+            parsed[index].arena = std::make_unique<google::protobuf::Arena>();
+            if (shard.kind == base_container::ShardKind::STOPS) {
+                parsed[index].stops = ParseShardMessage<transport_proto::StopsShard>(*parsed[index].arena, shard);
+            }
+            else {
+                parsed[index].buses = ParseShardMessage<transport_proto::BusesShard>(*parsed[index].arena, shard);
+            }
+        });
+
+        for (const ParsedShard& shard : parsed) {
+            if (shard.stops) {
+                for (const transport_proto::Stop& stop : shard.stops->stop()) {
+                    LoadStop(rh_, stop);
+                }
+            }
+        }
+
+        for (const ParsedShard& shard : parsed) {
+            if (shard.buses) {
+                for (const transport_proto::Bus& bus : shard.buses->bus()) {
+                    rh_.AddBus(bus.id(), CreateBus(bus, rh_));
+                }
+            }
+        }
+    }
+
+    request_handler::RequestHandler& rh_;
+    std::ifstream& in_;
+    const std::vector<base_container::ShardLocation> locations_;
+};
+
+std::string ReadBase(std::ifstream& in) {
+    in.seekg(0, std::ios::end);
+    const std::streamoff size = in.tellg();
+    in.seekg(0, std::ios::beg);
+
+    if (size < 0) {
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::string data(static_cast<size_t>(size), '\0');
+    in.read(data.data(), size);
+    data.resize(static_cast<size_t>(in.gcount()));
+    return data;
+}
+
+} // namespace detail_deserialization
+
+// ----------------------------------------------------------------------------
+
+void Serialize(std::ofstream& out, const request_handler::RequestHandler& rh, const SerializationSettings& settings) {
+    using namespace detail_serialization;
+    METRICS_SCOPE(metrics::Stage::SERIALIZE);
+
+    // граф и роутер обработчика, загруженного из базы, могут быть ещё не загружены
+    rh.InitRouter();
+
+    ShardsBuilder builder(rh, settings);
+    const std::vector<ShardRange> ranges = builder.GetRanges();
+
+    /*
+    * Части строятся и кодируются параллельно пачками по несколько на поток и пишутся подряд
+    * крупными блоками. Буферы пачки переиспользуются, поэтому память не растёт с размером базы
+    * и не тратится время на первое обращение к свежевыделенным страницам
+    */
+    const size_t batch_size = std::max<size_t>(1, std::thread::hardware_concurrency()) * SHARDS_PER_THREAD;
+    std::vector<std::string> buffers(std::min(batch_size, ranges.size()));
+    std::vector<std::string> compression_buffers(buffers.size());
+
+    base_container::WriteSignature(out);
+    for (size_t begin = 0; begin < ranges.size(); begin += buffers.size()) {
+        const size_t count = std::min(buffers.size(), ranges.size() - begin);
+
+        std::vector<size_t> indexes(count);
+        std::iota(indexes.begin(), indexes.end(), size_t{ 0 });
+        std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+            builder.Build(ranges[begin + index], buffers[index], compression_buffers[index]);
+        });
+
+        for (size_t index = 0; index < count; ++index) {
+            base_container::WriteShard(out, buffers[index]);
+        }
+    }
+}
+
+void Deserialize(request_handler::RequestHandler& rh, std::ifstream&& in) {
+    using namespace detail_deserialization;
+    METRICS_SCOPE(metrics::Stage::DESERIALIZE);
+
+    if (base_container::IsContainer(in)) {
+        ShardsLoader(rh, in).Load();
+    }
+    else {
+        DeserializeSingleMessage(rh, ReadBase(in));
     }
 }
 
@@ -2,12 +2,22 @@
 
 #include <fstream>
 
+#include "base_container.h"
 #include "request_handler.h"
 
 namespace transport_serialization {
 
-void Serialize(std::ofstream& out, const request_handler::RequestHandler& request_handler);
+struct SerializationSettings {
+    // Сохранять в базе отрисованную карту, чтобы не отрисовывать её при каждом запуске
+    bool cache_map = false;
+    // Способ сжатия частей базы
+    base_container::Codec codec = base_container::Codec::NONE;
+};
 
-void Deserialize(request_handler::RequestHandler& request_handler, std::ifstream& in);
+void Serialize(std::ofstream& out, const request_handler::RequestHandler& request_handler, const SerializationSettings& settings = {});
+
+// Функция загружает каталог и настройки из базы. Граф и роутер базы из частей читаются
+// и разбираются при первом запросе маршрута, до тех пор обработчик владеет потоком in
+void Deserialize(request_handler::RequestHandler& request_handler, std::ifstream&& in);
 
 } // namespace transport_serialization
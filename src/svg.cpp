@@ -8,12 +8,31 @@ using namespace std::string_literals;
 // ---------- Point -----------------------------------------------------------
 
 std::string Point::Str() const {
-    std::ostringstream oss;
-    static const std::string comma = std::string(",");
-    oss << x << comma << y;
-    return oss.str();
+    std::string str;
+    AppendNumber(str, x);
+    str += ',';
+    AppendNumber(str, y);
+    return str;
 }
 
+namespace {
+
+//    ,    xml  
+void AppendEscaped(std::string& out, std::string_view data) {
+    for (char c : data) {
+        switch (c) {
+        case '"': out += "&quot;"sv; break;
+        case '\'': out += "&apos;"sv; break;
+        case '<': out += "&lt;"sv; break;
+        case '>': out += "&gt;"sv; break;
+        case '&': out += "&amp;"sv; break;
+        default: out += c; break;
+        }
+    }
+}
+
+} // namespace
+
 // ---------- Object ----------------------------------------------------------
 
 void Object::Render(const RenderContext& context) const {
@@ -22,7 +41,7 @@ void Object::Render(const RenderContext& context) const {
     //     
     RenderObject(context);
 
-    context.out << std::endl;
+    context.out.put('\n');
 }
 
 // ---------- Circle ----------------------------------------------------------
@@ -49,9 +68,11 @@ void Circle::RenderObject(const RenderContext& context) const {
 
 Polyline& Polyline::AddPoint(Point point) {
     if (!points_.empty()) {
-        points_ += " "s;
+        points_ += ' ';
     }
-    points_ += point.Str();
+    AppendNumber(points_, point.x);
+    points_ += ',';
+    AppendNumber(points_, point.y);
     return *this;
 }
 
@@ -90,24 +111,9 @@ Text& Text::SetFontWeight(std::string font_weight) {
 }
 
 Text& Text::SetData(std::string data) {
-    static const std::unordered_map<char, std::string> svg_style = {
-        {'"', "&quot;"s},
-        {'\'', "&apos;"s},
-        {'<', "&lt;"s},
-        {'>', "&gt;"s},
-        {'&', "&amp;"s}
-    };
-
     data_.clear();
     data_.reserve(data.size());
-    for (char c : data) {
-        if (svg_style.count(c)) {
-            data_.append(svg_style.at(c));
-        }
-        else {
-            data_.append(1, c);
-        }
-    }
+    AppendEscaped(data_, data);
 
     return *this;
 }
@@ -137,11 +143,19 @@ void Document::AddPtr(std::unique_ptr<Object>&& obj) {
 void Document::Render(std::ostream& out) const {
     RenderContext render_context(out, 4, 2);
 
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+    RenderBegin(out);
     for (const std::unique_ptr<Object>& object : objects_) {
         object->Render(render_context);
     }
+    RenderEnd(out);
+}
+
+void Document::RenderBegin(std::ostream& out) {
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+}
+
+void Document::RenderEnd(std::ostream& out) {
     out << "</svg>"sv;
 }
 
@@ -149,4 +163,126 @@ const Document::Objects& Document::GetObjects() const {
     return objects_;
 }
 
+// ---------- Style -----------------------------------------------------------
+
+Style& Style::SetOffset(Point offset) {
+    offset_ = std::move(offset);
+    return *this;
+}
+
+Style& Style::SetFontSize(uint32_t size) {
+    size_ = size;
+    return *this;
+}
+
+Style& Style::SetFontFamily(std::string font_family) {
+    font_family_ = std::move(font_family);
+    return *this;
+}
+
+Style& Style::SetFontWeight(std::string font_weight) {
+    font_weight_ = std::move(font_weight);
+    return *this;
+}
+
+// ---------- StyleSheet ------------------------------------------------------
+
+StyleId StyleSheet::Add(const Style& style) {
+    std::ostringstream attrs;
+    style.RenderAttrs(attrs);
+
+    //     Text::RenderObject
+    std::ostringstream text_attrs;
+    text_attrs << " dx=\""sv << style.offset_.x << "\" dy=\""sv << style.offset_.y << "\""sv;
+    text_attrs << " font-size=\""sv << style.size_ << "\""sv;
+    if (style.font_family_) {
+        text_attrs << " font-family=\""sv << *style.font_family_ << "\""sv;
+    }
+    if (style.font_weight_) {
+        text_attrs << " font-weight=\""sv << *style.font_weight_ << "\""sv;
+    }
+
+    styles_.push_back({ style, attrs.str(), text_attrs.str() });
+    return static_cast<StyleId>(styles_.size() - 1);
+}
+
+// ---------- CommandList -----------------------------------------------------
+
+void CommandList::AddCircle(StyleId style, Point center, double radius) {
+    commands_.push_back({ CommandType::CIRCLE, style, 0, 0, center, radius });
+}
+
+void CommandList::StartPolyline(StyleId style) {
+    const uint32_t begin = static_cast<uint32_t>(points_.size());
+    commands_.push_back({ CommandType::POLYLINE, style, begin, begin, {}, 0.0 });
+}
+
+void CommandList::AddPoint(Point point) {
+    points_.push_back(point);
+    commands_.back().end = static_cast<uint32_t>(points_.size());
+}
+
+void CommandList::AddText(StyleId style, Point position, std::string_view data) {
+    const uint32_t begin = static_cast<uint32_t>(chars_.size());
+    AppendEscaped(chars_, data);
+    commands_.push_back({ CommandType::TEXT, style, begin, static_cast<uint32_t>(chars_.size()), position, 0.0 });
+}
+
+void CommandList::Render(const StyleSheet& styles, std::string& out, int indent) const {
+    for (const Command& command : commands_) {
+        const StyleSheet::RenderedStyle& style = styles.styles_[command.style];
+
+        out.append(indent, ' ');
+
+        switch (command.type) {
+        case CommandType::CIRCLE:
+            out += "<circle cx=\""sv;
+            AppendNumber(out, command.point.x);
+            out += "\" cy=\""sv;
+            AppendNumber(out, command.point.y);
+            out += "\" r=\""sv;
+            AppendNumber(out, command.radius);
+            out += '"';
+            out += style.attrs;
+            out += "/>"sv;
+            break;
+        case CommandType::POLYLINE:
+            out += "<polyline points=\""sv;
+            for (uint32_t i = command.begin; i < command.end; ++i) {
+                if (i != command.begin) {
+                    out += ' ';
+                }
+                AppendNumber(out, points_[i].x);
+                out += ',';
+                AppendNumber(out, points_[i].y);
+            }
+            out += '"';
+            out += style.attrs;
+            out += "/>"sv;
+            break;
+        case CommandType::TEXT:
+            out += "<text"sv;
+            out += style.attrs;
+            out += " x=\""sv;
+            AppendNumber(out, command.point.x);
+            out += "\" y=\""sv;
+            AppendNumber(out, command.point.y);
+            out += '"';
+            out += style.text_attrs;
+            out += '>';
+            out.append(chars_, command.begin, command.end - command.begin);
+            out += "</text>"sv;
+            break;
+        }
+
+        out += '\n';
+    }
+}
+
+void CommandList::Clear() {
+    commands_.clear();
+    points_.clear();
+    chars_.clear();
+}
+
 }  // namespace svg
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <charconv>
 #include <cstdint>
 #include <deque>
 #include <iostream>
@@ -12,9 +13,26 @@
 #include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace svg {
 
+// ---------- Number formatting -----------------------------------------------
+
+//      ,     std::ostream  
+//   (%g   6),       
+inline void AppendNumber(std::string& out, double value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    out.append(buffer, result.ptr);
+}
+
+inline void AppendNumber(std::string& out, uint32_t value) {
+    char buffer[16];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
 // ---------- Point -----------------------------------------------------------
 
 struct Point {
@@ -311,6 +329,26 @@ public:
     //     
     Owner& SetStrokeLineJoin(StrokeLineJoin line_join);
 
+    const std::optional<Color>& GetFillColor() const {
+        return fill_color_;
+    }
+
+    const std::optional<Color>& GetStrokeColor() const {
+        return stroke_color_;
+    }
+
+    const std::optional<double>& GetStrokeWidth() const {
+        return stroke_width_;
+    }
+
+    const std::optional<StrokeLineCap>& GetStrokeLineCap() const {
+        return stroke_line_cap_;
+    }
+
+    const std::optional<StrokeLineJoin>& GetStrokeLineJoin() const {
+        return stroke_line_join_;
+    }
+
 protected:
     ~PathProps() = default;
 
@@ -490,12 +528,152 @@ public:
     //   ostream svg- 
     void Render(std::ostream& out) const;
 
+    //   ostream    svg-
+    static void RenderBegin(std::ostream& out);
+    static void RenderEnd(std::ostream& out);
+
     const Objects& GetObjects() const;
 
 private:
     Objects objects_;
 };
 
+// ---------- Style -----------------------------------------------------------
+
+/*
+*  ,     :  
+* ,  ,   .    ,    
+*/
+class Style : public PathProps<Style> {
+public:
+    //       ( dx, dy)
+    Style& SetOffset(Point offset);
+
+    //    ( font-size)
+    Style& SetFontSize(uint32_t size);
+
+    //    ( font-family)
+    Style& SetFontFamily(std::string font_family);
+
+    //    ( font-weight)
+    Style& SetFontWeight(std::string font_weight);
+
+    Point GetOffset() const {
+        return offset_;
+    }
+
+    uint32_t GetFontSize() const {
+        return size_;
+    }
+
+    const std::optional<std::string>& GetFontWeight() const {
+        return font_weight_;
+    }
+
+private:
+    friend class StyleSheet;
+
+    Point offset_;
+    uint32_t size_ = 1;
+    std::optional<std::string> font_family_;
+    std::optional<std::string> font_weight_;
+};
+
+// ---------- StyleSheet ------------------------------------------------------
+
+using StyleId = uint32_t;
+
+/*
+*  .          ,
+*   ,   ,   
+*/
+class StyleSheet {
+public:
+    //      
+    StyleId Add(const Style& style);
+
+    //   
+    const Style& Get(StyleId id) const {
+        return styles_.at(id).style;
+    }
+
+private:
+    friend class CommandList;
+
+    struct RenderedStyle {
+        Style style;
+        //  : fill, stroke, stroke-width  ..
+        std::string attrs;
+        //  ,   : dx, dy, font-size, font-family, font-weight
+        std::string text_attrs;
+    };
+
+    std::vector<RenderedStyle> styles_;
+};
+
+// ---------- CommandList -----------------------------------------------------
+
+enum class CommandType : uint8_t {
+    CIRCLE,
+    POLYLINE,
+    TEXT
+};
+
+/*
+*      :       
+*  ,   -    ,  -   .
+*    ,   Document   Circle, Polyline  Text
+*/
+class CommandList {
+public:
+    struct Command {
+        CommandType type;
+        StyleId style;
+        //     points_     chars_
+        uint32_t begin;
+        uint32_t end;
+        //      
+        Point point;
+        //  
+        double radius;
+    };
+
+    //  
+    void AddCircle(StyleId style, Point center, double radius);
+
+    //   ,    AddPoint
+    void StartPolyline(StyleId style);
+
+    //      
+    void AddPoint(Point point);
+
+    //  ,   
+    void AddText(StyleId style, Point position, std::string_view data);
+
+    //  svg-   ,        indent
+    void Render(const StyleSheet& styles, std::string& out, int indent = 2) const;
+
+    const std::vector<Command>& GetCommands() const {
+        return commands_;
+    }
+
+    const std::vector<Point>& GetPoints() const {
+        return points_;
+    }
+
+    std::string_view GetText(const Command& command) const {
+        return std::string_view(chars_).substr(command.begin, command.end - command.begin);
+    }
+
+    //  ,   
+    void Clear();
+
+private:
+    std::vector<Command> commands_;
+    std::vector<Point> points_;
+    std::string chars_;
+};
+
 // ---------- Drawable --------------------------------------------------------
 
 class Drawable {
@@ -1,9 +1,17 @@
 #include "test_example_functions.h"
 
+#include "dijkstra.h"
+#include "distances_codec.h"
 #include "geo.h"
+#include "graph.h"
 #include "json_reader.h"
+#include "k_shortest_paths.h"
 #include "log_duration.h"
+#include "lz4_codec.h"
+#include "map_renderer.h"
+#include "pareto_search.h"
 #include "request_handler.h"
+#include "router.h"
 
 #include <algorithm>
 #include <chrono>
@@ -11,6 +19,7 @@
 #include <execution>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <optional>
 #include <random>
@@ -91,13 +100,15 @@ void AssertEqualImpl(const T& t, const U& u, const string& t_str, const string&
 
 enum class ErrorCode {
     OUT_OF_RANGE,
-    INVALID_ARGUMENT
+    INVALID_ARGUMENT,
+    RUNTIME_ERROR
 };
 
 const string ErrorCodeName(ErrorCode code) {
     switch(code) {
     case ErrorCode::OUT_OF_RANGE: return "out_of_range"s;
     case ErrorCode::INVALID_ARGUMENT: return "invalid_argument"s;
+    case ErrorCode::RUNTIME_ERROR: return "runtime_error"s;
     default: break;
     }
     ASSERT_HINT(false, "invalid exception"s);
@@ -122,6 +133,9 @@ void AssertTrowImpl(Func& func, ErrorCode code,
     catch(const invalid_argument&) {
         AssertImpl(code == ErrorCode::INVALID_ARGUMENT, ErrorCodeName(code), file, func_name, line, ErrorCodeHint(code));
     }
+    catch(const runtime_error&) {
+        AssertImpl(code == ErrorCode::RUNTIME_ERROR, ErrorCodeName(code), file, func_name, line, ErrorCodeHint(code));
+    }
     catch(...) {
         AssertImpl(false, ErrorCodeName(code), file, func_name, line, ErrorCodeHint(code));
     }
@@ -132,6 +146,8 @@ void AssertTrowImpl(Func& func, ErrorCode code,
 
 #define ASSERT_INVALID_ARGUMENT(a) AssertTrowImpl((a), ErrorCode::INVALID_ARGUMENT, __FILE__, #a, __LINE__)
 
+#define ASSERT_RUNTIME_ERROR(a) AssertTrowImpl((a), ErrorCode::RUNTIME_ERROR, __FILE__, #a, __LINE__)
+
 // -----------------------------------------------------------------------------
 
 template <typename UnitOfTime>
@@ -191,6 +207,739 @@ void TestParseGeoFromStringView() {
     }
 }
 
+void TestCatalogueVersion() {
+    using transport_catalogue::TransportCatalogue;
+    using transport_catalogue::detail::Fnv1aHasher;
+
+    // эталонное значение FNV-1a для строки "a"
+    ASSERT_EQUAL(Fnv1aHasher().Add("a", 1).Get(), 0xaf63dc4c8601ec8cull);
+    // целые любого размера хешируются одинаково, 64 битами little-endian
+    ASSERT_EQUAL(Fnv1aHasher().Add(uint8_t{ 7 }).Get(), Fnv1aHasher().Add(uint64_t{ 7 }).Get());
+    ASSERT_EQUAL(Fnv1aHasher().Add(int32_t{ -7 }).Get(), Fnv1aHasher().Add(int64_t{ -7 }).Get());
+    ASSERT_EQUAL(Fnv1aHasher().Add(1.5f).Get(), Fnv1aHasher().Add(1.5).Get());
+
+    auto get_version = [](const std::vector<std::pair<std::string, Coordinates>>& stops) {
+        TransportCatalogue catalogue;
+        for (const auto& [name, coord] : stops) {
+            catalogue.AddStop(std::string(name), Coordinates(coord));
+        }
+        return catalogue.GetVersion();
+    };
+
+    const std::vector<std::pair<std::string, Coordinates>> stops = {
+        { "A"s, { 55.60, 37.60 } },
+        { "B"s, { 55.61, 37.61 } }
+    };
+    const uint64_t version = get_version(stops);
+    ASSERT_EQUAL(get_version(stops), version);
+    // ключ сохраняется в базе, поэтому не должен меняться между сборками и платформами
+    ASSERT_EQUAL(version, 9485829474448760932ull);
+
+    auto added = stops;
+    added.push_back({ "C"s, { 55.62, 37.62 } });
+    ASSERT(get_version(added) != version);
+
+    auto moved = stops;
+    moved[1].second.lng = 37.62;
+    ASSERT(get_version(moved) != version);
+}
+
+// ----------------------------------------------------------------------------
+
+// Граф для тестов поиска путей:
+// 0 -> 1 (1), 1 -> 2 (1), 0 -> 2 (5), 2 -> 3 (1), 1 -> 3 (4), 3 -> 4 (2)
+graph::DirectedWeightedGraph<double> CreateTestGraph() {
+    graph::DirectedWeightedGraph<double> test_graph(5);
+    test_graph.AddEdge({ 0, 1, 1.0 });
+    test_graph.AddEdge({ 1, 2, 1.0 });
+    test_graph.AddEdge({ 0, 2, 5.0 });
+    test_graph.AddEdge({ 2, 3, 1.0 });
+    test_graph.AddEdge({ 1, 3, 4.0 });
+    test_graph.AddEdge({ 3, 4, 2.0 });
+    return test_graph;
+}
+
+void TestDijkstra() {
+    const auto test_graph = CreateTestGraph();
+    graph::Dijkstra<double> search(test_graph);
+
+    search.Run(0);
+    ASSERT_EQUAL(search.GetWeight(2), 2.0);
+    ASSERT_EQUAL(search.GetWeight(4), 5.0);
+    ASSERT_EQUAL(search.GetPath(4), std::vector<graph::EdgeId>({ 0, 1, 3, 5 }));
+    ASSERT_EQUAL(search.GetPath(0), std::vector<graph::EdgeId>());
+
+    // вершины прошлого поиска не считаются достигнутыми в следующем
+    search.Run(2);
+    ASSERT(!search.IsReached(0));
+    ASSERT(!search.IsReached(1));
+    ASSERT_EQUAL(search.GetWeight(4), 3.0);
+    ASSERT_EQUAL(search.GetPath(4), std::vector<graph::EdgeId>({ 3, 5 }));
+
+    ASSERT(!search.RunTo(4, 0));
+    ASSERT(search.RunTo(0, 3));
+    ASSERT_EQUAL(search.GetWeight(3), 3.0);
+    ASSERT(!search.IsSettled(4));
+
+    search.BlockEdge(1);
+    ASSERT(search.RunTo(0, 4));
+    ASSERT_EQUAL(search.GetWeight(4), 7.0);
+    ASSERT_EQUAL(search.GetPath(4), std::vector<graph::EdgeId>({ 0, 4, 5 }));
+
+    search.BlockVertex(1);
+    ASSERT(search.RunTo(0, 4));
+    ASSERT_EQUAL(search.GetWeight(4), 8.0);
+    ASSERT_EQUAL(search.GetPath(4), std::vector<graph::EdgeId>({ 2, 3, 5 }));
+
+    search.ClearBlocked();
+    ASSERT(search.RunTo(0, 4));
+    ASSERT_EQUAL(search.GetWeight(4), 5.0);
+}
+
+// Последовательный алгоритм Флойда-Уоршелла с тем же выбором рёбер, что у Router
+std::pair<std::vector<double>, std::vector<uint32_t>> BuildSequentialRoutes(const graph::DirectedWeightedGraph<double>& test_graph) {
+    using Router = graph::Router<double>;
+    const size_t vertex_count = test_graph.GetVertexCount();
+    std::vector<double> weights(vertex_count * vertex_count, std::numeric_limits<double>::infinity());
+    std::vector<uint32_t> prev_edges(vertex_count * vertex_count, Router::NO_ROUTE);
+
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        weights[vertex * vertex_count + vertex] = 0.0;
+        prev_edges[vertex * vertex_count + vertex] = Router::NO_EDGE;
+        for (const graph::EdgeId edge_id : test_graph.GetIncidentEdges(vertex)) {
+            const auto& edge = test_graph.GetEdge(edge_id);
+            const size_t index = vertex * vertex_count + edge.to;
+            if (prev_edges[index] == Router::NO_ROUTE || weights[index] > edge.weight) {
+                weights[index] = edge.weight;
+                prev_edges[index] = static_cast<uint32_t>(edge_id);
+            }
+        }
+    }
+
+    for (size_t through = 0; through < vertex_count; ++through) {
+        for (size_t from = 0; from < vertex_count; ++from) {
+            for (size_t to = 0; to < vertex_count; ++to) {
+                const double candidate = weights[from * vertex_count + through] + weights[through * vertex_count + to];
+                if (candidate < weights[from * vertex_count + to]) {
+                    weights[from * vertex_count + to] = candidate;
+                    prev_edges[from * vertex_count + to] = prev_edges[through * vertex_count + to];
+                }
+            }
+        }
+    }
+
+    return { std::move(weights), std::move(prev_edges) };
+}
+
+void TestBlockedFloydWarshall() {
+    using Router = graph::Router<double>;
+    std::mt19937 generator(42);
+
+    // 1, 63, 65 и 130 вершин - неполные блоки TILE_SIZE = 64; целые веса из короткого
+    // диапазона и параллельные рёбра дают много путей равного веса
+    const std::vector<size_t> vertex_counts = { 1, 2, 63, 64, 65, 130 };
+    for (const size_t vertex_count : vertex_counts) {
+        for (const bool integer_weights : { true, false }) {
+            for (const size_t edges_per_vertex : { 1, 3, 8 }) {
+                graph::DirectedWeightedGraph<double> test_graph(vertex_count);
+                std::uniform_int_distribution<size_t> vertex_distribution(0, vertex_count - 1);
+                std::uniform_int_distribution<int> integer_distribution(0, 3);
+                std::uniform_real_distribution<double> real_distribution(0.0, 10.0);
+                for (size_t i = 0; i < vertex_count * edges_per_vertex; ++i) {
+                    const double weight = integer_weights ? integer_distribution(generator) : real_distribution(generator);
+                    test_graph.AddEdge({ vertex_distribution(generator), vertex_distribution(generator), weight });
+                }
+
+                const Router router(test_graph);
+                const auto& routes = graph::RouterDataGetter<double>::GetInternalData(router);
+                const auto [weights, prev_edges] = BuildSequentialRoutes(test_graph);
+
+                ASSERT_EQUAL(routes.vertex_count, vertex_count);
+                for (size_t index = 0; index < weights.size(); ++index) {
+                    const std::string hint = "vertex_count = "s + std::to_string(vertex_count)
+                        + ", cell = "s + std::to_string(index);
+                    ASSERT_EQUAL_HINT(routes.cells[index].prev_edge, prev_edges[index], hint);
+                    ASSERT_EQUAL_HINT(routes.cells[index].weight, static_cast<float>(weights[index]), hint);
+                }
+            }
+        }
+    }
+}
+
+void TestKShortestPaths() {
+    const auto test_graph = CreateTestGraph();
+    const std::vector<std::pair<double, std::vector<graph::EdgeId>>> expected = {
+        { 5.0, { 0, 1, 3, 5 } },
+        { 7.0, { 0, 4, 5 } },
+        { 8.0, { 2, 3, 5 } }
+    };
+
+    {
+        graph::KShortestPaths<double> paths(test_graph, 0, 4);
+        for (const auto& [weight, edges] : expected) {
+            const auto path = paths.Next();
+            ASSERT(path.has_value());
+            ASSERT_EQUAL(path->weight, weight);
+            ASSERT_EQUAL(path->edges, edges);
+        }
+        ASSERT(!paths.Next().has_value());
+    }
+    {
+        // известный кратчайший путь возвращается первым без поиска
+        graph::KShortestPaths<double> paths(test_graph, 0, 4, expected.front().second);
+        for (const auto& [weight, edges] : expected) {
+            const auto path = paths.Next();
+            ASSERT(path.has_value());
+            ASSERT_EQUAL(path->weight, weight);
+            ASSERT_EQUAL(path->edges, edges);
+        }
+        ASSERT(!paths.Next().has_value());
+    }
+    {
+        graph::KShortestPaths<double> paths(test_graph, 4, 0);
+        ASSERT(!paths.Next().has_value());
+    }
+    {
+        // поиск ответвлений ограничен весом, путь тяжелее max_weight не находится
+        graph::Dijkstra<double> search(test_graph);
+        ASSERT(!search.RunTo(0, 4, 4.5));
+        ASSERT(search.RunTo(0, 4, 5.0));
+        ASSERT_EQUAL(search.GetPath(4), expected.front().second);
+    }
+    {
+        graph::KShortestPaths<double> paths(test_graph, 0, 4, 2);
+        ASSERT_EQUAL(paths.Next()->edges, expected[0].second);
+        ASSERT_EQUAL(paths.Next()->edges, expected[1].second);
+        ASSERT(!paths.Next().has_value());
+    }
+
+    // с ограничением количества путей выдаются те же пути, что и без него
+    std::mt19937 generator(7);
+    for (int graph_index = 0; graph_index < 20; ++graph_index) {
+        constexpr size_t vertex_count = 40;
+        graph::DirectedWeightedGraph<double> random_graph(vertex_count);
+        std::uniform_int_distribution<size_t> vertex_distribution(0, vertex_count - 1);
+        // целые веса дают много путей равного веса
+        std::uniform_int_distribution<int> weight_distribution(1, 4);
+        for (size_t i = 0; i < vertex_count * 4; ++i) {
+            random_graph.AddEdge({ vertex_distribution(generator), vertex_distribution(generator),
+                static_cast<double>(weight_distribution(generator)) });
+        }
+
+        const graph::VertexId from = vertex_distribution(generator);
+        const graph::VertexId to = vertex_distribution(generator);
+        for (const size_t max_paths : { 1, 3, 12 }) {
+            graph::KShortestPaths<double> unlimited(random_graph, from, to);
+            graph::KShortestPaths<double> limited(random_graph, from, to, max_paths);
+            for (size_t i = 0; i < max_paths; ++i) {
+                const auto expected_path = unlimited.Next();
+                const auto path = limited.Next();
+                ASSERT_EQUAL(path.has_value(), expected_path.has_value());
+                if (!path) {
+                    break;
+                }
+                ASSERT_EQUAL(path->weight, expected_path->weight);
+                ASSERT_EQUAL(path->edges, expected_path->edges);
+            }
+            ASSERT(!limited.Next().has_value());
+        }
+    }
+}
+
+void TestParetoSearch() {
+    const auto test_graph = CreateTestGraph();
+    // отмечены рёбра 1 -> 2, 2 -> 3 и 1 -> 3: путь 0-1-2-3-4 самый быстрый, но с двумя отметками,
+    // 0-1-3-4 медленнее с одной, а 0-2-3-4 с одной отметкой ещё медленнее и в фронт не входит
+    auto is_counted = [](graph::EdgeId edge_id) {
+        return edge_id == 1 || edge_id == 3 || edge_id == 4;
+    };
+
+    graph::ParetoSearch<double> search(test_graph, 2);
+    // объект переиспользуется, повторный поиск даёт тот же результат
+    for (int run = 0; run < 2; ++run) {
+        const auto front = search.Run(0, 4, is_counted);
+        ASSERT_EQUAL(front.size(), 2u);
+        ASSERT_EQUAL(front[0].weight, 5.0);
+        ASSERT_EQUAL(front[0].count, 2u);
+        ASSERT_EQUAL(front[0].edges, std::vector<graph::EdgeId>({ 0, 1, 3, 5 }));
+        ASSERT_EQUAL(front[1].weight, 7.0);
+        ASSERT_EQUAL(front[1].count, 1u);
+        ASSERT_EQUAL(front[1].edges, std::vector<graph::EdgeId>({ 0, 4, 5 }));
+    }
+
+    {
+        graph::ParetoSearch<double> limited(test_graph, 1);
+        const auto front = limited.Run(0, 4, is_counted);
+        ASSERT_EQUAL(front.size(), 1u);
+        ASSERT_EQUAL(front[0].weight, 7.0);
+        ASSERT_EQUAL(front[0].edges, std::vector<graph::EdgeId>({ 0, 4, 5 }));
+    }
+    {
+        graph::ParetoSearch<double> limited(test_graph, 0);
+        ASSERT(limited.Run(0, 4, is_counted).empty());
+    }
+    {
+        // один объект для разных ограничений и графов, как в потоке обработки запросов
+        graph::ParetoSearch<double> reused;
+        reused.Prepare(test_graph, 0);
+        ASSERT(reused.Run(0, 4, is_counted).empty());
+        reused.Prepare(test_graph, 2);
+        ASSERT_EQUAL(reused.Run(0, 4, is_counted).size(), 2u);
+        reused.Prepare(test_graph, 1);
+        const auto front = reused.Run(0, 4, is_counted);
+        ASSERT_EQUAL(front.size(), 1u);
+        ASSERT_EQUAL(front[0].weight, 7.0);
+
+        graph::DirectedWeightedGraph<double> bigger_graph(7);
+        bigger_graph.AddEdge({ 5, 6, 3.0 });
+        reused.Prepare(bigger_graph, 1);
+        const auto bigger_front = reused.Run(5, 6, is_counted);
+        ASSERT_EQUAL(bigger_front.size(), 1u);
+        ASSERT_EQUAL(bigger_front[0].weight, 3.0);
+        ASSERT_EQUAL(bigger_front[0].edges, std::vector<graph::EdgeId>({ 0 }));
+        ASSERT(reused.Run(0, 6, is_counted).empty());
+
+        reused.Prepare(test_graph, 2);
+        ASSERT_EQUAL(reused.Run(0, 4, is_counted).size(), 2u);
+    }
+
+    ASSERT(search.Run(4, 0, is_counted).empty());
+}
+
+// ----------------------------------------------------------------------------
+
+void TestDistancesCodec() {
+    using distances_codec::Neighbour;
+
+    {
+        ASSERT(distances_codec::Decode(distances_codec::Encode({})).empty());
+    }
+    {
+        // соседи раскодируются по возрастанию номера, расстояния не теряют точности
+        const std::vector<Neighbour> neighbours = {
+            { 1000000, 0.0 }, { 7, 1500.0 }, { 3, 12.25 }, { 4000000000u, 1099511627776.0 }, { 8, -3.0 }
+        };
+        const std::vector<Neighbour> decoded = distances_codec::Decode(distances_codec::Encode(neighbours));
+
+        const std::vector<uint32_t> expected_ids = { 3, 7, 8, 1000000, 4000000000u };
+        const std::vector<double> expected_distances = { 12.25, 1500.0, -3.0, 0.0, 1099511627776.0 };
+        ASSERT_EQUAL(decoded.size(), expected_ids.size());
+        for (size_t i = 0; i < decoded.size(); ++i) {
+            ASSERT_EQUAL(decoded[i].id, expected_ids[i]);
+            ASSERT_EQUAL(decoded[i].distance, expected_distances[i]);
+        }
+    }
+    {
+        // целое расстояние занимает varint, дробное - флаг и восемь байт
+        ASSERT_EQUAL(distances_codec::Encode({ { 1, 100.0 } }).size(), 4u);
+        ASSERT_EQUAL(distances_codec::Encode({ { 1, 100.5 } }).size(), 11u);
+    }
+    {
+        // дробное расстояние записано битами double в порядке little-endian: 0.5 = 0x3FE0000000000000
+        const std::string expected = { '\x01', '\x01', '\x01', '\0', '\0', '\0', '\0', '\0', '\0', '\xE0', '\x3F' };
+        ASSERT_EQUAL(distances_codec::Encode({ { 1, 0.5 } }), expected);
+    }
+
+    const std::string data = distances_codec::Encode({ { 1, 100.0 }, { 2, 0.5 } });
+    auto truncated = [&data]() {
+        distances_codec::Decode(std::string_view(data).substr(0, data.size() - 1));
+    };
+    ASSERT_RUNTIME_ERROR(truncated);
+    auto trailing = [&data]() {
+        distances_codec::Decode(data + '\0');
+    };
+    ASSERT_RUNTIME_ERROR(trailing);
+    auto invalid_varint = []() {
+        distances_codec::Decode(std::string(11, '\xFF'));
+    };
+    ASSERT_RUNTIME_ERROR(invalid_varint);
+}
+
+// ----------------------------------------------------------------------------
+
+std::string FromHex(std::string_view hex) {
+    std::string bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes.push_back(static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16)));
+    }
+    return bytes;
+}
+
+void TestLz4CodecRoundTrip() {
+    std::mt19937 generator(42);
+
+    std::string incompressible(100000, '\0');
+    for (char& c : incompressible) {
+        c = static_cast<char>(uniform_int_distribution<int>(0, 255)(generator));
+    }
+
+    // больше одного блока в 4 МБ
+    std::string large;
+    for (int i = 0; large.size() < 5 * 1024 * 1024 + 17; ++i) {
+        large += "stop_"s + std::to_string(i % 1000) + ":"s + std::to_string(i) + ";"s;
+    }
+
+    // совпадения, перекрывающие сами себя: смещение меньше длины
+    const std::string overlapping = "x"s + std::string(100000, 'a') + "abcabcabcabcabcabcabcabcabcabc"s + std::string(30, 'b');
+
+    const std::vector<std::string> inputs = { ""s, "a"s, "hello"s, incompressible, large, overlapping };
+    for (const std::string& input : inputs) {
+        const std::string frame = lz4_codec::CompressFrame(input);
+        ASSERT(lz4_codec::IsFrame(frame));
+
+        std::string output = "garbage"s;
+        lz4_codec::DecompressFrame(frame, output);
+        ASSERT_EQUAL_HINT(output.size(), input.size(), "input size "s + std::to_string(input.size()));
+        ASSERT(output == input);
+    }
+
+    ASSERT(lz4_codec::CompressFrame(large).size() < large.size() / 2);
+    ASSERT(lz4_codec::CompressFrame(overlapping).size() < 1000);
+    ASSERT(!lz4_codec::IsFrame("hello"s));
+}
+
+void TestLz4CodecDamagedFrames() {
+    const std::string frame = lz4_codec::CompressFrame("hello hello hello hello hello"s);
+    std::string output;
+
+    auto truncated = [&]() {
+        lz4_codec::DecompressFrame(std::string_view(frame).substr(0, frame.size() - 1), output);
+    };
+    ASSERT_RUNTIME_ERROR(truncated);
+    auto header_only = [&]() {
+        lz4_codec::DecompressFrame(std::string_view(frame).substr(0, 6), output);
+    };
+    ASSERT_RUNTIME_ERROR(header_only);
+    auto no_signature = [&]() {
+        std::string damaged = frame;
+        damaged[0] ^= 1;
+        lz4_codec::DecompressFrame(damaged, output);
+    };
+    ASSERT_RUNTIME_ERROR(no_signature);
+    auto header_checksum = [&]() {
+        std::string damaged = frame;
+        damaged[6] ^= 1;
+        lz4_codec::DecompressFrame(damaged, output);
+    };
+    ASSERT_RUNTIME_ERROR(header_checksum);
+
+    // Кадр утилиты lz4 с размером данных и контрольными суммами блока и содержимого
+    const std::string checked = FromHex(
+        "04224d187c401d000000000000008e0f0000006e68656c6c6f2006005068656c6c6f98f6dc6d0000000079b1fff9"sv);
+    lz4_codec::DecompressFrame(checked, output);
+    ASSERT_EQUAL(output, "hello hello hello hello hello"s);
+
+    auto block_checksum = [&]() {
+        std::string damaged = checked;
+        damaged[34] ^= 1;
+        lz4_codec::DecompressFrame(damaged, output);
+    };
+    ASSERT_RUNTIME_ERROR(block_checksum);
+    auto content_checksum = [&]() {
+        std::string damaged = checked;
+        damaged.back() ^= 1;
+        lz4_codec::DecompressFrame(damaged, output);
+    };
+    ASSERT_RUNTIME_ERROR(content_checksum);
+    auto content_size = [&]() {
+        // размер данных увеличен на 1, контрольная сумма заголовка пересчитана
+        lz4_codec::DecompressFrame(FromHex(
+            "04224d187c401e000000000000007b0f0000006e68656c6c6f2006005068656c6c6f98f6dc6d0000000079b1fff9"sv), output);
+    };
+    ASSERT_RUNTIME_ERROR(content_size);
+}
+
+// ----------------------------------------------------------------------------
+
+void TestClipSegment() {
+    using map_renderer::ClipSegment;
+    using svg::Point;
+
+    const Point min(0.0, 0.0);
+    const Point max(10.0, 10.0);
+
+    auto assert_clipped = [&](Point from, Point to, Point expected_from, Point expected_to) {
+        const auto clipped = ClipSegment(from, to, min, max);
+        ASSERT(clipped.has_value());
+        ASSERT(clipped->first == expected_from);
+        ASSERT(clipped->second == expected_to);
+    };
+
+    assert_clipped({ 1.0, 1.0 }, { 5.0, 5.0 }, { 1.0, 1.0 }, { 5.0, 5.0 });
+    assert_clipped({ -5.0, 5.0 }, { 15.0, 5.0 }, { 0.0, 5.0 }, { 10.0, 5.0 });
+    assert_clipped({ 15.0, 5.0 }, { -5.0, 5.0 }, { 10.0, 5.0 }, { 0.0, 5.0 });
+    assert_clipped({ -5.0, -5.0 }, { 5.0, 5.0 }, { 0.0, 0.0 }, { 5.0, 5.0 });
+    assert_clipped({ 5.0, 20.0 }, { 5.0, -20.0 }, { 5.0, 10.0 }, { 5.0, 0.0 });
+    assert_clipped({ 0.0, -5.0 }, { 0.0, 5.0 }, { 0.0, 0.0 }, { 0.0, 5.0 });
+    assert_clipped({ 3.0, 3.0 }, { 3.0, 3.0 }, { 3.0, 3.0 }, { 3.0, 3.0 });
+
+    ASSERT(!ClipSegment({ 11.0, 0.0 }, { 20.0, 20.0 }, min, max).has_value());
+    // отрезок проходит мимо угла: проекции на обе оси пересекают область, сам отрезок - нет
+    ASSERT(!ClipSegment({ -5.0, 8.0 }, { 8.0, 21.0 }, min, max).has_value());
+    ASSERT(!ClipSegment({ 12.0, 12.0 }, { 12.0, 12.0 }, min, max).has_value());
+}
+
+void TestSimplifyPolyline() {
+    using map_renderer::SimplifyPolyline;
+    using svg::Point;
+
+    ASSERT(SimplifyPolyline({}, 1.0).empty());
+    ASSERT_EQUAL(SimplifyPolyline({ { 1.0, 1.0 } }, 1.0), std::vector<uint32_t>({ 0 }));
+    ASSERT_EQUAL(SimplifyPolyline({ { 1.0, 1.0 }, { 2.0, 2.0 } }, 1.0), std::vector<uint32_t>({ 0, 1 }));
+
+    const std::vector<Point> straight = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 2.0, 0.0 }, { 3.0, 0.0 } };
+    ASSERT_EQUAL(SimplifyPolyline(straight, 0.1), std::vector<uint32_t>({ 0, 3 }));
+
+    const std::vector<Point> noisy = { { 0.0, 0.0 }, { 1.0, 0.05 }, { 2.0, -0.05 }, { 3.0, 0.0 } };
+    ASSERT_EQUAL(SimplifyPolyline(noisy, 0.1), std::vector<uint32_t>({ 0, 3 }));
+    ASSERT_EQUAL(SimplifyPolyline(noisy, 0.01), std::vector<uint32_t>({ 0, 1, 2, 3 }));
+
+    const std::vector<Point> zigzag = { { 0.0, 0.0 }, { 1.0, 5.0 }, { 2.0, 0.0 }, { 3.0, 5.0 }, { 4.0, 0.0 } };
+    ASSERT_EQUAL(SimplifyPolyline(zigzag, 1.0), std::vector<uint32_t>({ 0, 1, 2, 3, 4 }));
+
+    const std::vector<Point> peak = { { 0.0, 0.0 }, { 1.0, 0.1 }, { 2.0, 5.0 }, { 3.0, 0.1 }, { 4.0, 0.0 } };
+    ASSERT_EQUAL(SimplifyPolyline(peak, 1.0), std::vector<uint32_t>({ 0, 2, 4 }));
+
+    // кольцевой маршрут: первая и последняя вершины совпадают
+    const std::vector<Point> ring = { { 0.0, 0.0 }, { 10.0, 0.0 }, { 10.0, 10.0 }, { 0.0, 10.0 }, { 0.0, 0.0 } };
+    ASSERT_EQUAL(SimplifyPolyline(ring, 1.0), std::vector<uint32_t>({ 0, 1, 2, 3, 4 }));
+}
+
+// ----------------------------------------------------------------------------
+
+// Функция создаёт базу из трёх остановок A, B, C по 1000 м и автобуса 1 между ними.
+// Маршрут от A до C занимает bus_wait_time + 2000 м / bus_velocity
+void MakeTestBase(const std::string& file_name, int bus_velocity) {
+    std::stringstream in;
+    in << "{ \"serialization_settings\": { \"file\": \""s << file_name << "\" },"s
+       << " \"routing_settings\": { \"bus_wait_time\": 2, \"bus_velocity\": "s << bus_velocity << " },"s
+       << " \"base_requests\": ["s
+       << " { \"type\": \"Stop\", \"name\": \"A\", \"latitude\": 55.60, \"longitude\": 37.60, \"road_distances\": { \"B\": 1000 } },"s
+       << " { \"type\": \"Stop\", \"name\": \"B\", \"latitude\": 55.61, \"longitude\": 37.61, \"road_distances\": { \"C\": 1000 } },"s
+       << " { \"type\": \"Stop\", \"name\": \"C\", \"latitude\": 55.62, \"longitude\": 37.62, \"road_distances\": {} },"s
+       << " { \"type\": \"Bus\", \"name\": \"1\", \"stops\": [\"A\", \"B\", \"C\"], \"is_roundtrip\": false } ] }"s;
+    std::stringstream out;
+    request_handler::RequestHandlerProcess(in, out).ExecuteMakeBaseRequests();
+}
+
+std::string ReadWholeFile(const std::string& file_name) {
+    std::ifstream in(file_name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void TestLazyRouterLoading() {
+    const std::string file_name = (std::filesystem::temp_directory_path() / "transport_catalogue_lazy_router.db"s).string();
+    const std::string other_file_name = file_name + ".other"s;
+
+    {
+        MakeTestBase(file_name, 30);
+        const auto snapshot = request_handler::BaseSnapshot::Load(file_name);
+        const request_handler::RequestHandler& handler = snapshot->GetHandler();
+        ASSERT(handler.GetBus("1"sv).has_value());
+
+        // make_base заменяет файл переименованием, загруженная база читает роутер из прежнего файла
+        MakeTestBase(file_name, 60);
+        const auto route = handler.GetRoute("A"sv, "C"sv);
+        ASSERT(route.has_value());
+        ASSERT(std::abs(route->time - 6.0) < 1e-6);
+    }
+    {
+        MakeTestBase(file_name, 30);
+        MakeTestBase(other_file_name, 60);
+        const auto snapshot = request_handler::BaseSnapshot::Load(file_name);
+        const request_handler::RequestHandler& handler = snapshot->GetHandler();
+        ASSERT(handler.GetBus("1"sv).has_value());
+
+        // Запрос автобуса не читает части графа и роутера: после перезаписи файла на месте
+        // они читаются только при первом запросе маршрута, и подмена обнаруживается
+        {
+            const std::string other = ReadWholeFile(other_file_name);
+            std::ofstream out(file_name, std::ios::binary | std::ios::in | std::ios::out);
+            out.write(other.data(), static_cast<std::streamsize>(other.size()));
+        }
+        auto route_after_overwrite = [&handler]() {
+            handler.GetRoute("A"sv, "C"sv);
+        };
+        ASSERT_RUNTIME_ERROR(route_after_overwrite);
+    }
+
+    std::filesystem::remove(file_name);
+    std::filesystem::remove(other_file_name);
+}
+
+void TestStreamReloadBase() {
+    const std::string file_name = (std::filesystem::temp_directory_path() / "transport_catalogue_stream.db"s).string();
+    const std::string other_file_name = file_name + ".other"s;
+    const std::string missing_file_name = file_name + ".missing"s;
+    MakeTestBase(file_name, 30);
+    MakeTestBase(other_file_name, 60);
+    std::filesystem::remove(missing_file_name);
+
+    std::stringstream input;
+    input << "{\"serialization_settings\": {\"file\": \""s << file_name << "\"}}\n"s
+          << "{\"id\": 1, \"type\": \"Bus\", \"name\": \"1\"}\n"s
+          << "{\"id\": 2, \"type\": \"ReloadBase\", \"file\": \""s << missing_file_name << "\"}\n"s
+          << "{\"id\": 3, \"type\": \"Stop\", \"name\": \"A\"}\n"s
+          << "{\"id\": 4, \"type\": \"ReloadBase\", \"file\": \""s << other_file_name << "\"}\n"s
+          << "{\"id\": 5, \"type\": \"Bus\", \"name\": \"1\"}\n"s
+          << "{\"id\": 6, \"type\": \"Stop\", \"name\": \"B\"}\n"s;
+    std::stringstream output;
+    request_handler::RequestStreamProcess(input, output).Execute();
+
+    // Ответы и подтверждения ReloadBase идут в порядке строк входа,
+    // ошибка фоновой загрузки - отдельной строкой в любом месте
+    std::vector<int> answered;
+    std::vector<int> failed;
+    for (std::string line; std::getline(output, line);) {
+        std::istringstream line_input(line);
+        const json::Dict response = json::Load(line_input).GetRoot().AsMap();
+        const int request_id = response.at("request_id"s).AsInt();
+        if (response.count("error_message"s) > 0) {
+            ASSERT_HINT(response.at("error_message"s).AsString().find("Couldn't open base file"s) != std::string::npos, line);
+            failed.push_back(request_id);
+            continue;
+        }
+        if (request_id == 2 || request_id == 4) {
+            ASSERT_EQUAL_HINT(response.size(), 1u, line);
+        }
+        else {
+            // у ответа Stop - buses и request_id, у ответа Bus ещё четыре ключа
+            const bool is_stop = request_id == 3 || request_id == 6;
+            ASSERT_EQUAL_HINT(response.size(), is_stop ? 2u : 5u, line);
+        }
+        answered.push_back(request_id);
+    }
+    ASSERT_EQUAL(answered, std::vector<int>({ 1, 2, 3, 4, 5, 6 }));
+    ASSERT_EQUAL(failed, std::vector<int>({ 2 }));
+
+    std::filesystem::remove(file_name);
+    std::filesystem::remove(other_file_name);
+}
+
+// Функция создаёт базу из 70 остановок: два маршрута туда и обратно, кольцевой маршрут
+// и две остановки без маршрутов, поэтому в таблице роутера есть и недостижимые пары
+void MakeTestNetworkBase(const std::string& file_name) {
+    constexpr int stop_count = 70;
+    std::stringstream in;
+    in << "{ \"serialization_settings\": { \"file\": \""s << file_name << "\" },"s
+       << " \"routing_settings\": { \"bus_wait_time\": 3, \"bus_velocity\": 37 },"s
+       << " \"base_requests\": ["s;
+    for (int i = 0; i < stop_count; ++i) {
+        in << " { \"type\": \"Stop\", \"name\": \"S"s << i << "\", \"latitude\": "s << 55.5 + i * 0.003
+           << ", \"longitude\": "s << 37.5 + (i % 7) * 0.002 << ", \"road_distances\": {"s;
+        if (i + 1 < stop_count) {
+            in << " \"S"s << i + 1 << "\": "s << 700 + (i * 37) % 500;
+        }
+        // замыкающий перегон кольцевого маршрута
+        if (i == 67) {
+            in << ", \"S55\": 2500"s;
+        }
+        in << " } },"s;
+    }
+
+    auto add_bus = [&in](const std::string& name, int first, int last, bool is_roundtrip) {
+        in << " { \"type\": \"Bus\", \"name\": \""s << name << "\", \"stops\": ["s;
+        for (int i = first; i <= last; ++i) {
+            in << (i == first ? ""s : ", "s) << "\"S"s << i << "\""s;
+        }
+        if (is_roundtrip) {
+            in << ", \"S"s << first << "\""s;
+        }
+        in << "], \"is_roundtrip\": "s << (is_roundtrip ? "true"s : "false"s) << " }"s;
+    };
+    add_bus("1"s, 0, 29, false);
+    in << ","s;
+    add_bus("2"s, 20, 59, false);
+    in << ","s;
+    add_bus("3"s, 55, 67, true);
+    in << " ] }"s;
+
+    std::stringstream out;
+    request_handler::RequestHandlerProcess(in, out).ExecuteMakeBaseRequests();
+}
+
+void TestRouterTable() {
+    using Router = graph::Router<double>;
+    {
+        // пустой путь из вершины в неё же и отсутствие пути хранятся метками вместо рёбер
+        const auto test_graph = CreateTestGraph();
+        const Router router(test_graph);
+        const auto& routes = graph::RouterDataGetter<double>::GetInternalData(router);
+        ASSERT_EQUAL(routes.At(2, 2).prev_edge, Router::NO_EDGE);
+        ASSERT_EQUAL(routes.At(2, 2).weight, 0.0f);
+        ASSERT_EQUAL(routes.At(4, 0).prev_edge, Router::NO_ROUTE);
+        ASSERT_EQUAL(routes.At(4, 0).weight, std::numeric_limits<float>::infinity());
+
+        const auto empty_route = router.BuildRoute(2, 2);
+        ASSERT(empty_route.has_value());
+        ASSERT_EQUAL(empty_route->weight, 0.0);
+        ASSERT(empty_route->edges.empty());
+        ASSERT(!router.BuildRoute(4, 0).has_value());
+    }
+    {
+        // Пути различаются по весу меньше точности float. Таблица хранит вес во float, но путь
+        // выбирается по весам double, а вес маршрута считается по его рёбрам
+        graph::DirectedWeightedGraph<double> test_graph(3);
+        test_graph.AddEdge({ 0, 2, 1000.00002 });
+        test_graph.AddEdge({ 0, 1, 1000.0 });
+        test_graph.AddEdge({ 1, 2, 0.00001 });
+        ASSERT_EQUAL(static_cast<float>(1000.00002), static_cast<float>(1000.0 + 0.00001));
+
+        const Router router(test_graph);
+        const auto route = router.BuildRoute(0, 2);
+        ASSERT(route.has_value());
+        ASSERT_EQUAL(route->edges, std::vector<graph::EdgeId>({ 1, 2 }));
+        ASSERT_EQUAL(route->weight, 1000.0 + 0.00001);
+    }
+    {
+        const std::string file_name = (std::filesystem::temp_directory_path() / "transport_catalogue_router_table.db"s).string();
+        MakeTestNetworkBase(file_name);
+        const auto snapshot = request_handler::BaseSnapshot::Load(file_name);
+        const request_handler::RequestHandler& handler = snapshot->GetHandler();
+        handler.InitRouter();
+        std::filesystem::remove(file_name);
+
+        // таблица из базы совпадает с построенной заново по графу из базы
+        const auto& transport_graph = handler.GetGraph()->GetGraph();
+        const auto& loaded_router = transport_graph::TransportRouterGetter::GetRouter(*handler.GetRouter());
+        const auto& loaded = graph::RouterDataGetter<double>::GetInternalData(loaded_router);
+        const Router built_router(transport_graph);
+        const auto& built = graph::RouterDataGetter<double>::GetInternalData(built_router);
+
+        const size_t vertex_count = transport_graph.GetVertexCount();
+        ASSERT_EQUAL(loaded.vertex_count, vertex_count);
+        ASSERT_EQUAL(loaded.cells.size(), built.cells.size());
+        size_t no_route_count = 0;
+        for (size_t index = 0; index < built.cells.size(); ++index) {
+            ASSERT_EQUAL_HINT(loaded.cells[index].prev_edge, built.cells[index].prev_edge, std::to_string(index));
+            ASSERT_EQUAL_HINT(loaded.cells[index].weight, built.cells[index].weight, std::to_string(index));
+            no_route_count += loaded.cells[index].prev_edge == Router::NO_ROUTE ? 1 : 0;
+        }
+        ASSERT(no_route_count > 0);
+
+        // маршруты по таблице из float совпадают с маршрутами по весам double
+        const auto [weights, prev_edges] = BuildSequentialRoutes(transport_graph);
+        for (graph::VertexId from = 0; from < vertex_count; ++from) {
+            ASSERT_EQUAL(loaded.At(from, from).prev_edge, Router::NO_EDGE);
+            for (graph::VertexId to = 0; to < vertex_count; ++to) {
+                const auto route = loaded_router.BuildRoute(from, to);
+                ASSERT_EQUAL(route.has_value(), prev_edges[from * vertex_count + to] != Router::NO_ROUTE);
+                if (!route) {
+                    continue;
+                }
+                std::vector<graph::EdgeId> expected_edges;
+                for (uint32_t edge_id = prev_edges[from * vertex_count + to]; edge_id != Router::NO_EDGE;
+                    edge_id = prev_edges[from * vertex_count + transport_graph.GetEdge(edge_id).from]) {
+                    expected_edges.push_back(edge_id);
+                }
+                std::reverse(expected_edges.begin(), expected_edges.end());
+                ASSERT_EQUAL(route->edges, expected_edges);
+                ASSERT(std::abs(route->weight - weights[from * vertex_count + to]) < 1e-9);
+            }
+        }
+    }
+}
+
 // ----------------------------------------------------------------------------
 
 std::filesystem::path operator""_p (const char* data, std::size_t sz) {
@@ -560,6 +1309,19 @@ void TestRandomValues() {
 // Функция TestTransportCatalogue является точкой входа для запуска тестов
 void TestTransportCatalogue() {
     RUN_TEST(TestParseGeoFromStringView);
+    RUN_TEST(TestCatalogueVersion);
+    RUN_TEST(TestDijkstra);
+    RUN_TEST(TestBlockedFloydWarshall);
+    RUN_TEST(TestKShortestPaths);
+    RUN_TEST(TestParetoSearch);
+    RUN_TEST(TestDistancesCodec);
+    RUN_TEST(TestLz4CodecRoundTrip);
+    RUN_TEST(TestLz4CodecDamagedFrames);
+    RUN_TEST(TestClipSegment);
+    RUN_TEST(TestSimplifyPolyline);
+    RUN_TEST(TestLazyRouterLoading);
+    RUN_TEST(TestStreamReloadBase);
+    RUN_TEST(TestRouterTable);
     RUN_TEST(TestFromFile);
     RUN_TEST(TestFromFileRouteEditionDebug);
 
@@ -569,19 +1331,25 @@ void TestTransportCatalogue() {
 #endif
 }
 
-void TestTransportCatalogueMakeBase(std::string_view file_name) {
+void TestTransportCatalogueMakeBase(std::string_view file_name, bool memory_report) {
     std::stringstream in;
     std::stringstream out;
     LOAD_FILE(in, std::string(file_name));
     request_handler::RequestHandlerProcess rhp(in, out);
     rhp.ExecuteMakeBaseRequests();
+    if (memory_report) {
+        rhp.PrintMemoryReport(std::cerr);
+    }
 }
 
-void TestTransportCatalogueProcessRequests(std::string_view file_name) {
+void TestTransportCatalogueProcessRequests(std::string_view file_name, bool memory_report) {
     std::stringstream in;
     std::stringstream out;
     LOAD_FILE(in, std::string(file_name));
     request_handler::RequestHandlerProcess rhp(in, out);
     rhp.ExecuteProcessRequests();
     SAVE_FILE(std::string(file_name), out.str());
+    if (memory_report) {
+        rhp.PrintMemoryReport(std::cerr);
+    }
 }
@@ -30,6 +30,6 @@ std::filesystem::path operator""_p(const char* data, std::size_t sz);
 
 void TestTransportCatalogue();
 
-void TestTransportCatalogueMakeBase(std::string_view file_name);
+void TestTransportCatalogueMakeBase(std::string_view file_name, bool memory_report = false);
 
-void TestTransportCatalogueProcessRequests(std::string_view file_name);
+void TestTransportCatalogueProcessRequests(std::string_view file_name, bool memory_report = false);
@@ -26,6 +26,10 @@ void TransportCatalogue::AddStop(std::string&& name, Coordinates&& coord) {
     stops_.Push(std::move(name), std::move(coord));
 }
 
+void TransportCatalogue::AddStop(stop_catalogue::Stop&& stop) {
+    stops_.Push(std::move(stop));
+}
+
 void TransportCatalogue::AddStop(size_t id, std::string&& name, Coordinates&& coord) {
     stops_.Push(id, std::move(name), std::move(coord));
 }
@@ -40,6 +44,10 @@ void TransportCatalogue::AddDistanceBetweenStops(const std::string_view& stop_fr
     stops_.AddDistance(*stop_from, *stop_to, distance);
 }
 
+void TransportCatalogue::AddEncodedDistances(size_t stop_id, std::string&& encoded) {
+    stops_.AddEncodedDistances(stop_id, std::move(encoded));
+}
+
 const stop_catalogue::BusesToStopNames& TransportCatalogue::GetBusesForStop(const std::string_view& name) const {
     static const std::set<std::string_view> empty_set = {};
     auto stop = stops_.At(name);
@@ -60,4 +68,27 @@ void TransportCatalogue::SetBusRouteCommonSettings(RouteSettings&& settings) {
     buses_.SetRouteSettings(std::move(settings));
 }
 
+uint64_t TransportCatalogue::GetVersion() const {
+    detail::Fnv1aHasher hasher;
+
+    hasher.Add(static_cast<uint64_t>(stops_.Size()));
+    for (size_t id = 0; id < stops_.Size(); ++id) {
+        if (auto stop = stops_.At(id)) {
+            hasher.Add((*stop)->name).Add((*stop)->coord.lat).Add((*stop)->coord.lng);
+        }
+    }
+
+    hasher.Add(static_cast<uint64_t>(buses_.Size()));
+    for (size_t id = 0; id < buses_.Size(); ++id) {
+        if (auto bus = buses_.At(id)) {
+            hasher.Add((*bus)->name).Add(static_cast<int>((*bus)->route_type));
+            for (const stop_catalogue::Stop* stop : (*bus)->route) {
+                hasher.Add(static_cast<uint64_t>(stops_.GetId(stop)));
+            }
+        }
+    }
+
+    return hasher.Get();
+}
+
 }
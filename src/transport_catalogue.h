@@ -25,12 +25,16 @@ public:
 
     void AddStop(std::string&& name, Coordinates&& coord);
 
+    void AddStop(stop_catalogue::Stop&& stop);
+
     void AddStop(size_t id, std::string&& name, Coordinates&& coord);
 
     void AddStop(size_t id, stop_catalogue::Stop&& stop);
 
     void AddDistanceBetweenStops(const std::string_view& stop_from_name, const std::string_view& stop_to_name, double distance);
 
+    void AddEncodedDistances(size_t stop_id, std::string&& encoded);
+
     const stop_catalogue::BusesToStopNames& GetBusesForStop(const std::string_view& name) const;
 
     const stop_catalogue::Catalogue& GetStops() const;
@@ -39,6 +43,15 @@ public:
 
     void SetBusRouteCommonSettings(RouteSettings&& settings);
 
+    // Метод добавляет в отчёт память, занятую остановками и маршрутами
+    void AddMemoryUsage(memory_usage::Report& report) const {
+        stops_.AddMemoryUsage(report);
+        buses_.AddMemoryUsage(report);
+    }
+
+    // Версия каталога - хеш остановок и маршрутов, не зависящий от платформы
+    uint64_t GetVersion() const;
+
     template <typename Type>
     size_t GetId(const Type* data) const {
         if constexpr (std::is_same_v<Type, stop_catalogue::Stop>) {
@@ -2,29 +2,54 @@
 
 namespace transport_graph {
 
+void TransportGraph::InitCatalogueIndex(const TransportCatalogue& catalogue) {
+    stops_.assign(catalogue.GetStops().Size(), nullptr);
+    for (const auto& [stop_name, stop_ptr] : catalogue.GetStops()) {
+        const size_t id = catalogue.GetId(stop_ptr);
+        if (id >= stops_.size()) {
+            stops_.resize(id + 1, nullptr);
+        }
+        stops_[id] = stop_ptr;
+    }
+
+    buses_.assign(catalogue.GetBuses().Size(), nullptr);
+    for (const auto& [bus_name, bus_ptr] : catalogue.GetBuses()) {
+        const size_t id = catalogue.GetId(bus_ptr);
+        if (id >= buses_.size()) {
+            buses_.resize(id + 1, nullptr);
+        }
+        buses_[id] = bus_ptr;
+    }
+}
+
 void TransportGraph::InitVertexId(const TransportCatalogue& catalogue) {
-    const auto& stops = catalogue.GetStops();
+    stop_to_vertex_id_.assign(stops_.size(), {});
 
     graph::VertexId id{};
-    for (const auto& [stop_name, stop_ptr] : stops) {
-        VertexIdLoop vertex_id = { id, id + 1 };
-        stop_to_vertex_id_.insert({ stop_ptr, vertex_id });
+    for (const auto& [stop_name, stop_ptr] : catalogue.GetStops()) {
+        stop_to_vertex_id_[catalogue.GetId(stop_ptr)] = { id, id + 1 };
         id += 2;
     }
 }
 
 void TransportGraph::CreateDiagonalEdges(const TransportCatalogue& catalogue) {
-    const double time = static_cast<double>(catalogue.GetBuses().GetRouteSettings().bus_wait_time);
+    const int common_wait_time = catalogue.GetBuses().GetRouteSettings().bus_wait_time;
 
-    for (const auto& [stop_ptr, vertex_id] : stop_to_vertex_id_) {
-        graph::EdgeId id = graph_.AddEdge({ vertex_id.transfer_id, vertex_id.id, time });
+    edges_data_.reserve(stops_.size());
+    for (uint32_t stop_id = 0; stop_id < stops_.size(); ++stop_id) {
+        if (!stops_[stop_id]) {
+            continue;
+        }
+        const double time = static_cast<double>(stops_[stop_id]->bus_wait_time.value_or(common_wait_time));
+        const VertexIdLoop& vertex_id = stop_to_vertex_id_[stop_id];
+        graph_.AddEdge({ vertex_id.transfer_id, vertex_id.id, time });
 
-        edge_id_to_graph_data_.insert({ id, { stop_ptr, stop_ptr, nullptr, 0, time } });
+        edges_data_.push_back({ stop_id, stop_id, TransportGraphData::NO_BUS, 0 });
     }
 }
 
 void TransportGraph::CreateGraph(const TransportCatalogue& catalogue) {
-    std::unordered_map<graph::VertexId, std::unordered_map<graph::VertexId, TransportGraphData>> edges;
+    EdgesData edges;
 
     for (const auto& [bus_name, bus_ptr] : catalogue.GetBuses()) {
 
@@ -38,45 +63,199 @@ void TransportGraph::CreateGraph(const TransportCatalogue& catalogue) {
     AddEdgesToGraph(edges);
 }
 
-void TransportGraph::CreateEdges(EdgesData& edges, std::vector<TransportGraphData>&& data) {
-    for (TransportGraphData& data_i : data) {
-        graph::VertexId from = stop_to_vertex_id_.at(data_i.from).id;
-        graph::VertexId to = stop_to_vertex_id_.at(data_i.to).transfer_id;
+void TransportGraph::CreateEdges(EdgesData& edges, std::vector<EdgeCandidate>&& candidates) {
+    for (EdgeCandidate& candidate : candidates) {
+        graph::VertexId from = stop_to_vertex_id_[candidate.data.from].id;
+        graph::VertexId to = stop_to_vertex_id_[candidate.data.to].transfer_id;
 
-        if (edges.count(from) > 0 && edges.at(from).count(to) > 0) {
-            if (edges.at(from).at(to).time > data_i.time) {
-                edges.at(from).at(to) = std::move(data_i);
-            }
-        }
-        else {
-            edges[from].emplace(to, std::move(data_i));
+        auto [it, inserted] = edges[from].emplace(to, candidate);
+        if (!inserted && it->second.time > candidate.time) {
+            it->second = candidate;
         }
     }
 }
 
 void TransportGraph::AddEdgesToGraph(EdgesData& edges) {
     for (auto& [from, to_map] : edges) {
-        for (auto& [to, data_i] : to_map) {
-            graph::EdgeId id = graph_.AddEdge({ from, to, data_i.time });
-            edge_id_to_graph_data_.emplace(id, std::move(data_i));
+        for (auto& [to, candidate] : to_map) {
+            // номера рёбер выдаются подряд, поэтому данные ребра лежат по его номеру
+            graph_.AddEdge({ from, to, candidate.time });
+            edges_data_.push_back(candidate.data);
+        }
+    }
+}
+
+void TransportGraph::AddMemoryUsage(memory_usage::Report& report) const {
+    using memory_usage::HeapSize;
+
+    const graph::GraphSerialization<TransportTime> graph_data;
+    const auto& edges = graph_data.GetEdges(graph_);
+    const auto& incidence_lists = graph_data.GetIncidenceList(graph_);
+
+    report.Add("graph.edges_data", HeapSize(edges_data_), edges_data_.size());
+    report.Add("graph.stop_to_vertex_id", HeapSize(stop_to_vertex_id_), stop_to_vertex_id_.size());
+    report.Add("graph.catalogue_index", HeapSize(stops_) + HeapSize(buses_), stops_.size() + buses_.size());
+    report.Add("graph.edges", HeapSize(edges), edges.size());
+    report.Add("graph.incidence_lists", HeapSize(incidence_lists), incidence_lists.size());
+}
+
+std::optional<TransportRouter::TransportRouterData> TransportRouter::GetRoute(uint32_t from, uint32_t to) const {
+    RouteScratch scratch;
+    const auto time = FindRoute(from, to, scratch);
+    if (!time) {
+        return std::nullopt;
+    }
+
+    TransportRouterData output_data;
+    output_data.time = *time;
+    output_data.route.reserve(scratch.size());
+    VisitRouteItems(scratch, [&output_data](const TransportRouteItem& item) {
+        output_data.route.push_back(item);
+    });
+    return output_data;
+}
+
+std::optional<TransportTime> TransportRouter::FindRoute(uint32_t from, uint32_t to, RouteScratch& scratch) const {
+    const auto& stop_to_vertex_id = transport_graph_.GetStopToVertexId();
+    return router_.BuildReversedRoute(stop_to_vertex_id.at(from).transfer_id, stop_to_vertex_id.at(to).transfer_id, scratch);
+}
+
+TransportRouter::TransportRouterData TransportRouter::CreateRouterData(TransportTime time, const std::vector<graph::EdgeId>& edges) const {
+    TransportRouterData output_data;
+    output_data.time = time;
+
+    output_data.route.reserve(edges.size());
+    for (graph::EdgeId id : edges) {
+        output_data.route.push_back(transport_graph_.GetRouteItem(id));
+    }
+    return output_data;
+}
+
+std::vector<TransportRouter::TransportRouterData> TransportRouter::GetAlternativeRoutes(uint32_t from, uint32_t to, size_t count) const {
+    const auto& stop_to_vertex_id = transport_graph_.GetStopToVertexId();
+    const graph::VertexId vertex_from = stop_to_vertex_id.at(from).transfer_id;
+    const graph::VertexId vertex_to = stop_to_vertex_id.at(to).transfer_id;
+
+    std::vector<TransportRouterData> routes;
+
+    auto shortest = router_.BuildRoute(vertex_from, vertex_to);
+    if (!shortest || count == 0) {
+        return routes;
+    }
+
+    // больше count * ALTERNATIVE_PATHS_PER_ROUTE путей не просматривается, более тяжёлые ответвления не ищутся
+    const size_t max_paths = count * ALTERNATIVE_PATHS_PER_ROUTE;
+    graph::KShortestPaths<TransportTime> paths(transport_graph_.GetGraph(), vertex_from, vertex_to,
+        std::move((*shortest).edges), max_paths);
+
+    // маршруты с той же последовательностью автобусов отличаются только местом пересадки
+    std::set<std::vector<uint32_t>> bus_sequences;
+
+    for (size_t examined = 0; routes.size() < count && examined < max_paths; ++examined) {
+        auto path = paths.Next();
+        if (!path) {
+            break;
+        }
+
+        std::vector<uint32_t> buses;
+        for (graph::EdgeId id : (*path).edges) {
+            const uint32_t bus = transport_graph_.GetEdgesData()[id].bus;
+            // выход и повторная посадка в тот же автобус не делают маршрут другим
+            if (bus != TransportGraphData::NO_BUS && (buses.empty() || buses.back() != bus)) {
+                buses.push_back(bus);
+            }
+        }
+
+        if (bus_sequences.insert(std::move(buses)).second) {
+            routes.push_back(CreateRouterData((*path).weight, (*path).edges));
         }
     }
+
+    return routes;
 }
 
-std::optional<TransportRouter::TransportRouterData> TransportRouter::GetRoute(const stop_catalogue::Stop* from, const stop_catalogue::Stop* to) const {
+std::vector<std::optional<TransportTime>> TransportRouter::GetRouteTimes(uint32_t from, const std::vector<uint32_t>& to) const {
+    const auto& graph = transport_graph_.GetGraph();
     const auto& stop_to_vertex_id = transport_graph_.GetStopToVertexId();
-    auto route = router_.BuildRoute(stop_to_vertex_id.at(from).transfer_id, stop_to_vertex_id.at(to).transfer_id);
-    if (route) {
-        TransportRouterData output_data;
-        output_data.time = (*route).weight;
-
-        const auto& edge_id_to_graph_data = transport_graph_.GetEdgeIdToGraphData();
-        for (graph::EdgeId id : (*route).edges) {
-            output_data.route.push_back(edge_id_to_graph_data.at(id));
+
+    // маршрут заканчивается в вершине пересадки, поэтому до неё и ведётся поиск
+    std::vector<uint8_t> is_target(graph.GetVertexCount(), 0);
+    size_t target_count = 0;
+    for (uint32_t stop_id : to) {
+        uint8_t& target = is_target[stop_to_vertex_id.at(stop_id).transfer_id];
+        target_count += target == 0 ? 1 : 0;
+        target = 1;
+    }
+
+    graph::Dijkstra<TransportTime> search(graph);
+    search.Start(stop_to_vertex_id.at(from).transfer_id);
+    while (target_count > 0) {
+        const auto vertex = search.SettleNext();
+        if (!vertex) {
+            break;
         }
-        return output_data;
+        target_count -= is_target[*vertex];
     }
-    return std::nullopt;
+
+    std::vector<std::optional<TransportTime>> times;
+    times.reserve(to.size());
+    for (uint32_t stop_id : to) {
+        const graph::VertexId vertex = stop_to_vertex_id[stop_id].transfer_id;
+        times.push_back(search.IsSettled(vertex) ? std::optional(search.GetWeight(vertex)) : std::nullopt);
+    }
+    return times;
+}
+
+std::vector<std::pair<uint32_t, TransportTime>> TransportRouter::GetReachableStops(uint32_t from, TransportTime max_time) const {
+    const auto& stop_to_vertex_id = transport_graph_.GetStopToVertexId();
+
+    graph::Dijkstra<TransportTime> search(transport_graph_.GetGraph());
+    search.Start(stop_to_vertex_id.at(from).transfer_id);
+    while (true) {
+        const auto weight = search.PeekWeight();
+        if (!weight || *weight > max_time) {
+            break;
+        }
+        search.SettleNext();
+    }
+
+    std::vector<std::pair<uint32_t, TransportTime>> stops;
+    for (uint32_t stop_id = 0; stop_id < stop_to_vertex_id.size(); ++stop_id) {
+        if (!transport_graph_.GetStop(stop_id)) {
+            continue;
+        }
+        const graph::VertexId vertex = stop_to_vertex_id[stop_id].transfer_id;
+        if (search.IsSettled(vertex)) {
+            stops.push_back({ stop_id, search.GetWeight(vertex) });
+        }
+    }
+    return stops;
+}
+
+std::vector<TransportRouter::TransportRouterData> TransportRouter::GetParetoRoutes(uint32_t from, uint32_t to, uint32_t max_transfers) const {
+    const auto& stop_to_vertex_id = transport_graph_.GetStopToVertexId();
+    const auto& edges_data = transport_graph_.GetEdgesData();
+
+    // память поиска принадлежит потоку и переиспользуется запросами к любой базе.
+    // Каждая посадка - ребро ожидания без автобуса, пересадок на одну меньше, чем посадок
+    thread_local graph::ParetoSearch<TransportTime> search;
+    search.Prepare(transport_graph_.GetGraph(), max_transfers + 1);
+    const auto front = search.Run(stop_to_vertex_id.at(from).transfer_id, stop_to_vertex_id.at(to).transfer_id,
+        [&edges_data](graph::EdgeId edge_id) {
+            return edges_data[edge_id].bus == TransportGraphData::NO_BUS;
+        });
+
+    std::vector<TransportRouterData> routes;
+    routes.reserve(front.size());
+    for (const auto& path : front) {
+        routes.push_back(CreateRouterData(path.weight, path.edges));
+    }
+    return routes;
+}
+
+void TransportRouter::AddMemoryUsage(memory_usage::Report& report) const {
+    const auto& routes_internal_data = graph::RouterDataGetter<TransportTime>::GetInternalData(router_);
+    report.Add("router.routes_internal_data", memory_usage::HeapSize(routes_internal_data.cells), routes_internal_data.cells.size());
 }
 
 } // namespace transport_graph
@@ -1,12 +1,20 @@
 #pragma once
 
+#include "dijkstra.h"
 #include "domain.h"
+#include "k_shortest_paths.h"
+#include "pareto_search.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
+#include <cstdint>
+#include <limits>
 #include <optional>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace transport_graph {
 
@@ -14,20 +22,43 @@ using namespace transport_catalogue;
 
 using TransportTime = double;
 
+// Данные ребра графа: номера остановок и маршрута в каталоге и количество пролётов.
+// Время ребра не дублируется, оно хранится в весе ребра графа
 struct TransportGraphData {
+    static constexpr uint32_t NO_BUS = std::numeric_limits<uint32_t>::max();
+
+    uint32_t from = 0;
+    uint32_t to = 0;
+    uint32_t bus = NO_BUS;
+    uint32_t stop_count = 0;
+};
+
+static_assert(sizeof(TransportGraphData) == 16, "TransportGraphData must stay packed");
+
+// Элемент найденного маршрута: ожидание на остановке (from == to) или поездка на автобусе
+struct TransportRouteItem {
     const stop_catalogue::Stop* from;
     const stop_catalogue::Stop* to;
     const bus_catalogue::Bus* bus;
     int stop_count;
-    double time;
+    TransportTime time;
 };
 
+// Память для восстановления маршрута: рёбра в обратном порядке. Переиспользуется между запросами
+using RouteScratch = std::vector<graph::EdgeId>;
+
 struct VertexIdLoop {
     graph::VertexId id{};
     graph::VertexId transfer_id{};
 };
 
-using EdgesData = std::unordered_map<graph::VertexId, std::unordered_map<graph::VertexId, TransportGraphData>>;
+// Кандидат в рёбра графа: из нескольких рёбер между парой вершин остаётся самое быстрое
+struct EdgeCandidate {
+    TransportGraphData data;
+    TransportTime time;
+};
+
+using EdgesData = std::unordered_map<graph::VertexId, std::unordered_map<graph::VertexId, EdgeCandidate>>;
 
 class TransportGraphDeserialization;
 
@@ -35,6 +66,7 @@ class TransportGraph {
 public:
     explicit TransportGraph(const TransportCatalogue& catalogue)
         : graph_(2 * catalogue.GetStops().Size()) {
+        InitCatalogueIndex(catalogue);
         InitVertexId(catalogue);
         CreateDiagonalEdges(catalogue);
         CreateGraph(catalogue);
@@ -44,14 +76,34 @@ public:
         return graph_;
     }
 
-    const std::unordered_map<graph::EdgeId, TransportGraphData>& GetEdgeIdToGraphData() const {
-        return edge_id_to_graph_data_;
+    // Данные рёбер по номерам рёбер графа
+    const std::vector<TransportGraphData>& GetEdgesData() const {
+        return edges_data_;
     }
 
-    const std::unordered_map<const stop_catalogue::Stop*, VertexIdLoop>& GetStopToVertexId() const {
+    // Вершины остановок по номерам остановок в каталоге
+    const std::vector<VertexIdLoop>& GetStopToVertexId() const {
         return stop_to_vertex_id_;
     }
 
+    const stop_catalogue::Stop* GetStop(uint32_t id) const {
+        return stops_[id];
+    }
+
+    const bus_catalogue::Bus* GetBus(uint32_t id) const {
+        return id == TransportGraphData::NO_BUS ? nullptr : buses_[id];
+    }
+
+    // Метод возвращает элемент маршрута, соответствующий ребру графа
+    TransportRouteItem GetRouteItem(graph::EdgeId edge_id) const {
+        const TransportGraphData& data = edges_data_[edge_id];
+        return { GetStop(data.from), GetStop(data.to), GetBus(data.bus),
+                 static_cast<int>(data.stop_count), graph_.GetEdge(edge_id).weight };
+    }
+
+    // Метод добавляет в отчёт память, занятую графом и данными его рёбер
+    void AddMemoryUsage(memory_usage::Report& report) const;
+
 public:
     friend class TransportGraphDeserialization;
 
@@ -62,6 +114,9 @@ private:
     static constexpr double TO_MINUTES = (3.6 / 60.0);
 
 private:
+    // Метод заполняет таблицы остановок и маршрутов по их номерам в каталоге
+    void InitCatalogueIndex(const TransportCatalogue& catalogue);
+
     void InitVertexId(const TransportCatalogue& catalogue);
 
     void CreateDiagonalEdges(const TransportCatalogue& catalogue);
@@ -69,45 +124,60 @@ private:
     void CreateGraph(const TransportCatalogue& catalogue);
 
     template <typename It>
-    std::vector<TransportGraphData> CreateTransportGraphData(const ranges::BusRange<It>& bus_range, const TransportCatalogue& catalogue);
+    std::vector<EdgeCandidate> CreateTransportGraphData(const ranges::BusRange<It>& bus_range, const TransportCatalogue& catalogue);
 
-    void CreateEdges(EdgesData& edges, std::vector<TransportGraphData>&& data);
+    void CreateEdges(EdgesData& edges, std::vector<EdgeCandidate>&& candidates);
 
     void AddEdgesToGraph(EdgesData& edges);
 
 private:
-    std::unordered_map<graph::EdgeId, TransportGraphData> edge_id_to_graph_data_{};
+    std::vector<TransportGraphData> edges_data_{};
+
+    std::vector<VertexIdLoop> stop_to_vertex_id_{};
+
+    std::vector<const stop_catalogue::Stop*> stops_{};
 
-    std::unordered_map<const stop_catalogue::Stop*, VertexIdLoop> stop_to_vertex_id_{};
+    std::vector<const bus_catalogue::Bus*> buses_{};
 
     graph::DirectedWeightedGraph<TransportTime> graph_{};
 };
 
 template <typename It>
-inline std::vector<TransportGraphData> TransportGraph::CreateTransportGraphData(const ranges::BusRange<It>& bus_range, const TransportCatalogue& catalogue) {
+inline std::vector<EdgeCandidate> TransportGraph::CreateTransportGraphData(const ranges::BusRange<It>& bus_range, const TransportCatalogue& catalogue) {
     const auto& stop_distances = catalogue.GetStops().GetDistances();
-    const double bus_velocity = catalogue.GetBuses().GetRouteSettings().bus_velocity;
+    const double bus_velocity = bus_range.GetPtr()->route_settings.bus_velocity;
+    const uint32_t bus_id = static_cast<uint32_t>(catalogue.GetId(bus_range.GetPtr()));
+
+    // Номера остановок и длины перегонов ищутся в каталоге один раз за проход по маршруту,
+    // дальше время каждого ребра получается сложением перегонов из массива.
+    // segment_distances[i] - расстояние от остановки i - 1 до остановки i
+    std::vector<uint32_t> stop_ids;
+    std::vector<double> segment_distances;
+    const stop_catalogue::Stop* previous_stop = nullptr;
+    for (const stop_catalogue::Stop* stop : bus_range) {
+        stop_ids.push_back(static_cast<uint32_t>(catalogue.GetId(stop)));
+        segment_distances.push_back(previous_stop ? stop_distances.at({ previous_stop, stop }) : 0.0);
+        previous_stop = stop;
+    }
 
-    std::vector<TransportGraphData> data;
+    const size_t size = stop_ids.size();
+    std::vector<EdgeCandidate> data;
+    data.reserve(size > 0 ? size * (size - 1) / 2 : 0);
 
-    for (auto it_from = bus_range.begin(); it_from != bus_range.end(); ++it_from) {
-        const stop_catalogue::Stop* stop_from = *it_from;
-        const stop_catalogue::Stop* previous_stop = stop_from;
+    for (size_t from = 0; from < size; ++from) {
+        const uint32_t stop_from_id = stop_ids[from];
 
         double full_distance = 0.0;
-        int stop_count = 0;
-
-        for (auto it_to = it_from + 1; it_to != bus_range.end(); ++it_to) {
-            const stop_catalogue::Stop* stop_to = *it_to;
+        uint32_t stop_count = 0;
 
-            if (stop_from != stop_to) {
-                full_distance += stop_distances.at({ previous_stop, stop_to });
+        for (size_t to = from + 1; to < size; ++to) {
+            // возвращение в начальную остановку ребром не становится и перегон в неё не учитывается
+            if (stop_from_id != stop_ids[to]) {
+                full_distance += segment_distances[to];
                 stop_count++;
 
-                data.push_back({ stop_from, stop_to, bus_range.GetPtr(), stop_count, (full_distance / bus_velocity) * TO_MINUTES });
+                data.push_back({ { stop_from_id, stop_ids[to], bus_id, stop_count }, (full_distance / bus_velocity) * TO_MINUTES });
             }
-
-            previous_stop = stop_to;
         }
     }
 
@@ -120,16 +190,21 @@ class TransportGraphDeserialization {
 public:
     TransportGraphDeserialization() = default;
 
-    TransportGraphDeserialization& SetEdgeIdToGraphData(std::unordered_map<graph::EdgeId, TransportGraphData>&& edge_id_to_graph_data) {
-        transport_graph_.edge_id_to_graph_data_ = std::move(edge_id_to_graph_data);
+    TransportGraphDeserialization& SetEdgesData(std::vector<TransportGraphData>&& edges_data) {
+        transport_graph_.edges_data_ = std::move(edges_data);
         return *this;
     }
 
-    TransportGraphDeserialization& SetStopToVertexId(std::unordered_map<const stop_catalogue::Stop*, VertexIdLoop>&& stop_to_vertex_id) {
+    TransportGraphDeserialization& SetStopToVertexId(std::vector<VertexIdLoop>&& stop_to_vertex_id) {
         transport_graph_.stop_to_vertex_id_ = std::move(stop_to_vertex_id);
         return *this;
     }
 
+    TransportGraphDeserialization& SetCatalogue(const TransportCatalogue& catalogue) {
+        transport_graph_.InitCatalogueIndex(catalogue);
+        return *this;
+    }
+
     TransportGraphDeserialization& CreateGraph(
         std::vector<graph::Edge<TransportTime>>&& edges,
         std::vector<std::vector<graph::EdgeId>>&& incidence_list) {
@@ -159,7 +234,7 @@ class TransportRouterCreator;
 class TransportRouter {
 public:
     struct TransportRouterData {
-        std::vector<TransportGraphData> route{};
+        std::vector<TransportRouteItem> route{};
         TransportTime time{};
     };
 
@@ -169,13 +244,52 @@ public:
         , router_(transport_graph.GetGraph()) {
     }
 
-    std::optional<TransportRouter::TransportRouterData> GetRoute(const stop_catalogue::Stop* from, const stop_catalogue::Stop* to) const;
+    // Метод возвращает маршрут между остановками с номерами from и to в каталоге
+    std::optional<TransportRouter::TransportRouterData> GetRoute(uint32_t from, uint32_t to) const;
+
+    // Метод восстанавливает маршрут между остановками с номерами from и to в scratch и возвращает
+    // время в пути, nullopt - если маршрута нет. Элементы маршрута выдаёт VisitRouteItems
+    std::optional<TransportTime> FindRoute(uint32_t from, uint32_t to, RouteScratch& scratch) const;
+
+    // Метод передаёт visitor элементы маршрута, найденного FindRoute, по порядку, без промежуточных копий
+    template <typename Visitor>
+    void VisitRouteItems(const RouteScratch& scratch, Visitor&& visitor) const {
+        for (auto it = scratch.rbegin(); it != scratch.rend(); ++it) {
+            visitor(transport_graph_.GetRouteItem(*it));
+        }
+    }
+
+    // Метод возвращает время в пути от остановки from до каждой из остановок to одним поиском
+    // Дейкстры, без восстановления маршрутов. Для недостижимых остановок возвращает nullopt
+    std::vector<std::optional<TransportTime>> GetRouteTimes(uint32_t from, const std::vector<uint32_t>& to) const;
+
+    // Метод возвращает номера остановок, до которых от остановки from можно доехать не дольше
+    // чем за max_time, вместе с временем в пути. Поиск не продолжается дальше max_time
+    std::vector<std::pair<uint32_t, TransportTime>> GetReachableStops(uint32_t from, TransportTime max_time) const;
+
+    // Метод возвращает до count маршрутов между остановками from и to в порядке возрастания времени.
+    // Первый маршрут совпадает с GetRoute, остальные - следующие по времени пути алгоритма Йена,
+    // отличающиеся от уже выбранных последовательностью автобусов
+    std::vector<TransportRouter::TransportRouterData> GetAlternativeRoutes(uint32_t from, uint32_t to, size_t count) const;
+
+    // Метод возвращает маршруты между остановками from и to, оптимальные по Парето по времени
+    // и количеству пересадок, не больше max_transfers пересадок. Маршруты упорядочены по
+    // возрастанию времени, каждый следующий медленнее предыдущего, но с меньшим числом пересадок
+    std::vector<TransportRouter::TransportRouterData> GetParetoRoutes(uint32_t from, uint32_t to, uint32_t max_transfers) const;
+
+    // Метод добавляет в отчёт память, занятую таблицей кратчайших путей
+    void AddMemoryUsage(memory_usage::Report& report) const;
 
 public:
     friend class TransportRouterGetter;
     friend class TransportRouterCreator;
 
 private:
+    // Количество путей алгоритма Йена, просматриваемых на один запрошенный маршрут
+    static constexpr size_t ALTERNATIVE_PATHS_PER_ROUTE = 4;
+
+    TransportRouterData CreateRouterData(TransportTime time, const std::vector<graph::EdgeId>& edges) const;
+
     TransportRouter(
         const TransportGraph& transport_graph,
         graph::Router<TransportTime>&& router)